@@ -3,24 +3,97 @@
  * @brief Archive the winning and losing boards of the game.
  *
  * The archive is used to store the winning and losing states of the game. The archive can be saved to and loaded from
- * files. The archive can also predict the winner of a game state based on the winning and losing states.
+ * files, either as text or in the binary format of archive_file.h. The archive can also predict the winner of a game
+ * state based on the winning and losing states.
+ *
+ * The boards are sharded by number of chips. Insertions and queries are safe to call concurrently: queries never lock,
+ * and insertions serialize on the shards they modify (see ArchiveBucket), and on the journal if one is attached, but
+ * only to copy their records into its buffer (see ArchiveJournal::append()). Loading and pruning rebuild the shards, so
+ * they must not run concurrently with other insertions.
  */
 
 #ifndef ARCHIVE_H
 #define ARCHIVE_H
 
+#include <array>
+#include <atomic>
 #include <filesystem>
-#include <map>
+#include "archive_bucket.h"
+#include "archive_file.h"
+#include "archive_journal.h"
 #include "game_state.h"
 
+/// @brief Counters of the queries of Archive::predictWinner() for game states with a given number of chips.
+struct ArchiveQueryStats {
+    size_t calls = 0;
+    /// @brief Queries that predicted the winner.
+    size_t hits = 0;
+    /// @brief Boards compared with the game state, over all queries. The bounds of the blocks rule out the others.
+    size_t scanned = 0;
+};
+
+/// @brief What an archive did since it was created.
+struct ArchiveStats {
+    std::array<ArchiveQueryStats, Board::MAX_CHIPS + 1> queries;
+    /// @brief Boards kept by addWinning() and addLosing().
+    size_t inserted = 0;
+    /// @brief Boards not kept by addWinning() and addLosing(), as another board made them redundant.
+    size_t rejected = 0;
+    /// @brief Boards removed by addWinning() and addLosing(), as the new board made them redundant.
+    size_t replaced = 0;
+    /// @brief Boards removed by prune().
+    size_t pruned = 0;
+};
+
+class ArchiveSnapshot;
+
 class Archive {
 public:
-    Archive() noexcept;
+    /// @brief One bucket per number of chips.
+    using Buckets = std::array<ArchiveBucket, Board::MAX_CHIPS + 1>;
+
+    /**
+     * @brief Constructor.
+     * @param goal The goal the boards are solved for. Recorded in binary files, and binary files saved for another goal
+     * are not loaded.
+     * @param fileFormat The format the boards are saved in.
+     */
+    explicit Archive(
+            int goal = BinaryArchiveHeader::UNKNOWN_GOAL, ArchiveFormat fileFormat = ArchiveFormat::TEXT) noexcept;
 
+    /// @brief Save the winning boards in the file format of the archive.
     void saveWinning(const std::filesystem::path& filename);
+    /// @brief Save the losing boards in the file format of the archive.
     void saveLosing(const std::filesystem::path& filename);
+
+    /**
+     * @brief Takes a snapshot of the winning boards, to be packed and saved on another thread.
+     *
+     * The boards are not copied, only the chunks of the buckets are shared, so a checkpoint can take a snapshot while
+     * the search waits, and copy and save it on another thread while the search goes on. Boards added or removed while
+     * the snapshot is taken may or may not be in it.
+     */
+    [[nodiscard]] ArchiveSnapshot getWinningSnapshot() const;
+    /// @brief Same as getWinningSnapshot(), but for losing boards.
+    [[nodiscard]] ArchiveSnapshot getLosingSnapshot() const;
+
+    /// @brief Load winning boards from a text or binary file, whichever the file is.
     void loadWinning(const std::filesystem::path& filename);
+    /// @brief Load losing boards from a text or binary file, whichever the file is.
     void loadLosing(const std::filesystem::path& filename);
+    /// @brief Load winning boards already read into memory, e.g. by ArchiveJournal::replay().
+    void loadWinning(const BinaryArchive& boards);
+    /// @brief Load losing boards already read into memory.
+    void loadLosing(const BinaryArchive& boards);
+
+    /**
+     * @brief Records the boards added to the archive, and the boards they make redundant, in a journal.
+     * @param journal The journal, which must outlive the archive or be detached first. nullptr detaches it.
+     *
+     * Only the changes made by addWinning() and addLosing() are recorded. Loaded boards are already in their files, and
+     * pruning only removes redundant boards, which a replay keeps harmlessly until the next prune.
+     */
+    void setJournal(ArchiveJournal* journal) noexcept;
 
     void addWinning(const Board& board) noexcept;
     void addLosing(const Board& board) noexcept;
@@ -37,7 +110,11 @@ public:
      * @brief Remove all redundant winning and losing states.
      *
      * If a winning/losing state is strictly greater/less than another winning/losing state, the former state will be
-     * considered as redundant, and thus be removed.
+     * considered as redundant, and thus be removed. Of equal states, only the first one is kept.
+     *
+     * The states are checked in parallel on the shared thread pool, each one only against the buckets that may hold a
+     * state making it redundant. If verbose, the progress is reported every few seconds, and the throughput at the end.
+     * Once isStopRequested() (see signals.h), the states not checked yet are kept and the prune returns.
      */
     void prune(int verbose = 0) noexcept;
 
@@ -54,23 +131,64 @@ public:
     [[nodiscard]] std::vector<Board> getLosingBoardsAsVector() const noexcept;
 
     // Getters
-    [[nodiscard]] const std::map<size_t, std::vector<Board>>& getWinningBoards() const noexcept;
-    [[nodiscard]] const std::map<size_t, std::vector<Board>>& getLosingBoards() const noexcept;
+    [[nodiscard]] int getGoal() const noexcept;
+    [[nodiscard]] ArchiveFormat getFileFormat() const noexcept;
+    [[nodiscard]] ArchiveJournal* getJournal() const noexcept;
+    [[nodiscard]] const Buckets& getWinningBoards() const noexcept;
+    [[nodiscard]] const Buckets& getLosingBoards() const noexcept;
     [[nodiscard]] size_t getWinningCount() const noexcept;
     [[nodiscard]] size_t getLosingCount() const noexcept;
 
+    /// @return The counters of the queries, insertions and removals. Safe to call during a search.
+    [[nodiscard]] ArchiveStats getStats() const noexcept;
+
 private:
+    /// @brief Counts a query and returns its result.
+    Player countQuery(size_t numChips, Player winner, size_t scanned) const noexcept;
+
+    /// @brief The counters of ArchiveQueryStats, on their own cache line as concurrent queries update them together.
+    struct alignas(64) QueryCounters {
+        std::atomic<size_t> calls = 0, hits = 0, scanned = 0;
+    };
+
     /**
      * @brief Store the winning and losing states.
      *
      * The index is the number of remaining chips in the game state. When deciding whether a game state is winning, all
      * winning states with more chips than the target game state will be skipped. Similar optimization is applied to
-     * losing states as well.
+     * losing states as well. Each bucket is indexed by the signatures of its boards (see ArchiveBucket), so a
+     * prediction only compares against the boards whose block bounds admit a match.
      */
-    std::map<size_t, std::vector<Board>> winningBoards_, losingBoards_;
+    Buckets winningBoards_, losingBoards_;
+
+    int goal_;
+    ArchiveFormat fileFormat_;
+    ArchiveJournal* journal_;
 
-    size_t winningCount_, losingCount_;
+    std::atomic<size_t> winningCount_, losingCount_;
     size_t winningPruneThreshold_, losingPruneThreshold_;
+
+    mutable std::array<QueryCounters, Board::MAX_CHIPS + 1> queryCounters_;
+    std::atomic<size_t> inserted_, rejected_, replaced_, pruned_;
+};
+
+/**
+ * @class ArchiveSnapshot
+ * @brief The boards of one side of an archive, as returned by Archive::getWinningSnapshot() and getLosingSnapshot().
+ */
+class ArchiveSnapshot {
+public:
+    ArchiveSnapshot() noexcept = default;
+
+    /// @brief Takes a snapshot of the buckets, which the snapshot may outlive.
+    ArchiveSnapshot(const Archive::Buckets& buckets, int goal);
+
+    /// @brief Copies the boards into the packed layout of a binary archive, to be saved with saveArchiveFile().
+    [[nodiscard]] BinaryArchive pack() const;
+
+private:
+    std::array<ArchiveBucket::SharedSnapshot, Board::MAX_CHIPS + 1> buckets_;
+    int goal_ = BinaryArchiveHeader::UNKNOWN_GOAL;
 };
 
 #endif // ARCHIVE_H
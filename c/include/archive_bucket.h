@@ -0,0 +1,304 @@
+/**
+ * @file archive_bucket.h
+ * @brief A list of archived boards with the same number of chips, indexed for dominance queries and safe to read while
+ * another thread writes.
+ *
+ * The boards are grouped into blocks of BLOCK_SIZE consecutive entries, and the blocks into chunks (super-blocks) of
+ * BLOCK_SIZE blocks. Each block and chunk stores the position-wise minimum and maximum of the signatures of the
+ * live entries of each block and chunk. A query for boards below (or above) a target skips a whole group as soon as its
+ * minimum (or maximum) signature is not below (or above) the target's, so only the entries of the surviving blocks are
+ * compared one by one.
+ *
+ * Readers never lock. Chunks never move once allocated, and an entry becomes visible when the published size grows
+ * past it, after the entry and the bounds that include it have been written. Removing an entry sets its tombstone and
+ * then shrinks the bounds of its groups. Writers are serialized by a mutex per bucket, and update the bounds in place.
+ * The storage is retired through the EpochManager once it is full or the tombstones fill a chunk and the bucket gets
+ * compacted, so every read goes through a Snapshot taken inside an EpochManager::Guard.
+ *
+ * Entries keep their insertion order. The search inserts boards in depth-first order, so consecutive entries tend to
+ * be similar and the bounds stay tight without sorting.
+ */
+
+#ifndef ARCHIVE_BUCKET_H
+#define ARCHIVE_BUCKET_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "board_signature.h"
+
+/**
+ * @brief A board in the archive, stored with its signature so most comparisons are settled without touching the board.
+ */
+struct ArchivedBoard {
+    Board board;
+    BoardSignature signature;
+    /// @brief Identifies the entry within its bucket. Increases in insertion order and is never reused.
+    std::uint64_t id = 0;
+
+    ArchivedBoard() noexcept = default;
+    explicit ArchivedBoard(const Board& board) noexcept;
+};
+
+/// @brief Which side of the target a dominance query looks for.
+enum class Dominance { BELOW, ABOVE };
+
+class ArchiveBucket {
+private:
+    struct Chunk;
+    struct Storage;
+
+public:
+    /// @brief Number of entries per block, and number of blocks per chunk.
+    static constexpr size_t BLOCK_SIZE = 16;
+    static constexpr size_t CHUNK_SIZE = BLOCK_SIZE * BLOCK_SIZE;
+
+    /**
+     * @class Snapshot
+     * @brief The entries published when the snapshot was taken. Only valid inside the guard it was taken in.
+     *
+     * Entries removed after the snapshot was taken may or may not be visited.
+     */
+    class Snapshot {
+    public:
+        /// @return The number of chunks, i.e. the super-blocks that can be searched separately.
+        [[nodiscard]] size_t countSuperBlocks() const noexcept;
+
+        /// @return The id the next entry of the bucket gets, or a smaller one if the last entries were removed.
+        [[nodiscard]] std::uint64_t getNextId() const noexcept;
+
+        /**
+         * @brief Finds an entry whose board may be below or above the target.
+         * @param superBlock Index of the super-block to search, in [0, countSuperBlocks()).
+         * @param target Signature of the target board.
+         * @param dominance Whether to look for entries below or above the target.
+         * @param predicate Called on every live entry that passes the bounds, in order, until it returns true.
+         * @return Whether the predicate returned true for any entry.
+         *
+         * Searching the super-blocks separately lets several threads share one query.
+         */
+        template<typename Predicate>
+        bool findInSuperBlock(
+                size_t superBlock, const BoardSignature& target, Dominance dominance, Predicate&& predicate) const;
+
+        /// @brief Same as findInSuperBlock(), over all super-blocks.
+        template<typename Predicate>
+        bool find(const BoardSignature& target, Dominance dominance, Predicate&& predicate) const {
+            for (size_t s = 0; s < this->countSuperBlocks(); s++) {
+                if (this->findInSuperBlock(s, target, dominance, predicate)) return true;
+            }
+            return false;
+        }
+
+        /**
+         * @brief Calls the predicate on every live entry, in order, until it returns true.
+         * @param predicate The predicate.
+         * @param firstId Entries with a smaller id are skipped.
+         * @return Whether the predicate returned true for any entry.
+         */
+        template<typename Predicate>
+        bool forEach(Predicate&& predicate, std::uint64_t firstId = 0) const;
+
+    private:
+        friend class ArchiveBucket;
+
+        Snapshot(const Storage* storage, size_t size) noexcept;
+
+        [[nodiscard]] const ArchivedBoard& at(size_t i) const noexcept;
+
+        const Storage* storage_;
+        size_t size_;
+    };
+
+    /**
+     * @class SharedSnapshot
+     * @brief Same as Snapshot, but sharing the ownership of the chunks, so it stays valid outside of any guard and can
+     * be handed to another thread.
+     *
+     * Unlike with a Snapshot, entries removed after the snapshot was taken are still visited, so it holds the entries
+     * that were live when it was taken.
+     */
+    class SharedSnapshot {
+    public:
+        SharedSnapshot() noexcept = default;
+
+        /// @return The number of entries published when the snapshot was taken, including the removed ones.
+        [[nodiscard]] size_t getPublishedSize() const noexcept;
+
+        /// @brief Same as Snapshot::forEach(), from the first entry.
+        template<typename Predicate>
+        bool forEach(Predicate&& predicate) const;
+
+    private:
+        friend class ArchiveBucket;
+
+        std::vector<std::shared_ptr<const Chunk>> chunks_;
+        size_t size_ = 0;
+        std::uint64_t removals_ = 0;
+    };
+
+    ArchiveBucket() noexcept;
+    ~ArchiveBucket();
+
+    ArchiveBucket(const ArchiveBucket&) = delete;
+    ArchiveBucket& operator=(const ArchiveBucket&) = delete;
+
+    /**
+     * @brief Appends a board to the bucket.
+     * @return The id given to the entry.
+     *
+     * Time complexity: O(1) amortized, besides the size of a signature.
+     */
+    std::uint64_t push_back(ArchivedBoard entry);
+
+    /**
+     * @brief Marks the entry with the given id as removed.
+     * @return Whether the entry was live, so that exactly one of several concurrent removals succeeds.
+     *
+     * Time complexity: O(log(size)), plus O(size) when the bucket gets compacted.
+     */
+    bool remove(std::uint64_t id);
+
+    /// @brief Removes all entries.
+    void clear();
+
+    /// @return A snapshot of the published entries. Must be called inside an EpochManager::Guard.
+    [[nodiscard]] Snapshot getSnapshot() const noexcept;
+
+    /**
+     * @return A snapshot of the published entries that may outlive the guard and the bucket.
+     *
+     * Time complexity: O(number of chunks), as the entries are not copied.
+     */
+    [[nodiscard]] SharedSnapshot getSharedSnapshot() const;
+
+    /// @return The number of live entries.
+    [[nodiscard]] size_t size() const noexcept;
+
+    /// @return Whether there is no live entry.
+    [[nodiscard]] bool empty() const noexcept;
+
+private:
+    /**
+     * @brief The position-wise minimum and maximum of a group of signatures.
+     *
+     * Updated in place while readers check them, so the signatures are stored as words that are loaded and stored
+     * atomically. A reader may see some words before an update and some after it, which still bounds every entry it
+     * can see, as both do.
+     */
+    struct Bounds {
+        static constexpr size_t WORDS = sizeof(BoardSignature) / sizeof(std::uint64_t);
+
+        std::array<std::uint64_t, WORDS> min{}, max{};
+        std::atomic<bool> live = false;  // Whether the group has live entries. If not, min and max are meaningless
+
+        /// @return The minimum or maximum, loaded atomically word by word.
+        [[nodiscard]] BoardSignature loadMin() const noexcept;
+        [[nodiscard]] BoardSignature loadMax() const noexcept;
+
+        /// @brief Widens the bounds to include the signature, starting them if the group had no live entry.
+        void expand(const BoardSignature& signature) noexcept;
+
+        /// @brief Replaces the bounds, or marks the group as having no live entry if newLive is false.
+        void assign(const BoardSignature& newMin, const BoardSignature& newMax, bool newLive) noexcept;
+    };
+
+    /// @brief CHUNK_SIZE entries that never move once allocated, with the bounds of each block and of the whole chunk.
+    struct Chunk {
+        std::array<ArchivedBoard, CHUNK_SIZE> entries;
+        std::array<std::atomic<std::uint64_t>, CHUNK_SIZE> removed{};  // Sequence number of the removal, or 0 if live
+        std::array<Bounds, BLOCK_SIZE> blockBounds;
+        Bounds bounds;
+    };
+
+    /// @brief A directory of chunks with a fixed capacity. Replaced as a whole when it is full or gets compacted.
+    struct Storage {
+        explicit Storage(size_t capacity, std::uint64_t nextId) noexcept;
+
+        size_t capacity;
+        std::unique_ptr<std::shared_ptr<Chunk>[]> chunks;  // Shared with the storage that replaces this one
+        std::atomic<size_t> size = 0;                       // Number of published entries
+        std::uint64_t baseId;                               // Id of the next entry when the storage was created
+    };
+
+    /// @brief Whether a group with the given bounds may contain a live entry below or above the target.
+    [[nodiscard]] static bool mayContain(
+            const Bounds& bounds, const BoardSignature& target, Dominance dominance) noexcept;
+
+    /// @brief Appends an entry to a storage that has room for it, and publishes it. The mutex must be held.
+    static void append(Storage& storage, ArchivedBoard entry);
+
+    /// @brief Recomputes the bounds of a block from its live entries, among the first count entries of the chunk.
+    static void updateBlockBounds(Chunk& chunk, size_t block, size_t count);
+
+    /// @brief Recomputes the bounds of a chunk from the bounds of its blocks.
+    static void updateChunkBounds(Chunk& chunk);
+
+    /// @brief Replaces the storage, retiring the old one. The mutex must be held.
+    void publish(Storage* storage);
+
+    /// @brief Copies the entries into a new storage with room for at least the given number of entries, either sharing
+    /// the chunks or compacting the live entries into new ones. The mutex must be held.
+    void rebuild(size_t capacity, bool compact);
+
+    std::atomic<Storage*> storage_;
+    std::atomic<size_t> live_;
+    size_t removed_;
+    std::atomic<std::uint64_t> removals_;  // Number of removals since the bucket was created, to number them
+    std::uint64_t nextId_;
+    std::mutex mutex_;
+};
+
+template<typename Predicate>
+bool ArchiveBucket::Snapshot::findInSuperBlock(
+        size_t superBlock, const BoardSignature& target, Dominance dominance, Predicate&& predicate) const {
+
+    const Chunk& chunk = *this->storage_->chunks[superBlock];
+    if (!mayContain(chunk.bounds, target, dominance)) return false;
+
+    size_t count = std::min(CHUNK_SIZE, this->size_ - superBlock * CHUNK_SIZE);
+    for (size_t begin = 0; begin < count; begin += BLOCK_SIZE) {
+        if (!mayContain(chunk.blockBounds[begin / BLOCK_SIZE], target, dominance)) continue;
+
+        for (size_t i = begin; i < std::min(begin + BLOCK_SIZE, count); i++) {
+            if (chunk.removed[i].load(std::memory_order_relaxed)) continue;
+            if (predicate(chunk.entries[i])) return true;
+        }
+    }
+    return false;
+}
+
+template<typename Predicate>
+bool ArchiveBucket::Snapshot::forEach(Predicate&& predicate, std::uint64_t firstId) const {
+    // Ids increase with the position, so the first entry to visit can be binary searched
+    size_t lo = 0, hi = this->size_;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (this->at(mid).id < firstId) lo = mid + 1;
+        else hi = mid;
+    }
+
+    for (size_t i = lo; i < this->size_; i++) {
+        const Chunk& chunk = *this->storage_->chunks[i / CHUNK_SIZE];
+        if (chunk.removed[i % CHUNK_SIZE].load(std::memory_order_relaxed)) continue;
+        if (predicate(chunk.entries[i % CHUNK_SIZE])) return true;
+    }
+    return false;
+}
+
+template<typename Predicate>
+bool ArchiveBucket::SharedSnapshot::forEach(Predicate&& predicate) const {
+    for (size_t i = 0; i < this->size_; i++) {
+        const Chunk& chunk = *this->chunks_[i / CHUNK_SIZE];
+        std::uint64_t removal = chunk.removed[i % CHUNK_SIZE].load(std::memory_order_relaxed);
+        if (removal && removal <= this->removals_) continue;
+        if (predicate(chunk.entries[i % CHUNK_SIZE])) return true;
+    }
+    return false;
+}
+
+#endif // ARCHIVE_BUCKET_H
@@ -0,0 +1,273 @@
+/**
+ * @file archive_file.h
+ * @brief The file formats the archive is saved in: human-readable text for interchange, and a compact binary format for
+ * large archives.
+ *
+ * A binary file starts with a BinaryArchiveHeader, followed by the chips of every board packed in rows of n * k bytes,
+ * in the layout of Board::getChips(). The boards are grouped by ascending number of chips, and the header records where
+ * each group starts, so a reader can load or skip whole buckets without parsing the boards.
+ */
+
+#ifndef ARCHIVE_FILE_H
+#define ARCHIVE_FILE_H
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <span>
+#include <string>
+#include <vector>
+#include "board.h"
+#include "json.hpp"
+
+/// @brief The format of an archive file.
+enum class ArchiveFormat { TEXT, BINARY };
+
+/**
+ * @brief Parses the name of a format, as given in the configuration file.
+ * @param name Either "text" or "binary".
+ *
+ * Throws std::invalid_argument for any other name.
+ */
+ArchiveFormat parseArchiveFormat(const std::string& name);
+
+/// @return The file extension of the format, including the dot.
+std::string getExtension(ArchiveFormat format);
+
+/**
+ * @brief The header of a binary archive file, stored as is at the start of the file.
+ *
+ * All fields are in the byte order of the machine that wrote the file, which readers check through byteOrderMark.
+ */
+struct BinaryArchiveHeader {
+    static constexpr std::array<char, 8> MAGIC = { 'I', 'M', 'L', 'A', 'R', 'C', 'H', '\0' };
+    /// @brief Bumped whenever the layout changes. Readers reject files of any other version.
+    static constexpr std::uint32_t VERSION = 1;
+    static constexpr std::uint32_t BYTE_ORDER_MARK = 0x01020304;
+    /// @brief Goal recorded by archives that don't know the goal of their boards.
+    static constexpr std::int32_t UNKNOWN_GOAL = -1;
+
+    std::array<char, 8> magic = MAGIC;
+    std::uint32_t version = VERSION;
+    std::uint32_t byteOrderMark = BYTE_ORDER_MARK;
+    std::uint32_t n = 0, k = 0;
+    std::int32_t goal = UNKNOWN_GOAL;
+    /// @brief Size of a packed board in bytes, i.e. n * k.
+    std::uint32_t rowSize = 0;
+    std::uint64_t numBoards = 0;
+    /// @brief The boards with c chips are the ones with an index in [bucketOffsets[c], bucketOffsets[c + 1]).
+    std::array<std::uint64_t, Board::MAX_CHIPS + 2> bucketOffsets{};
+
+    /**
+     * @brief Checks that the header describes a binary archive this program can read.
+     * @param fileSize Size of the whole file in bytes, which must match the number of boards.
+     *
+     * Throws std::runtime_error describing the first problem found.
+     */
+    void validate(std::uintmax_t fileSize) const;
+};
+
+/// @return Whether the file starts with the magic of a binary archive.
+bool isBinaryArchive(const std::filesystem::path& filename);
+
+/**
+ * @return The file a new version of the given file is written to before it replaces it, in the same directory so it
+ * can be renamed into place.
+ */
+std::filesystem::path getTemporaryFilename(const std::filesystem::path& filename);
+
+/**
+ * @brief Flushes a file or a directory to disk, so its contents or its entries survive a crash.
+ * @param path The file or directory. An empty path is the current directory.
+ *
+ * Does nothing on Windows, or if the path cannot be opened.
+ */
+void syncToDisk(const std::filesystem::path& path) noexcept;
+
+/**
+ * @brief Flushes a completely written temporary file to disk and renames it over the given file.
+ *
+ * The rename is atomic, so readers and a crash at any point see either the previous file or the new one, never a
+ * partially written file. The directory is flushed after the rename, so the new file is still there after a crash once
+ * this returns. Throws std::runtime_error if the file cannot be renamed.
+ */
+void replaceFile(const std::filesystem::path& temporaryFilename, const std::filesystem::path& filename);
+
+/**
+ * @brief Writes a JSON document to a file, creating its directory if needed.
+ *
+ * The document is written under getTemporaryFilename() and moved into place with replaceFile(), so an existing file
+ * is never lost. Throws std::runtime_error if the file cannot be written.
+ */
+void saveJsonFile(const nlohmann::json& json, const std::filesystem::path& filename);
+
+/**
+ * @class TextArchiveWriter
+ * @brief Writes a text archive file, one board at a time.
+ *
+ * The boards are formatted into a large buffer that is reused for the whole file, and written in large blocks. The file
+ * is written under getTemporaryFilename() and only replaces the file when closed, so an existing file is never lost.
+ */
+class TextArchiveWriter {
+public:
+    /**
+     * @brief Opens the file for writing.
+     *
+     * Throws std::runtime_error if the file cannot be opened.
+     */
+    explicit TextArchiveWriter(const std::filesystem::path& filename);
+
+    /// @brief Discards the written boards if the writer was not closed.
+    ~TextArchiveWriter();
+
+    TextArchiveWriter(const TextArchiveWriter&) = delete;
+    TextArchiveWriter& operator=(const TextArchiveWriter&) = delete;
+
+    /// @brief Appends a board, followed by the board delimiter.
+    void add(const Board& board);
+
+    /**
+     * @brief Writes the remaining boards, closes the file and moves it into place.
+     *
+     * Throws std::runtime_error if the file could not be written.
+     */
+    void close();
+
+private:
+    /// @brief Size of the buffer the boards are formatted in before being written.
+    static constexpr size_t BUFFER_SIZE = 1 << 20;
+    /// @brief An upper bound of the length of a formatted board and its delimiter.
+    static constexpr size_t MAX_BOARD_LENGTH = 64 + 5 * Board::MAX_CHIPS;
+
+    void flush();
+
+    std::filesystem::path filename_, temporaryFilename_;
+    std::ofstream file_;
+    std::string buffer_;
+};
+
+/**
+ * @class BinaryArchiveWriter
+ * @brief Writes a binary archive file, one board at a time.
+ *
+ * The boards are buffered and written in large blocks. The header is written last, once the bucket offsets are known.
+ * As with TextArchiveWriter, the file only replaces the existing one when closed.
+ */
+class BinaryArchiveWriter {
+public:
+    /**
+     * @brief Opens the file for writing.
+     * @param goal The goal recorded in the header.
+     *
+     * Throws std::runtime_error if the file cannot be opened.
+     */
+    BinaryArchiveWriter(const std::filesystem::path& filename, int goal);
+
+    /// @brief Discards the written boards if the writer was not closed.
+    ~BinaryArchiveWriter();
+
+    BinaryArchiveWriter(const BinaryArchiveWriter&) = delete;
+    BinaryArchiveWriter& operator=(const BinaryArchiveWriter&) = delete;
+
+    /**
+     * @brief Appends a board.
+     *
+     * The boards must come in ascending number of chips and all have the size of the first one. Throws
+     * std::invalid_argument otherwise.
+     */
+    void add(const Board& board);
+
+    /**
+     * @brief Writes the remaining boards and the header, and closes the file.
+     *
+     * Throws std::runtime_error if the file could not be written.
+     */
+    void close();
+
+private:
+    /// @brief Size of the buffer the rows are collected in before being written.
+    static constexpr size_t BUFFER_SIZE = 1 << 20;
+
+    void flush();
+
+    std::filesystem::path filename_, temporaryFilename_;
+    std::ofstream file_;
+    BinaryArchiveHeader header_;
+    std::vector<char> buffer_;
+    size_t numChips_;
+};
+
+/**
+ * @brief An archive file loaded into memory as a whole, in the layout of the binary format.
+ */
+struct BinaryArchive {
+    BinaryArchiveHeader header;
+    /// @brief The packed rows of all boards.
+    std::vector<Chip> chips;
+
+    /// @return The chips of the board with the given index.
+    [[nodiscard]] std::span<const Chip> getRow(size_t i) const noexcept;
+
+    /// @return The board with the given index.
+    [[nodiscard]] Board getBoard(size_t i) const;
+};
+
+/**
+ * @brief Loads a binary archive file with a single read.
+ *
+ * Throws std::runtime_error if the file cannot be read or is not a valid binary archive.
+ */
+BinaryArchive loadBinaryArchive(const std::filesystem::path& filename);
+
+/**
+ * @brief Loads a text archive file into the layout of a binary archive.
+ *
+ * The file is read in large blocks, which are split at delimiter lines into pieces parsed in parallel on the shared
+ * thread pool. The boards are grouped by number of chips, keeping the order of the file within each group. Text files
+ * don't record the goal, so the header has UNKNOWN_GOAL.
+ *
+ * Throws std::runtime_error if the file cannot be read or holds boards of different sizes, and std::invalid_argument if
+ * a board cannot be parsed.
+ */
+BinaryArchive loadTextArchive(const std::filesystem::path& filename);
+
+/// @brief Loads a text or binary archive file, whichever the file is.
+BinaryArchive loadArchiveFile(const std::filesystem::path& filename);
+
+/**
+ * @brief Checks that the boards of a file are solved for the given goal, reporting the file to stderr if not.
+ * @param goal The goal expected, or UNKNOWN_GOAL to accept any.
+ * @return Whether the boards can be used. Files that don't record their goal, such as text files, always can.
+ */
+bool isSavedForGoal(const BinaryArchiveHeader& header, int goal, const std::filesystem::path& filename);
+
+/**
+ * @brief Same as loadArchiveFile(), but a file that cannot be loaded or was saved for another goal is reported to
+ * stderr and skipped.
+ * @param goal The goal of the boards, as in isSavedForGoal().
+ * @return The boards of the file, or an empty archive if it is skipped.
+ */
+BinaryArchive loadArchiveFile(const std::filesystem::path& filename, int goal) noexcept;
+
+/**
+ * @brief Saves the boards of a loaded or snapshotted archive, creating the parent directories.
+ * @param format The format to save in. Text files don't record the goal of the header.
+ *
+ * The boards are written in the order of the archive, and the file only replaces an existing one once complete. Throws
+ * std::runtime_error if the file cannot be written.
+ */
+void saveArchiveFile(const BinaryArchive& archive, const std::filesystem::path& filename, ArchiveFormat format);
+
+/**
+ * @brief Loads several archive files as one, keeping a single copy of the boards found in more than one of them.
+ * @param goal The goal of the boards. Binary files saved for another goal are skipped.
+ *
+ * The files are loaded one at a time, each parsed in parallel on the shared thread pool, and merged into the boards of
+ * the previous ones bucket by bucket, so only the merged boards and a single file are in memory at once. Within a
+ * bucket, the boards are ordered by their packed chips. Files that cannot be loaded or hold boards of another size than
+ * the first file are reported and skipped, the same as when loading an Archive.
+ */
+BinaryArchive mergeArchiveFiles(const std::vector<std::filesystem::path>& filenames, int goal);
+
+#endif // ARCHIVE_FILE_H
@@ -0,0 +1,144 @@
+/**
+ * @file archive_journal.h
+ * @brief An append-only journal of the changes to an archive, so a checkpoint costs as much as the boards found since
+ * the previous one instead of the whole archive.
+ *
+ * The journal is a directory of generation files, numbered from 1. Each file starts with an ArchiveJournal::Header,
+ * followed by records of one RecordType byte, the n * k chips of a board, in the layout of Board::getChips(), and a
+ * 32-bit checksum of both. A checkpoint only flushes the current generation to disk. Once the journal holds more records
+ * than the archive has boards, it is compacted: a new generation is started, a snapshot of the archive is saved as the
+ * base, and the generations before the new one are deleted. Loading replays the remaining generations on top of the
+ * base.
+ */
+
+#ifndef ARCHIVE_JOURNAL_H
+#define ARCHIVE_JOURNAL_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <vector>
+#include "archive_file.h"
+#include "board.h"
+
+class ArchiveJournal {
+public:
+    /// @brief The change recorded by a record.
+    enum class RecordType : std::uint8_t { ADD_WINNING, ADD_LOSING, REMOVE_WINNING, REMOVE_LOSING };
+
+    /// @brief The header of a generation file, stored as is at the start of the file.
+    struct Header {
+        static constexpr std::array<char, 8> MAGIC = { 'I', 'M', 'L', 'J', 'R', 'N', 'L', '\0' };
+        /// @brief Bumped whenever the layout changes. Readers reject files of any other version.
+        static constexpr std::uint32_t VERSION = 2;
+
+        std::array<char, 8> magic = MAGIC;
+        std::uint32_t version = VERSION;
+        std::uint32_t byteOrderMark = BinaryArchiveHeader::BYTE_ORDER_MARK;
+        std::uint32_t n = 0, k = 0;
+        std::int32_t goal = BinaryArchiveHeader::UNKNOWN_GOAL;
+        std::uint32_t rowSize = 0;
+    };
+
+    /**
+     * @brief Starts a new generation after the ones already in the directory, creating the directory if needed.
+     * @param n, k The size of the boards.
+     * @param goal The goal the boards are solved for.
+     *
+     * Throws std::runtime_error if the generation file cannot be created.
+     */
+    ArchiveJournal(const std::filesystem::path& directory, size_t n, size_t k, int goal);
+
+    /// @brief Flushes the records still in the buffer.
+    ~ArchiveJournal();
+
+    ArchiveJournal(const ArchiveJournal&) = delete;
+    ArchiveJournal& operator=(const ArchiveJournal&) = delete;
+
+    /**
+     * @brief Appends a record. Safe to call from several threads.
+     *
+     * The records are buffered, and written when the buffer is full or flushed. A full buffer is swapped with an empty
+     * one and written after the lock is released, so the other threads keep appending meanwhile. A write error is
+     * reported once, after which the records are dropped.
+     */
+    void append(RecordType type, const Board& board) noexcept;
+
+    /// @brief Writes the buffered records to the current generation file and waits for them to reach the disk.
+    void flush() noexcept;
+
+    /**
+     * @brief Starts a new generation, for a compaction.
+     * @return The last generation before the new one. Its records and those of the previous generations are in any
+     * snapshot of the archive taken after this call, so those generations can be removed once the snapshot is saved.
+     */
+    std::uint64_t rotate();
+
+    /// @brief Deletes the generation files up to the given one. Safe to call while records are appended.
+    void removeGenerations(std::uint64_t lastGeneration) const;
+
+    /// @return The number of records appended since the journal was opened or last rotated.
+    [[nodiscard]] size_t countRecords() const noexcept;
+
+    /// @return The generation files in the directory, in the order they were written.
+    static std::vector<std::filesystem::path> findGenerations(const std::filesystem::path& directory);
+
+    /**
+     * @brief Applies the records of every generation in the directory to the boards of a base snapshot.
+     * @param winning, losing The boards of the base, replaced by the boards after the records. Either may be empty.
+     * @param goal The goal the boards are solved for. Generations written for another goal are skipped.
+     * @return The number of records applied.
+     *
+     * A board added again while already in the boards is ignored, and so is the removal of a board that is not in
+     * them. The boards stay in the order they were first added, grouped by number of chips. A generation cut short by
+     * a crash is replayed up to its last valid record: the first record that is incomplete, has an unknown type or does
+     * not match its checksum ends the generation.
+     */
+    static size_t replay(const std::filesystem::path& directory, BinaryArchive& winning, BinaryArchive& losing, int goal);
+
+private:
+    /// @brief Size of the buffer the records are collected in before being written.
+    static constexpr size_t BUFFER_SIZE = 1 << 20;
+
+    /// @brief Size of the checksum at the end of each record.
+    static constexpr size_t CHECKSUM_SIZE = sizeof(std::uint32_t);
+
+    /// @return The file of a generation.
+    [[nodiscard]] std::filesystem::path getGenerationFilename(std::uint64_t generation) const;
+
+    /// @brief Creates the file of the next generation and writes its header. Both mutexes must be held.
+    void open();
+
+    /**
+     * @brief Swaps the buffer with the spare one, which is empty once written. The mutex must be held.
+     * @return The lock of the file mutex, to write the swapped records with write() after releasing the mutex. Taking
+     * it before releasing the mutex keeps the buffers in the order they were filled.
+     */
+    [[nodiscard]] std::unique_lock<std::mutex> swapBuffers();
+
+    /// @brief Flushes the current generation file to disk. The file mutex must be held.
+    void sync() noexcept;
+
+    /// @brief Writes the records of the spare buffer and empties it. The file mutex must be held.
+    void write() noexcept;
+
+    std::filesystem::path directory_;
+    Header header_;
+    size_t numRecords_;
+    std::atomic<bool> failed_;
+
+    // The records being appended, guarded by the mutex
+    std::vector<char> buffer_;
+    mutable std::mutex mutex_;
+
+    // The file and the records being written to it, guarded by the file mutex
+    std::uint64_t generation_;
+    std::ofstream file_;
+    std::vector<char> spare_;
+    std::mutex fileMutex_;
+};
+
+#endif // ARCHIVE_JOURNAL_H
@@ -0,0 +1,112 @@
+/**
+ * @file archive_view.h
+ * @brief A read-only view of the boards of a single archive file, queried in place.
+ *
+ * Binary files are memory-mapped, so the boards are never copied into Board objects: a query compares the target
+ * with the packed rows of the file directly, and several processes viewing the same file share its pages in the page
+ * cache. Text files have no packed rows to map, so they are converted into the binary layout in memory when opened.
+ *
+ * The rows of each chip-count bucket are grouped into blocks of BLOCK_SIZE rows, and the blocks into chunks of
+ * BLOCK_SIZE blocks, as in ArchiveBucket. The view keeps the position-wise minimum and maximum of the signatures of each
+ * block and chunk, so a query skips the groups that cannot hold a match. The rows of the remaining blocks are checked
+ * against summaries that need no sorting, and only the few that pass get a Board and a signature built. This index is
+ * computed from the packed rows in parallel when the view is opened, and is about the size of the rows.
+ */
+
+#ifndef ARCHIVE_VIEW_H
+#define ARCHIVE_VIEW_H
+
+#include <array>
+#include <filesystem>
+#include <span>
+#include <vector>
+#include "archive_file.h"
+#include "board_signature.h"
+#include "game_state.h"
+
+class ArchiveView {
+public:
+    /// @brief Number of rows per block, and number of blocks per chunk.
+    static constexpr size_t BLOCK_SIZE = 16;
+    static constexpr size_t CHUNK_SIZE = BLOCK_SIZE * BLOCK_SIZE;
+
+    /**
+     * @brief Opens an archive file.
+     * @param filename The text or binary archive file.
+     * @param winner The player the boards of the file are winning for: Player::PUSHER for a file of winning boards,
+     * Player::REMOVER for a file of losing boards.
+     * @param goal The goal the boards are checked for. A binary file saved for another goal is not opened.
+     *
+     * If the file does not exist or cannot be opened, the error is reported and the view is empty, the same as when
+     * loading an Archive. So is a binary file that lists a board with the boards of another number of chips.
+     */
+    ArchiveView(const std::filesystem::path& filename, Player winner, int goal = BinaryArchiveHeader::UNKNOWN_GOAL);
+
+    ~ArchiveView();
+
+    ArchiveView(const ArchiveView&) = delete;
+    ArchiveView& operator=(const ArchiveView&) = delete;
+
+    /**
+     * @brief Predict the winner of the game based on the boards of the file.
+     * @param gameState The game state to predict.
+     * @param threads The number of threads to use.
+     * @return The winner of the file if the board of the game state is greater than or equal to a winning board (or
+     * less than or equal to a losing board), the winner of the game if it is already finished, and Player::NONE
+     * otherwise. The same as Archive::predictWinner() with an archive holding only the boards of the file.
+     */
+    [[nodiscard]] Player predictWinner(const GameState& gameState, size_t threads = 32) const noexcept;
+
+    /// @return The number of boards.
+    [[nodiscard]] size_t size() const noexcept;
+
+    /// @return The chips of the board with the given index, in the layout of Board::getChips(). Boards are ordered by
+    /// ascending number of chips.
+    [[nodiscard]] std::span<const Chip> getRow(size_t i) const noexcept;
+
+    /// @return A copy of the board with the given index.
+    [[nodiscard]] Board getBoard(size_t i) const;
+
+    /// @return The header of the file, or of the converted file for a text file.
+    [[nodiscard]] const BinaryArchiveHeader& getHeader() const noexcept;
+
+private:
+    /// @brief The position-wise minimum and maximum of the signatures of a group of rows.
+    struct Bounds {
+        BoardSignature min, max;
+    };
+
+    /// @brief A run of at most CHUNK_SIZE rows of the same bucket.
+    struct Chunk {
+        size_t begin, end;
+        size_t numChips;
+        Bounds bounds;
+        /// @brief Index of the bounds of the first block of the chunk in blocks_.
+        size_t firstBlock;
+    };
+
+    /// @brief Whether a group with the given bounds may hold a board below (or above) the target.
+    [[nodiscard]] bool mayContain(const Bounds& bounds, const BoardSignature& target) const noexcept;
+
+    /// @brief Maps a binary file, or loads it into memory where mapping is not supported.
+    void map(const std::filesystem::path& filename);
+
+    /// @brief Computes the bounds of the chunks of every bucket. Throws std::runtime_error if a row is in the wrong bucket.
+    void buildIndex();
+
+    BinaryArchiveHeader header_;
+    Player winner_;
+
+    /// @brief The packed rows, either in the mapping or in owned_.
+    const Chip* rows_;
+    void* mapping_;
+    size_t mappingSize_;
+    std::vector<Chip> owned_;
+
+    /// @brief The chunks of bucket c are the ones with an index in [firstChunk_[c], firstChunk_[c + 1]).
+    std::vector<Chunk> chunks_;
+    std::vector<Bounds> blocks_;
+    std::array<size_t, Board::MAX_CHIPS + 2> firstChunk_;
+};
+
+#endif // ARCHIVE_VIEW_H
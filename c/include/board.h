@@ -6,7 +6,11 @@
 #ifndef BOARD_H
 #define BOARD_H
 
+#include <array>
+#include <cstdint>
+#include <span>
 #include <string>
+#include <string_view>
 #include <vector>
 
 enum class Player {
@@ -20,8 +24,20 @@ using RemoverMove = size_t;
 using ColumnState = std::vector<int>;
 using BoardState = std::vector<ColumnState>;
 
+/// @brief The row of a single chip. Removed chips are stored as -1.
+using Chip = std::int8_t;
+/// @brief Read-only view of the k chips in a single column, sorted from largest to smallest.
+using ColumnView = std::span<const Chip>;
+
 class Board {
 public:
+    /**
+     * @brief The maximum number of chips (n * k) a board can hold.
+     *
+     * Chosen so that the moved flags of all chips fit in a single 64-bit mask.
+     */
+    static constexpr size_t MAX_CHIPS = 64;
+
     // Constructors
     /**
      * @brief Default constructor.
@@ -39,6 +55,8 @@ public:
      *
      * Initializes the board with the specified size. All chips are at row 0.
      *
+     * Throws std::invalid_argument if n * k exceeds MAX_CHIPS.
+     *
      * Time complexity: O(nk).
      */
     Board(size_t n, size_t k);
@@ -49,7 +67,10 @@ public:
      * @param k Number of chips per column.
      * @param boardState The initial board state.
      *
-     * Initializes the board with the specified size and initial board state.
+     * Initializes the board with the specified size and initial board state. Missing columns or chips in `boardState`
+     * are treated as removed chips.
+     *
+     * Throws std::invalid_argument if n * k exceeds MAX_CHIPS or a row doesn't fit in a Chip.
      *
      * Time complexity: O(nk).
      */
@@ -64,19 +85,38 @@ public:
      *
      * Initializes the board with the specified size, initial board state, and which chips are already moved.
      *
+     * Throws std::invalid_argument if n * k exceeds MAX_CHIPS or a row doesn't fit in a Chip.
+     *
      * Time complexity: O(nk).
      */
     Board(size_t n, size_t k, BoardState boardState, std::vector<std::vector<bool>> chipIsMoved);
 
+    /**
+     * @brief Constructor with size and packed chips.
+     * @param n Number of columns.
+     * @param k Number of chips per column.
+     * @param chips The n * k chips, column by column, in the layout returned by getChips().
+     *
+     * Used to load boards from binary files without going through BoardState. Each column must already be sorted.
+     *
+     * Throws std::invalid_argument if n * k exceeds MAX_CHIPS or doesn't match the number of chips.
+     *
+     * Time complexity: O(nk).
+     */
+    Board(size_t n, size_t k, std::span<const Chip> chips);
+
     /**
      * @brief Constructor with board string.
-     * @param boardString The string representation of the board.
+     * @param boardString The string representation of the board, in the format of toString().
      *
-     * Initializes the board with the specified string representation.
+     * Initializes the board with the specified string representation. The number of chips is counted instead of taken
+     * from the first line.
+     *
+     * Throws std::invalid_argument if the string is not a valid board, including rows that don't fit in a Chip.
      *
      * Time complexity: O(nk).
      */
-    explicit Board(const std::string& boardString);
+    explicit Board(std::string_view boardString);
 
     // Methods
     /**
@@ -97,6 +137,14 @@ public:
      */
     [[nodiscard]] std::string toString() const noexcept;
 
+    /**
+     * @brief Appends the string representation of toString() to a string.
+     * @param out The string to append to. Nothing is allocated if it has enough capacity left.
+     *
+     * Time complexity: O(nk).
+     */
+    void appendTo(std::string& out) const;
+
     /**
      * @return The maximum row of the board.
      *
@@ -110,10 +158,9 @@ public:
     /**
      * @return Whether the current player is the Pusher or Remover.
      *
-     * Goes through the entire list of chips. If at least one chip is moved, then the current player is the Remover.
-     * Otherwise it is the Pusher.
+     * If at least one chip is moved, then the current player is the Remover. Otherwise it is the Pusher.
      *
-     * Time complexity: O(nk).
+     * Time complexity: O(1).
      */
     [[nodiscard]] Player calcCurrentPlayer() const noexcept;
 
@@ -133,9 +180,10 @@ public:
      * @return Whether the move contains at least one valid chip.
      *
      * The move is applied to the board in-place. Each item in the list is a single integer representing a chip on the
-     * board. For a chip in column c and with index i, the corresponding integer is c * k + i.
+     * board. For a chip in column c and with index i, the corresponding integer is c * k + i. Only the columns that
+     * contain a pushed chip are re-sorted.
      *
-     * Time complexity: O(|move|).
+     * Time complexity: O(|move| + k^2 * (number of touched columns)).
      */
     bool apply(const PusherMove& move);
 
@@ -150,6 +198,29 @@ public:
      */
     bool apply(RemoverMove move);
 
+    /**
+     * @brief Moves every chip that is marked as moved back down by one row, and clears all moved flags.
+     *
+     * Columns are not sorted afterward, which matches constructing a new board from the restored rows.
+     *
+     * Time complexity: O(nk).
+     */
+    void undoPusherMove() noexcept;
+
+    /**
+     * @brief Sorts the columns into a fixed order, so that boards which only differ by a column permutation become equal.
+     *
+     * Columns are ordered from largest to smallest lexicographically by their chips, and then by their moved flags. The
+     * moved flags follow their columns. Column order does not matter to the game, so the board is equivalent before and
+     * after this call.
+     *
+     * Time complexity: O(n^2 k).
+     */
+    void canonicalize() noexcept;
+
+    /// @brief Two boards are equal if they have the same size, chips, and moved flags, in the same column order.
+    bool operator==(const Board& other) const noexcept = default;
+
     // Getters (All with time complexity O(1))
     /// @brief Get the number of columns.
     [[nodiscard]] size_t getN() const noexcept;
@@ -157,28 +228,31 @@ public:
     [[nodiscard]] size_t getK() const noexcept;
     /// @brief Get the number of chips on the board.
     [[nodiscard]] size_t getNumChips() const noexcept;
-    /// @brief Get the board state.
-    [[nodiscard]] const BoardState& getBoardState() const noexcept;
+    /// @brief Get a copy of the board state. Time complexity: O(nk). Prefer getColumn() in hot paths.
+    [[nodiscard]] BoardState getBoardState() const noexcept;
+    /// @brief Get a view of all n * k chips, column by column.
+    [[nodiscard]] std::span<const Chip> getChips() const noexcept;
+    /// @brief Get a view of the chips in the specified column.
+    [[nodiscard]] ColumnView getColumn(size_t c) const noexcept;
     /// @brief Get the row of the chip at the specified column and index.
     [[nodiscard]] int getChipRow(size_t c, size_t idx) const noexcept;
     /// @brief Check if the chip has been moved by the Pusher in the previous turn.
     [[nodiscard]] bool chipIsMoved(size_t c, size_t idx) const noexcept;
+    /// @brief Get the moved flags of the specified column, where bit idx belongs to the chip with index idx.
+    [[nodiscard]] std::uint64_t getColumnMoved(size_t c) const noexcept;
 
 private:
-    /**
-     * @brief Sort the chips in each column from largest to smallest.
-     *
-     * This function is automatically called after each move to ensure the board is in a consistent state.
-     *
-     * Time complexity: O(nk log(k)).
-     */
-    void tidy() noexcept;
-
     /**
      * @brief Sort the chips in the specified column from largest to smallest.
      * @param c The column to sort.
      *
-     * Time complexity: O(k log(k)).
+     * This function is automatically called after each move on the columns the move touched, to ensure the board is in
+     * a consistent state.
+     *
+     * Uses the sort kernel for k, which is a sorting network for the specialized values of k. Chips with the same row
+     * are ordered moved-first.
+     *
+     * Time complexity: O(k^2).
      */
     void tidy(size_t c) noexcept;
 
@@ -195,19 +269,21 @@ private:
     /**
      * @brief The board state.
      *
-     * The board is represented as a 2D vector of integers. The first dimension represents the column, and the second
-     * dimension represents the index of the chip in that column. The integer value represents the row of the chip.
+     * The chips are stored in a single inline buffer, column by column: the chip in column c with index idx is stored at
+     * c * k + idx, which is also the encoded chip index used by PusherMove. The value represents the row of the chip.
+     * Entries past n * k are always 0, so copying a board is a single fixed-size copy without any heap allocation.
      *
      * Each column is sorted in descending order. Therefore the indices of the chips can change during the game.
      */
-    BoardState boardState_;
+    std::array<Chip, MAX_CHIPS> chips_;
 
     /**
      * @brief Represents if a chip has been moved by the Pusher in the previous turn.
      *
-     * Thus if at least one chip is moved, then the current player is the Remover.
+     * Bit c * k + idx is set if the chip in column c with index idx is moved. Thus if at least one chip is moved (i.e.
+     * the mask is non-zero), then the current player is the Remover.
      */
-    std::vector<std::vector<bool>> chipIsMoved_;
+    std::uint64_t chipIsMoved_;
 };
 
 #endif // BOARD_H
@@ -0,0 +1,72 @@
+/**
+ * @file board_signature.h
+ * @brief Precomputed summaries of a board that rule out most comparisons before any matching work.
+ *
+ * If board A is less than or equal to board B, there is a matching of the columns in which every chip of A is at most
+ * the chip at the same index of its partner column in B. Each summary below is monotone under such a matching, so if a
+ * summary of A exceeds the one of B at any position, A cannot be less than B. None of them relies on the columns being
+ * sorted, so they are also valid for boards returned by GameState::getBoardWithoutMovedChips().
+ */
+
+#ifndef BOARD_SIGNATURE_H
+#define BOARD_SIGNATURE_H
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include "board.h"
+
+struct BoardSignature {
+    /// @brief Number of rows covered by the histogram. Chips on higher rows only count towards the last entry.
+    static constexpr size_t HISTOGRAM_ROWS = 16;
+
+    /// @brief rowCounts[r] is the number of chips on row r or above.
+    std::array<std::uint8_t, HISTOGRAM_ROWS> rowCounts;
+
+    /**
+     * @brief The i-th chips of all columns, sorted from largest to smallest, for each i.
+     *
+     * ranks[i * n + j] is the j-th largest i-th chip. Entry i = 0 is the sorted top vector. Unused entries are 0.
+     */
+    std::array<Chip, Board::MAX_CHIPS> ranks;
+
+    /// @brief The sum of (row + 1) of the chips in each column, sorted from largest to smallest. Unused entries are 0.
+    std::array<std::int16_t, Board::MAX_CHIPS> columnCodes;
+
+    /// @brief Creates an empty signature.
+    BoardSignature() noexcept;
+
+    /**
+     * @brief Computes the signature of a board.
+     * @param board The board.
+     *
+     * Time complexity: O(n k log(n)).
+     */
+    explicit BoardSignature(const Board& board) noexcept;
+
+    /**
+     * @brief Computes the signature of a board from its packed chips, without building the board.
+     * @param n Number of columns.
+     * @param k Number of chips per column.
+     * @param chips The n * k chips, in the layout of Board::getChips().
+     *
+     * Time complexity: O(n k log(n)).
+     */
+    BoardSignature(size_t n, size_t k, std::span<const Chip> chips) noexcept;
+
+    /**
+     * @param other Another signature of the same board size.
+     * @return Whether every summary of this signature is at most the one of other, at every position.
+     *
+     * Necessary for the board of this signature to be less than or equal to the board of other.
+     */
+    [[nodiscard]] bool isBelow(const BoardSignature& other) const noexcept;
+
+    /// @brief Lowers every position to the one of other where other is smaller. Used to bound a group of signatures.
+    void expandMin(const BoardSignature& other) noexcept;
+
+    /// @brief Raises every position to the one of other where other is larger. Used to bound a group of signatures.
+    void expandMax(const BoardSignature& other) noexcept;
+};
+
+#endif // BOARD_SIGNATURE_H
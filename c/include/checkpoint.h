@@ -0,0 +1,47 @@
+/**
+ * @file checkpoint.h
+ * @brief Writes checkpoints of a running search on a background thread.
+ *
+ * A checkpoint is taken in two steps: the search thread takes a snapshot of what it needs to save (e.g.
+ * Archive::getWinningSnapshot()), which is cheap, and a CheckpointWriter copies, formats and writes it while the search
+ * goes on.
+ */
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <functional>
+#include <string>
+#include <thread>
+
+/**
+ * @class CheckpointWriter
+ * @brief Runs one checkpoint job at a time on a background thread, and logs when it is done and how long it took.
+ */
+class CheckpointWriter {
+public:
+    CheckpointWriter() noexcept = default;
+
+    /// @brief Waits for the running job, so no checkpoint is left half-written.
+    ~CheckpointWriter();
+
+    CheckpointWriter(const CheckpointWriter&) = delete;
+    CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+
+    /**
+     * @brief Starts a job on the background thread.
+     * @param name The name of the checkpoint, used when logging.
+     * @param job Writes the checkpoint from data it owns. Exceptions are reported and otherwise ignored.
+     *
+     * Waits for the previous job first, as two checkpoints written at the same time would compete for the disk.
+     */
+    void write(std::string name, std::function<void()> job);
+
+    /// @brief Waits for the running job, if any.
+    void wait();
+
+private:
+    std::thread thread_;
+};
+
+#endif // CHECKPOINT_H
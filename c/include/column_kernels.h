@@ -0,0 +1,160 @@
+/**
+ * @file column_kernels.h
+ * @brief Column operations specialized at compile time for the number of chips per column.
+ *
+ * Most hot loops of the board and the comparison code work on one column at a time. Since we only ever solve a handful
+ * of shapes, each operation is instantiated for k = 2, 3 and 4 with fully unrolled loops, and a generic version handles
+ * every other k. The code that does not run often looks the kernels up at runtime with getColumnKernels().
+ *
+ * The hot paths, such as Board::tidy() or the column graph of compareBoards(), instead call the templates of the
+ * column_kernels namespace, dispatched on k with dispatchOnK(), so the kernel is inlined rather than called through a
+ * pointer.
+ */
+
+#ifndef COLUMN_KERNELS_H
+#define COLUMN_KERNELS_H
+
+#include <array>
+#include <cstdint>
+#include <utility>
+#include "compare.h"
+#include "hash.h"
+
+namespace column_kernels {
+    /**
+     * @brief Calls f(i) for every chip index of a column.
+     * @tparam K Number of chips per column, or 0 if it is only known at runtime.
+     * @param k Number of chips per column. Only used if K is 0.
+     *
+     * Fully unrolled when K is known at compile time, otherwise a plain loop over the runtime k.
+     */
+    template<size_t K, typename F>
+    inline void forEachChip(size_t k, F&& f) {
+        if constexpr (K == 0) {
+            for (size_t i = 0; i < k; i++) f(i);
+        } else {
+            (void)k;
+            [&]<size_t... I>(std::index_sequence<I...>) { (f(I), ...); }(std::make_index_sequence<K>{});
+        }
+    }
+
+    /// @brief Same as compareSortedCols(), for K chips per column, or the runtime k if K is 0.
+    template<size_t K>
+    inline CompResult compareColumns(const Chip* col1, const Chip* col2, size_t k) noexcept {
+        bool col1IsLess = true, col2IsLess = true;
+        forEachChip<K>(k, [&](size_t i) {
+            // Compare i-th element
+            if (col1[i] > col2[i]) col1IsLess = false;
+            if (col2[i] > col1[i]) col2IsLess = false;
+        });
+
+        if (col1IsLess && col2IsLess) return CompResult::EQUAL;
+        else if (col1IsLess) return CompResult::LESS;
+        else if (col2IsLess) return CompResult::GREATER;
+        else return CompResult::INCOMPARABLE;
+    }
+
+    // Order two sort keys from largest to smallest
+    inline void compareExchange(int& a, int& b) {
+        if (a < b) std::swap(a, b);
+    }
+
+    /// @brief Same as ColumnKernels::sort, for K chips per column, or the runtime k if K is 0.
+    template<size_t K>
+    inline void sortColumn(Chip* column, std::uint64_t& moved, size_t k) noexcept {
+        // Bind each chip to its moved flag. Moved chips are larger than unmoved chips on the same row.
+        std::array<int, K ? K : Board::MAX_CHIPS> keys;
+        forEachChip<K>(k, [&](size_t i) {
+            keys[i] = column[i] * 2 + (int)((moved >> i) & 1);
+        });
+
+        // Sort the keys in descending order
+        if constexpr (K == 2) {
+            compareExchange(keys[0], keys[1]);
+        } else if constexpr (K == 3) {
+            compareExchange(keys[0], keys[1]);
+            compareExchange(keys[1], keys[2]);
+            compareExchange(keys[0], keys[1]);
+        } else if constexpr (K == 4) {
+            compareExchange(keys[0], keys[1]);
+            compareExchange(keys[2], keys[3]);
+            compareExchange(keys[0], keys[2]);
+            compareExchange(keys[1], keys[3]);
+            compareExchange(keys[1], keys[2]);
+        } else {
+            // Insertion sort for the generic kernel
+            for (size_t i = 1; i < k; i++) {
+                int key = keys[i];
+                size_t j = i;
+                for (; j > 0 && keys[j - 1] < key; j--) {
+                    keys[j] = keys[j - 1];
+                }
+                keys[j] = key;
+            }
+        }
+
+        // Unpack the keys
+        moved = 0;
+        forEachChip<K>(k, [&](size_t i) {
+            column[i] = static_cast<Chip>(keys[i] >> 1);
+            moved |= (std::uint64_t)(keys[i] & 1) << i;
+        });
+    }
+}
+
+struct ColumnKernels {
+    /// @brief The number of chips per column these kernels are specialized for, or 0 for the generic kernels.
+    size_t k;
+
+    /**
+     * @brief Sort a column from largest to smallest. Chips on the same row are ordered moved-first.
+     * @param column Pointer to the first chip of the column.
+     * @param moved Moved flags of the column, where bit i belongs to column[i]. Reordered together with the chips.
+     * @param k Number of chips per column. Only used by the generic kernels.
+     */
+    void (*sort)(Chip* column, std::uint64_t& moved, size_t k) noexcept;
+
+    /**
+     * @brief Same as compareSortedCols().
+     * @param col1 Pointer to the first chip of the first column.
+     * @param col2 Pointer to the first chip of the second column.
+     * @param k Number of chips per column. Only used by the generic kernels.
+     */
+    CompResult (*compare)(const Chip* col1, const Chip* col2, size_t k) noexcept;
+
+    /**
+     * @brief Same as encodeColState().
+     * @param column Pointer to the first chip of the column.
+     * @param k Number of chips per column. Only used by the generic kernels.
+     * @param goal An upper bound on the row number of each chip.
+     */
+    EncodedColumnState (*encode)(const Chip* column, size_t k, int goal) noexcept;
+};
+
+/**
+ * @param k Number of chips per column.
+ * @return The kernels specialized for k, or the generic kernels if k has no specialization.
+ */
+const ColumnKernels& getColumnKernels(size_t k) noexcept;
+
+/**
+ * @brief Calls `f.template operator()<K>()` with K the specialization for k, or 0 if k has no specialization.
+ * @param k Number of chips per column.
+ * @param f A callable templated on K, typically a lambda with a `template<size_t K>` parameter list.
+ * @return What f returns.
+ */
+template<typename F>
+inline decltype(auto) dispatchOnK(size_t k, F&& f) {
+    switch (k) {
+        case 2:
+            return f.template operator()<2>();
+        case 3:
+            return f.template operator()<3>();
+        case 4:
+            return f.template operator()<4>();
+        default:
+            return f.template operator()<0>();
+    }
+}
+
+#endif // COLUMN_KERNELS_H
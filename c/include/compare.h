@@ -4,6 +4,7 @@
 #include <algorithm>
 #include <unordered_set>
 #include <vector>
+#include "board_signature.h"
 #include "game_state.h"
 
 /**
@@ -48,6 +49,9 @@ int checkHallsCondition(const std::vector<std::unordered_set<int>>& relation, in
  */
 CompResult compareSortedCols(const std::vector<int>& col1, const std::vector<int>& col2);
 
+/// @brief Same as compareSortedCols(), but for columns viewed directly on a board.
+CompResult compareSortedCols(ColumnView col1, ColumnView col2);
+
 /**
  * @brief Comparing two game states.
  * @param board1 First game state.
@@ -61,4 +65,53 @@ CompResult compareSortedCols(const std::vector<int>& col1, const std::vector<int
  */
 CompResult compareBoards(const Board& board1, const Board& board2, Purpose purpose = Purpose::BOTH);
 
+/**
+ * @brief Same as compareBoards(), but rules out dominance with the precomputed signatures of the boards first.
+ * @param board1 First game state.
+ * @param signature1 Signature of the first game state.
+ * @param board2 Second game state.
+ * @param signature2 Signature of the second game state.
+ * @param purpose Can be "GREATER", "LESS", or "BOTH".
+ * @return Compare result. Always the same as compareBoards(board1, board2, purpose).
+ *
+ * The filters run from cheapest to most expensive: chip counts, row histograms, rank vectors, then column codes. Only
+ * the comparisons that survive all of them build the column graph and run the matching.
+ */
+CompResult compareBoards(
+        const Board& board1, const BoardSignature& signature1, const Board& board2, const BoardSignature& signature2,
+        Purpose purpose = Purpose::BOTH);
+
+/**
+ * @brief How many calls of compareBoards() there were, and at which stage the calls with signatures were settled.
+ *
+ * Each call is counted exactly once: as `withoutSignatures` for the overload without signatures, as `bySize` if the
+ * boards differ in size or are empty, by the first filter that leaves neither direction possible, or as `matched` if it
+ * reached the matching.
+ */
+struct CompareStats {
+    size_t calls;
+    size_t withoutSignatures;
+    size_t bySize;
+    size_t byChipCount;
+    size_t byHistogram;
+    size_t byRanks;
+    size_t byColumnCodes;
+    size_t matched;
+    /// @brief One call in every few of each thread is timed, which estimates the time of all calls without slowing them
+    /// down.
+    size_t timedCalls;
+    size_t timedNanoseconds;
+
+    /// @return The estimated time spent in all calls, in seconds.
+    [[nodiscard]] double getEstimatedSeconds() const noexcept {
+        return timedCalls ? 1e-9 * (double)timedNanoseconds * (double)calls / (double)timedCalls : 0;
+    }
+};
+
+/// @return The counters summed over all threads since the start of the program or the last resetCompareStats().
+CompareStats getCompareStats() noexcept;
+
+/// @brief Sets all counters to 0. Must not run concurrently with compareBoards().
+void resetCompareStats() noexcept;
+
 #endif // COMPARE_H
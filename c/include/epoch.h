@@ -0,0 +1,83 @@
+/**
+ * @file epoch.h
+ * @brief Epoch-based reclamation for data structures with lock-free readers.
+ *
+ * A reader enters a critical section with an EpochManager::Guard before it loads a shared pointer, and may use whatever
+ * it loaded until the guard is destroyed. A writer that unlinks an object passes it to retire() instead of deleting it,
+ * and the object is only deleted once every reader that might still see it has left its critical section.
+ */
+
+#ifndef EPOCH_H
+#define EPOCH_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+class EpochManager {
+public:
+    /// @return The manager shared by the whole program. Never destroyed, so threads may exit in any order.
+    static EpochManager& getShared();
+
+    /**
+     * @class Guard
+     * @brief Marks the current thread as reading shared objects for the lifetime of the guard. Guards may be nested.
+     */
+    class Guard {
+    public:
+        Guard() noexcept;
+        ~Guard() noexcept;
+
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+    };
+
+    /**
+     * @brief Schedules the deletion of an object that is no longer reachable by new readers.
+     * @param deleter Deletes the object. Runs on some later call of retire() or reclaim(), or when a thread exits.
+     */
+    void retire(std::function<void()> deleter);
+
+    /// @brief Runs the deleters of all retired objects that no reader can still see.
+    void reclaim();
+
+    /// @return The number of retired objects not deleted yet.
+    [[nodiscard]] size_t getNumRetired();
+
+private:
+    EpochManager() noexcept;
+
+    /// @brief The epoch announced by one thread, or 0 if the thread is not reading.
+    struct alignas(64) Slot {
+        std::atomic<std::uint64_t> epoch = 0;
+        size_t depth = 0;
+    };
+
+    struct Retired {
+        std::uint64_t epoch;
+        std::function<void()> deleter;
+    };
+
+    /// @return The slot of the current thread, registering it on first use.
+    Slot& getSlot();
+
+    /// @brief Unregisters the slot of a thread that exits.
+    void release(Slot* slot);
+
+    /// @brief Same as reclaim(). The mutex must be held.
+    void reclaimLocked();
+
+    /// @brief Number of retired objects below which retire() doesn't try to reclaim them.
+    static constexpr size_t MIN_RECLAIM_THRESHOLD = 64;
+
+    std::atomic<std::uint64_t> epoch_;
+
+    std::mutex mutex_;
+    std::vector<Slot*> slots_;
+    std::vector<Retired> retired_;
+    size_t reclaimThreshold_;
+};
+
+#endif // EPOCH_H
@@ -1,15 +1,98 @@
 /**
  * @file graph.h
- * @brief This file contains the declaration of the Graph class and the Hopcroft-Karp function.
+ * @brief This file contains the declaration of the graph classes and the bipartite matching functions.
+ *
+ * CsrGraph is the graph used by the algorithms: integer vertices and a compact, immutable adjacency. Graph uses string
+ * labels and can be edited freely, which is convenient for tests and logging; its hopcroftKarp() overload converts it to
+ * a CsrGraph first.
  */
 
 #ifndef GRAPH_H
 #define GRAPH_H
 
+#include <array>
+#include <cstdint>
+#include <span>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
+/**
+ * @class CsrGraph
+ * @brief A simple unweighted directed graph with integer vertices, in compressed sparse row form.
+ *
+ * The vertices are 0 to countV() - 1. The neighbors of each vertex are stored sorted in one contiguous array, so the graph
+ * cannot be modified after construction.
+ */
+class CsrGraph {
+public:
+    using Vertex = std::uint32_t;
+
+    /// @brief Default constructor. Creates an empty graph.
+    CsrGraph() noexcept;
+
+    /**
+     * @brief Constructor with edges.
+     * @param numVertices Number of vertices.
+     * @param edges List of (start, end) pairs. Duplicates and edges with an invalid vertex are dropped.
+     *
+     * Time complexity: O(|V| + |E|log(|E|))
+     */
+    CsrGraph(size_t numVertices, std::vector<std::pair<Vertex, Vertex>> edges);
+
+    /**
+     * @return Number of vertices.
+     *
+     * Time complexity: O(1)
+     */
+    [[nodiscard]] size_t countV() const noexcept;
+
+    /**
+     * @return Number of edges.
+     *
+     * Time complexity: O(1)
+     */
+    [[nodiscard]] size_t countE() const noexcept;
+
+    /**
+     * @param start Start point of the edge.
+     * @param end End point of the edge.
+     * @return Whether the edge is in the graph.
+     *
+     * Time complexity: O(log(degree))
+     */
+    [[nodiscard]] bool hasEdge(Vertex start, Vertex end) const noexcept;
+
+    /**
+     * @param vertex Given vertex.
+     * @return Sorted neighbors of the given vertex, or an empty list for invalid vertices.
+     *
+     * Time complexity: O(1)
+     */
+    [[nodiscard]] std::span<const Vertex> getNeighbors(Vertex vertex) const noexcept;
+
+private:
+    /// @brief The neighbors of vertex v are targets_[offsets_[v]] to targets_[offsets_[v + 1] - 1].
+    std::vector<size_t> offsets_;
+    std::vector<Vertex> targets_;
+};
+
+/**
+ * @brief Buffers used by hopcroftKarp(). Reusing one across calls avoids allocating on every call.
+ */
+struct HopcroftKarpScratch {
+    /// @brief Vertex matched to each vertex, or NIL. Holds the maximum matching after hopcroftKarp() returns.
+    std::vector<CsrGraph::Vertex> match;
+    /// @brief BFS layer of each vertex in the first partition.
+    std::vector<CsrGraph::Vertex> distance;
+    /// @brief Position of the next neighbor to try for each vertex during the DFS.
+    std::vector<size_t> next;
+    std::vector<CsrGraph::Vertex> queue;
+    std::vector<CsrGraph::Vertex> stack;
+
+    static constexpr CsrGraph::Vertex NIL = UINT32_MAX;
+};
+
 /**
  * @class Graph
  * @brief A class for simple unweighted directed graphs.
@@ -149,8 +232,42 @@ private:
  *
  * Note this function will not validate the input.
  *
+ * Thin adapter: labels the vertices with integers and calls hopcroftKarp() on the equivalent CsrGraph.
+ *
  * Time complexity: O(|E|sqrt(|V|))
  */
 size_t hopcroftKarp(const Graph& graph, const std::unordered_map<std::string, int>& partition, int verbose = 0) noexcept;
 
+/**
+ * @param graph A bipartite graph. Only the edges starting from a vertex in the first partition are used.
+ * @param partition Partition group (0 or 1) of each vertex.
+ * @param scratch Buffers for the algorithm. Resized as needed, and holds the matching afterward.
+ * @return The maximum number of matching in the graph.
+ *
+ * Note this function will not validate the input.
+ *
+ * Time complexity: O(|E|sqrt(|V|))
+ */
+size_t hopcroftKarp(
+        const CsrGraph& graph, std::span<const std::uint8_t> partition, HopcroftKarpScratch& scratch) noexcept;
+
+/**
+ * @brief Adjacency matrix of a dense bipartite graph with at most 64 vertices on each side.
+ *
+ * Bit j of row i is set if left vertex i is connected to right vertex j.
+ */
+using BitMatrix = std::array<std::uint64_t, 64>;
+
+/**
+ * @param adjacency Adjacency matrix of the bipartite graph.
+ * @param n Number of vertices on each side. At most 64.
+ * @return Whether the graph has a perfect matching.
+ *
+ * Runs Kuhn's augmenting path algorithm, where each search step visits a whole row of neighbors with bit operations. The
+ * search stops at the first left vertex that cannot be matched. Uses a thread-local workspace and never allocates.
+ *
+ * Time complexity: O(n^3 / 64) in the worst case.
+ */
+bool hasPerfectMatching(const BitMatrix& adjacency, size_t n) noexcept;
+
 #endif // GRAPH_H
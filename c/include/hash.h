@@ -8,6 +8,7 @@
 #ifndef HASH_H
 #define HASH_H
 
+#include <cstdint>
 #include <string>
 #include <vector>
 #include "board.h"
@@ -44,6 +45,12 @@ using EncodedMove = size_t;
  */
 using EncodedColumnState = size_t;
 
+/**
+ * A board hash is a 64-bit hash of the canonical form of a board (see Board::canonicalize()). Boards that differ only by
+ * a column permutation have the same hash, so the hash can be used as the identity of a position.
+ */
+using BoardHash = std::uint64_t;
+
 /**
  * @brief Decode a number into a pusher move.
  * @param encoded The encoded move applied to a SINGLE COLUMN (does not include info on which column it operates on).
@@ -63,6 +70,20 @@ void decodeMove(EncodedMove encoded, PusherMove& decoded, size_t k, size_t col =
  */
 EncodedColumnState encodeColState(const ColumnState& column, int goal);
 
+/// @brief Same as encodeColState(), but for a column viewed directly on a board.
+EncodedColumnState encodeColState(ColumnView column, int goal);
+
+/**
+ * @brief Hash a board up to column permutation.
+ * @param board The board to hash. Does not need to be canonicalized.
+ * @param goal An upper bound on the row number of each chip, as in encodeColState().
+ * @return The hash of the canonical form of the board.
+ *
+ * Each column is encoded with encodeColState() together with its moved flags, and the mixed column codes are summed. The
+ * sum does not depend on the column order, so this runs in O(nk) without sorting the columns first.
+ */
+BoardHash hashBoard(const Board& board, int goal);
+
 /**
  * @brief Applies the encoded move to the column state in-place.
  * @param column The column to apply the move to.
@@ -70,6 +91,9 @@ EncodedColumnState encodeColState(const ColumnState& column, int goal);
  */
 void applyMoveToColumn(ColumnState& column, EncodedMove move);
 
+/// @brief Same as applyMoveToColumn(), but on a buffer of chips (e.g. a copy of Board::getColumn()).
+void applyMoveToColumn(std::span<Chip> column, EncodedMove move);
+
 /**
  * @brief Converts a move (on a column) into a bit string for logging.
  * @param move The move.
@@ -24,10 +24,12 @@ size_t countMovableChips(const std::vector<int>& column);
  * @param n Number of columns.
  * @param k Tokens in each column.
  * @param goal Target row to reach.
- * @param suffix Optional suffix to append to the file name (before the extension `.txt`).
+ * @param suffix Optional suffix to append to the file name (before the extension).
+ * @param extension Extension of the file name, including the dot.
  * @return The paths to the winning board and the losing board.
  */
-std::filesystem::path getFilename(size_t n, size_t k, int goal, const std::string& suffix = "");
+std::filesystem::path getFilename(
+        size_t n, size_t k, int goal, const std::string& suffix = "", const std::string& extension = ".txt");
 
 /// @return The current time in the format of "YYYY-mm-dd_HH-MM".
 std::string getCurrentTime();
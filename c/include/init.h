@@ -16,6 +16,9 @@
  * @brief Create the initial game state using the specified configurations.
  * @param config The configurations.
  * @return The initial game state.
+ *
+ * Nothing is dispatched on the shape here: Board::tidy() and compareBoards() select the column kernels for k on every
+ * call (see dispatchOnK()). Shapes without a specialization fall back to the generic kernels.
  */
 GameState initGameState(const nlohmann::json& config);
 
@@ -0,0 +1,35 @@
+/**
+ * @file metrics.h
+ * @brief Metrics of a search, saved as JSON to find its hot paths and compare runs across builds.
+ *
+ * The metrics gather the counters kept by the parts of the solver: the states visited and expanded at every depth
+ * (ProgressCounters), the queries, insertions and removals of the archive (ArchiveStats), the comparisons of boards
+ * (CompareStats) and the transposition table. All of them are safe to read while the search runs.
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <chrono>
+#include <filesystem>
+#include "archive.h"
+#include "game_state.h"
+#include "progress.h"
+#include "transposition_table.h"
+
+/// @return The file the metrics of the search of the given game are saved in.
+std::filesystem::path getMetricsFilename(size_t n, size_t k, int goal);
+
+/**
+ * @brief Saves the metrics of a search as JSON, replacing the file atomically.
+ * @param startingState The starting state of the search, which gives the game.
+ * @param duration The time the search has been running for.
+ *
+ * The counters of CompareStats are global, so they include the comparisons of every archive since the start of the
+ * program. Throws std::runtime_error if the file cannot be written.
+ */
+void saveMetrics(
+    const std::filesystem::path& filename, const GameState& startingState, const ProgressCounters& progress,
+    const Archive& archive, const TranspositionTable& table, std::chrono::duration<double> duration);
+
+#endif // METRICS_H
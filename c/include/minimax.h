@@ -11,16 +11,40 @@
 
 #include "archive.h"
 #include "game_state.h"
+#include "search_path.h"
+#include "transposition_table.h"
 
 /**
  * @brief Runs minimax to search all possible moves of both players.
  * @param startingState The starting game state.
  * @param archive The archive to store the winning and losing states.
+ * @param table The transposition table of solved Pusher-turn positions. Probed before the archive.
  * @param hoursPerSave The interval to save the temporary archive.
- * @param threads The number of threads.
- * @param count The number of states visited.
- * @return Predicted winner.
+ * @param threads The number of threads used by each archive query.
+ * @param searchThreads The number of threads searching the game tree. With more than one, subtrees are searched in
+ *                      parallel on ThreadPool::getShared(), which also runs the archive queries, and a subtree that
+ *                      wins for the player to move cancels its siblings. The visited states then depend on timing, but
+ *                      the winner does not.
+ * @param count The number of states visited, summed over all threads.
+ * @param resumePath The path saved by a checkpoint of a previous search of the same starting state, to continue that
+ *                   search instead of starting over, or nullptr. Only a single search thread saves and resumes paths.
+ * @return Predicted winner, or Player::NONE if the search was stopped by isStopRequested() (see signals.h). A
+ * checkpoint is saved either way when asked through the signals.
  */
-Player minimax(const GameState& startingState, Archive& archive, double hoursPerSave, size_t threads, size_t& count);
+Player minimax(
+    const GameState& startingState, Archive& archive, TranspositionTable& table, double hoursPerSave, size_t threads,
+    size_t searchThreads, size_t& count, const SearchPath* resumePath = nullptr);
+
+/// @return The file the path of the search is saved in at every checkpoint.
+std::filesystem::path getSearchPathFilename(size_t n, size_t k, int goal);
+
+/**
+ * @brief Finds the archive files saved by the checkpoints of earlier runs of the same game.
+ * @param directory The temp directory of the winning or losing boards.
+ * @return The text and binary checkpoints of the game in the directory, oldest first. Unfinished writes and the base of
+ * the journal, which is only complete with its journal, are left out.
+ */
+std::vector<std::filesystem::path> findCheckpoints(
+    const std::filesystem::path& directory, size_t n, size_t k, int goal);
 
 #endif // MINIMAX_H
@@ -0,0 +1,184 @@
+/**
+ * @file progress.h
+ * @brief Progress of a running search, counted by the search and printed by a reporter thread.
+ *
+ * The search only updates relaxed atomic counters, which costs no system call and no lock on the path of every state.
+ * A ProgressReporter reads them at a fixed interval and prints them: as a live view redrawn in place with ANSI escape
+ * sequences on a terminal, and as one plain line per report when the output is a file, so job logs stay small. The
+ * metrics of metrics.h are read from the same counters.
+ */
+
+#ifndef PROGRESS_H
+#define PROGRESS_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/**
+ * @class ProgressCounters
+ * @brief Lock-free counters of the states visited and expanded at every depth, and of the archive queries.
+ *
+ * Each depth also remembers the position among its siblings of the last state visited there, which is the path of the
+ * search when a single thread searches, and the path of one of the threads otherwise.
+ */
+class ProgressCounters {
+public:
+    /// @brief States deeper than this are counted with the states of this depth.
+    static constexpr size_t MAX_DEPTH = 63;
+
+    ProgressCounters() noexcept;
+
+    ProgressCounters(const ProgressCounters&) = delete;
+    ProgressCounters& operator=(const ProgressCounters&) = delete;
+
+    /**
+     * @brief Counts a visited state.
+     * @param depth The depth of the state, the starting state being at depth 0.
+     * @param idx The 1-based position of the state among its siblings.
+     * @param total The number of siblings.
+     */
+    void enter(size_t depth, size_t idx, size_t total) noexcept;
+
+    /**
+     * @brief Counts the expansion of a state into its children.
+     * @param depth The depth of the state.
+     * @param children The number of children generated.
+     * @param duration The time it took to generate them.
+     */
+    void countExpansion(size_t depth, size_t children, std::chrono::nanoseconds duration) noexcept;
+
+    /// @brief Counts a query of the archive, which is a hit if it predicted the winner.
+    void countArchiveQuery(bool hit) noexcept;
+
+    /// @return The number of states visited at all depths.
+    [[nodiscard]] size_t getNodes() const noexcept;
+
+    /// @return The number of states visited at the given depth, or deeper for MAX_DEPTH.
+    [[nodiscard]] size_t getNodes(size_t depth) const noexcept;
+
+    /// @return The number of states expanded at the given depth, or deeper for MAX_DEPTH.
+    [[nodiscard]] size_t getExpanded(size_t depth) const noexcept;
+
+    /// @return The number of children generated by the states expanded at the given depth, or deeper for MAX_DEPTH.
+    [[nodiscard]] size_t getChildren(size_t depth) const noexcept;
+
+    /// @return The time spent generating children at all depths.
+    [[nodiscard]] std::chrono::nanoseconds getMoveGenerationTime() const noexcept;
+
+    /// @return The depth of the last state visited, at most MAX_DEPTH.
+    [[nodiscard]] size_t getDepth() const noexcept;
+
+    /// @return The position and the number of siblings of the last state visited at the given depth.
+    [[nodiscard]] std::pair<size_t, size_t> getPosition(size_t depth) const noexcept;
+
+    [[nodiscard]] size_t getArchiveQueries() const noexcept;
+    [[nodiscard]] size_t getArchiveHits() const noexcept;
+
+    /// @return The time since the counters were created.
+    [[nodiscard]] std::chrono::duration<double> getElapsed() const noexcept;
+
+private:
+    /// @brief The counters of a depth, on their own cache line as threads at different depths update them together.
+    struct alignas(64) DepthCounters {
+        std::atomic<size_t> nodes = 0;
+        std::atomic<size_t> idx = 0, total = 0;
+        std::atomic<size_t> expanded = 0, children = 0, moveGenerationNanoseconds = 0;
+    };
+
+    std::chrono::steady_clock::time_point startTime_;
+    std::array<DepthCounters, MAX_DEPTH + 1> depths_;
+    alignas(64) std::atomic<size_t> depth_ = 0;
+    alignas(64) std::atomic<size_t> archiveQueries_ = 0;
+    std::atomic<size_t> archiveHits_ = 0;
+};
+
+/**
+ * @class ProgressReporter
+ * @brief Prints the progress counters on a background thread until destroyed.
+ *
+ * On a terminal, the path of the search down to DISPLAYED_DEPTH is redrawn in place, each position colored from red
+ * for the first sibling to green for the last, followed by the number of states per second and the archive hit rate.
+ * Otherwise the same figures are printed as a single line per report.
+ *
+ * Messages printed while a reporter runs, such as the checkpoints written, go through printMessage(), so the redraw
+ * does not overwrite them.
+ */
+class ProgressReporter {
+public:
+    /// @brief Deepest depth shown in a report.
+    static constexpr size_t DISPLAYED_DEPTH = 7;
+    /// @brief Default interval between reports on a terminal.
+    static constexpr std::chrono::milliseconds TERMINAL_INTERVAL{ 200 };
+    /// @brief Default interval between reports written to a file.
+    static constexpr std::chrono::milliseconds FILE_INTERVAL{ 60000 };
+
+    /**
+     * @brief Starts reporting.
+     * @param counters The counters to report, which must outlive the reporter.
+     * @param out Where to print the reports.
+     * @param interval The interval between reports. Zero picks TERMINAL_INTERVAL or FILE_INTERVAL, depending on whether
+     * the output is a terminal.
+     */
+    explicit ProgressReporter(const ProgressCounters& counters, FILE* out = stdout,
+                              std::chrono::milliseconds interval = std::chrono::milliseconds::zero());
+
+    /// @brief Stops the thread and prints a last report, so the final counts are always shown.
+    ~ProgressReporter();
+
+    ProgressReporter(const ProgressReporter&) = delete;
+    ProgressReporter& operator=(const ProgressReporter&) = delete;
+
+    /// @return Whether the output is a terminal, which gets the live view.
+    [[nodiscard]] bool isTerminal() const noexcept;
+
+    /**
+     * @brief Prints a message to stderr, with the arguments of printf(), without the live view overwriting it.
+     *
+     * If a reporter draws a live view, the view is cleared before the message and the next report draws it again
+     * below, so the message stays above it. Safe to call from any thread, with or without a reporter.
+     */
+    template<typename... Args>
+    static void printMessage(const char* format, Args... args) {
+        if constexpr (sizeof...(Args) == 0) {
+            printMessageText(format);
+        } else {
+            std::string text(static_cast<size_t>(std::max(snprintf(nullptr, 0, format, args...), 0)), '\0');
+            snprintf(text.data(), text.size() + 1, format, args...);
+            printMessageText(text);
+        }
+    }
+
+private:
+    /// @brief Prints a formatted message for printMessage().
+    static void printMessageText(const std::string& text);
+
+    /// @brief Main loop of the thread.
+    void run();
+
+    /// @brief Prints one report, with the rate of states since the previous one.
+    void report();
+
+    const ProgressCounters& counters_;
+    FILE* out_;
+    bool terminal_;
+    std::chrono::milliseconds interval_;
+
+    std::chrono::steady_clock::time_point startTime_, lastTime_;
+    size_t lastNodes_;
+    /// @brief Number of lines of the last report on a terminal, which the next one overwrites.
+    size_t lines_;
+
+    std::mutex mutex_;
+    std::condition_variable stopped_;
+    bool stopping_;
+    std::thread thread_;
+};
+
+#endif // PROGRESS_H
@@ -0,0 +1,54 @@
+/**
+ * @file search_path.h
+ * @brief The path of a running search from the starting state to the state being searched, saved with each checkpoint
+ * so a later run can continue the search where it stopped.
+ *
+ * The depth-first search completes the children of a state in order, so the path tells everything about the search
+ * besides the archive: at every depth, the children before the one on the path are solved, and none of them wins for
+ * the player to move (otherwise the search would have returned). Resuming regenerates the children of the states on
+ * the path, which are always generated in the same order, and skips the solved ones. The board of each state on the
+ * path is saved to check that the regenerated children are the same.
+ */
+
+#ifndef SEARCH_PATH_H
+#define SEARCH_PATH_H
+
+#include <filesystem>
+#include <optional>
+#include <vector>
+#include "board.h"
+
+/// @brief A state on the path, as the child of the previous state.
+struct SearchFrame {
+    /// @brief Index of the state among its siblings, from 1, and the number of siblings, as in the progress log.
+    size_t idx, total;
+    Board board;
+};
+
+struct SearchPath {
+    size_t n = 0, k = 0;
+    int goal = 0;
+    /// @brief The number of states visited before the checkpoint.
+    size_t count = 0;
+    /// @brief The archive files saved with the path. Empty if the archive is restored from its journal instead.
+    std::filesystem::path winningFilename, losingFilename;
+    /// @brief frames[d] is the state at depth d + 1. The starting state at depth 0 is not included.
+    std::vector<SearchFrame> frames;
+};
+
+/**
+ * @brief Saves a search path as JSON, replacing the file atomically.
+ *
+ * Throws std::runtime_error if the file cannot be written.
+ */
+void saveSearchPath(const SearchPath& path, const std::filesystem::path& filename);
+
+/**
+ * @brief Loads a search path saved by saveSearchPath().
+ * @return The path, or std::nullopt if the file does not exist.
+ *
+ * Throws std::runtime_error if the file cannot be read or parsed.
+ */
+std::optional<SearchPath> loadSearchPath(const std::filesystem::path& filename);
+
+#endif // SEARCH_PATH_H
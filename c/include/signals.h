@@ -0,0 +1,26 @@
+/**
+ * @file signals.h
+ * @brief Requests from the outside of a running search, made through signals.
+ *
+ * Batch schedulers such as Slurm send SIGTERM some time before killing a job. With the handlers installed, SIGTERM asks
+ * the search to stop at the next state it visits, save a checkpoint and return, and SIGUSR1 asks it to save a
+ * checkpoint and go on. The handlers only set flags, which the search polls.
+ */
+
+#ifndef SIGNALS_H
+#define SIGNALS_H
+
+/// @brief Exit status of a run stopped by SIGTERM after saving its checkpoint (EX_TEMPFAIL of sysexits.h), so a job
+/// script can tell it apart from a failure and rerun it with --resume.
+constexpr int EXIT_STOPPED = 75;
+
+/// @brief Installs the handlers of SIGTERM, and of SIGUSR1 where it exists.
+void installSignalHandlers();
+
+/// @return Whether SIGTERM was received. Stays true once it is.
+[[nodiscard]] bool isStopRequested() noexcept;
+
+/// @return Whether SIGUSR1 was received since the last call.
+[[nodiscard]] bool takeCheckpointRequest() noexcept;
+
+#endif // SIGNALS_H
@@ -1,28 +1,59 @@
 /**
  * @file thread_pool.h
- * @brief This file contains the implementation of a thread pool.
+ * @brief This file contains the implementation of a thread pool and fork-join task groups on top of it.
  *
- * Not used anywhere in the project, but kept it in case it is needed in the future.
+ * Threads are expensive to create compared to the work of a single archive query, so the hot paths submit their work
+ * to the long-lived pool returned by ThreadPool::getShared() through a TaskGroup instead of launching threads.
  */
 
 #ifndef THREAD_POOL_H
 #define THREAD_POOL_H
 
+#include <atomic>
 #include <condition_variable>
+#include <deque>
+#include <exception>
 #include <functional>
 #include <future>
+#include <memory>
 #include <queue>
 #include <mutex>
 #include <thread>
 #include <type_traits>
 #include <vector>
 
+/**
+ * @class ThreadPool
+ * @brief A work-stealing thread pool.
+ *
+ * Every worker owns a deque of tasks. A task added from inside a worker goes to the back of that worker's deque and is
+ * taken back from the back (most recent first, which keeps a recursive search depth-first and cache friendly), while
+ * idle workers steal from the front of the other deques (oldest first, i.e. the largest subtrees). Tasks added from
+ * outside the pool go to a shared queue that every worker drains.
+ */
 class ThreadPool {
 public:
     explicit ThreadPool(size_t numThreads);
 
     ~ThreadPool();
 
+    /**
+     * @return A pool with one worker per hardware thread, created on first use and kept until the program exits.
+     */
+    static ThreadPool& getShared();
+
+    /**
+     * @brief Adds a task without a future to wait on. Cheaper than addTask() when the caller synchronizes by itself.
+     * @param task The task to run. Must not throw.
+     */
+    void addDetachedTask(std::function<void()> task);
+
+    /// @return The number of worker threads.
+    [[nodiscard]] size_t getNumThreads() const noexcept;
+
+    /// @return The number of tasks waiting to be picked up. Only a hint, as it may change at any time.
+    [[nodiscard]] size_t getNumQueuedTasks() const noexcept;
+
     template<typename F, typename... Args>
     auto addTask(F&& f, Args&&... args) -> std::future<typename std::invoke_result<F, Args...>::type> {
         using return_type = typename std::invoke_result<F, Args...>::type;
@@ -33,35 +64,101 @@ public:
         );
 
         std::future<return_type> res = task->get_future();
-        {
-            std::unique_lock<std::mutex> lock(this->queueMutex_);
-
-            // Don't allow enqueueing after stopping
-            if (this->stop_) {
-                throw std::runtime_error("addTask on stopped ThreadPool");
-            }
-
-            tasks_.emplace([task](){ (*task)(); });
-        }
-
-        // If there are waiting threads, notify one that there is a new task
-        this->condition_.notify_one();
-
+        this->addDetachedTask([task](){ (*task)(); });
         return res;
     }
 
 private:
+    /// @brief The deque of a single worker, guarded by its own mutex so owners and thieves rarely contend.
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    /// @brief Main loop of the worker with the given index.
+    void work(size_t index);
+
+    /// @brief Takes a task for the given worker: its own newest task, then a shared one, then the oldest of another.
+    bool takeTask(size_t index, std::function<void()>& task);
+
     std::vector<std::thread> workers_;
+    std::vector<std::unique_ptr<WorkerQueue>> queues_;
     std::queue<std::function<void()>> tasks_;
 
-    // Mutex bind to the queue
+    // Mutex bind to the shared queue, and to sleeping and waking up the workers
     std::mutex queueMutex_;
 
     // Condition variable to notify the workers
     std::condition_variable condition_;
 
+    // Number of tasks in all queues
+    std::atomic<size_t> queued_;
+
+    // Number of workers sleeping or about to sleep on the condition variable, so adding a task only locks to wake one
+    std::atomic<size_t> sleepers_;
+
     // Whether the pool is stopped and no more tasks can be added
     bool stop_;
+
+    // The pool and the worker index of the current thread, if it is a worker
+    static thread_local ThreadPool* currentPool_;
+    static thread_local size_t currentIndex_;
+};
+
+/**
+ * @class TaskGroup
+ * @brief A set of tasks forked onto a thread pool and joined together, with cooperative cancellation.
+ *
+ * The thread calling wait() runs the tasks that no worker has picked up yet, so waiting never depends on a free worker,
+ * and a task running on the pool can itself fork and wait on a nested group. It never runs tasks of other groups, so a
+ * caller holding a lock or an epoch guard only holds it for its own work. Once cancel() is called, tasks that have not
+ * started are skipped, and running tasks are expected to poll isCancelled() and return early.
+ */
+class TaskGroup {
+public:
+    explicit TaskGroup(ThreadPool& pool);
+
+    /// @brief Waits for all tasks. Exceptions thrown by the tasks are dropped; call wait() to receive them.
+    ~TaskGroup();
+
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    /**
+     * @brief Forks a task.
+     * @param task The task to run.
+     */
+    void run(std::function<void()> task);
+
+    /**
+     * @brief Joins all tasks forked so far, helping to run the ones that have not started yet.
+     *
+     * Rethrows the first exception thrown by a task, if any.
+     */
+    void wait();
+
+    /// @brief Requests all tasks of the group to stop. Safe to call from any thread, including from a task.
+    void cancel() noexcept;
+
+    /// @return Whether cancel() has been called.
+    [[nodiscard]] bool isCancelled() const noexcept;
+
+private:
+    /// @brief State shared with the pool, which may still hold a reference after the group is destroyed.
+    struct State {
+        std::mutex mutex;
+        std::condition_variable finished;
+        std::deque<std::function<void()>> pending;
+        size_t running = 0;
+        std::atomic<bool> cancelled = false;
+        std::exception_ptr exception;
+
+        /// @brief Takes one pending task and runs it. Returns false if there was none.
+        bool runNext();
+    };
+
+    ThreadPool& pool_;
+    std::shared_ptr<State> state_;
 };
 
 #endif // THREAD_POOL_H
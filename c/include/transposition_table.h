@@ -0,0 +1,111 @@
+/**
+ * @file transposition_table.h
+ * @brief A bounded, lock-free hash table of solved positions.
+ *
+ * The minimax search reaches the same position through different move orders. The table remembers the winner of every
+ * solved Pusher-turn position, keyed by its canonical form (see Board::canonicalize()), so an exact repeat costs a single
+ * probe instead of a scan of the archive. Unlike the archive, the table only answers for identical positions, and it
+ * forgets old entries once it is full.
+ */
+
+#ifndef TRANSPOSITION_TABLE_H
+#define TRANSPOSITION_TABLE_H
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include "hash.h"
+
+class TranspositionTable {
+public:
+    /**
+     * @brief The identity of a position in the table.
+     *
+     * Holds the full canonical board packed into a few words, so a hit is always exact even if two boards share the same
+     * 64-bit hash. Boards with a chip on row 15 or above cannot be packed and are never stored.
+     */
+    struct Key {
+        BoardHash hash;
+        /// @brief The chips packed as 4-bit (row + 1) values, followed by the moved flags.
+        std::array<std::uint64_t, 5> words;
+        /// @brief The board size, as n << 8 | k.
+        std::uint64_t shape;
+        bool valid;
+    };
+
+    /**
+     * @brief Constructor.
+     * @param megabytes Memory budget of the table. Rounded down to a power of two number of buckets.
+     * @param goal The goal of the game, used to hash the boards.
+     */
+    TranspositionTable(size_t megabytes, int goal);
+
+    /**
+     * @param board The board of the position.
+     * @return The key of the position.
+     *
+     * Time complexity: O(n^2 k).
+     */
+    [[nodiscard]] Key makeKey(const Board& board) const noexcept;
+
+    /**
+     * @param key The key of the position.
+     * @return The stored winner of the position, or Player::NONE if it is not in the table.
+     *
+     * Never blocks. A probe that races with a store to the same bucket counts as a miss.
+     */
+    [[nodiscard]] Player probe(const Key& key) const noexcept;
+
+    /**
+     * @brief Stores the winner of a position.
+     * @param key The key of the position.
+     * @param winner The winner of the position.
+     * @param work The number of states visited to solve the position. Used by the replacement policy.
+     *
+     * Each bucket has two slots. The first slot keeps the most expensive position seen so far, and is only replaced by a
+     * position with at least as much work. The second slot always takes the newest position. Never blocks: if another
+     * thread is writing the same slot, the store is dropped.
+     */
+    void store(const Key& key, Player winner, size_t work) noexcept;
+
+    /// @brief Removes all entries and resets the counters. Must not run concurrently with probe() or store().
+    void clear() noexcept;
+
+    // Getters
+    [[nodiscard]] size_t getCapacity() const noexcept;
+    [[nodiscard]] size_t getHits() const noexcept;
+    [[nodiscard]] size_t getMisses() const noexcept;
+    [[nodiscard]] size_t getStores() const noexcept;
+    [[nodiscard]] size_t getReplacements() const noexcept;
+
+private:
+    /**
+     * @brief A single entry, guarded by a sequence lock.
+     *
+     * Writers make `version` odd while they update the other fields, and readers retry nothing: a torn read is simply
+     * treated as a miss. `data` holds the winner, the board size, and the work, and is 0 for empty slots.
+     */
+    struct alignas(64) Slot {
+        std::atomic<std::uint64_t> version;
+        std::atomic<std::uint64_t> hash;
+        std::array<std::atomic<std::uint64_t>, 5> words;
+        std::atomic<std::uint64_t> data;
+    };
+
+    static constexpr size_t SLOTS_PER_BUCKET = 2;
+
+    /// @brief Reads a slot. Returns the data word if the slot holds the key, and 0 otherwise.
+    [[nodiscard]] std::uint64_t read(const Slot& slot, const Key& key) const noexcept;
+
+    /// @brief Overwrites a slot, unless another thread is writing it. Returns whether the write happened.
+    bool write(Slot& slot, const Key& key, std::uint64_t data) noexcept;
+
+    int goal_;
+    size_t numBuckets_;
+    std::unique_ptr<Slot[]> slots_;
+
+    mutable std::atomic<size_t> hits_, misses_;
+    std::atomic<size_t> stores_, replacements_;
+};
+
+#endif // TRANSPOSITION_TABLE_H
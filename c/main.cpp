@@ -1,16 +1,25 @@
 //#define RECORD_PARTIAL_RESULT
 
+#include <algorithm>
 #include <chrono>
 #include <filesystem>
 #include <fstream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
 #include "json.hpp"
 #include "archive.h"
 #include "board.h"
+#include "column_kernels.h"
+#include "compare.h"
 #include "game_state.h"
 #include "helper.h"
 #include "init.h"
 #include "minimax.h"
 #include "scoped_timer.h"
+#include "signals.h"
+#include "transposition_table.h"
 
 /**
  * Using CMake:
@@ -18,12 +27,16 @@
  * cmake -B build
  * cmake --build build --config Release
  * cd build
- * ./main <JSON config file>
+ * ./main <JSON config file> [--resume]
  * ```
+ *
+ * With `--resume`, the search continues from the path saved by the last checkpoint of a previous run, with the archive
+ * saved by that checkpoint.
  */
 int main(int argc, char** argv) {
-    if (argc != 2) {
-        fprintf(stderr, "Usage: %s [JSON config file]\n", argv[0]);
+    bool resume = argc == 3 && std::string(argv[2]) == "--resume";
+    if (argc != 2 && !resume) {
+        fprintf(stderr, "Usage: %s [JSON config file] [--resume]\n", argv[0]);
         exit(1);
     }
 
@@ -40,6 +53,9 @@ int main(int argc, char** argv) {
         exit(1);
     }
 
+    // Stop at a checkpoint on SIGTERM, and save one on SIGUSR1
+    installSignalHandlers();
+
     // Initialize game state
     printf("\n[Initializing game state]\n");
     GameState startingGameState = initGameState(config);
@@ -50,10 +66,19 @@ int main(int argc, char** argv) {
     printf("N: %zu, K: %zu, GOAL: %d\n", N, K, GOAL);
     printf("Starting board:\n%s", startingBoard.toString().c_str());
 
+    // A SIGTERM during the startup has no search to save, so it only stops before the next phase
+    auto stoppedAt = [](const char* phase) {
+        if (isStopRequested()) {
+            printf("Stopped by SIGTERM after %s\n", phase);
+        }
+        return isStopRequested();
+    };
+
     // Initialize archive
     printf("\n[Initializing archive]\n");
-    Archive archive;
-    std::filesystem::path filename = getFilename(N, K, GOAL);
+    ArchiveFormat archiveFormat = parseArchiveFormat(config["common"].value("archive-format", "text"));
+    Archive archive(GOAL, archiveFormat);
+    std::filesystem::path filename = getFilename(N, K, GOAL, "", getExtension(archiveFormat));
     std::filesystem::path winningFilename = "winning" / filename;
     std::filesystem::path losingFilename = "losing" / filename;
     archive.loadWinning(winningFilename);
@@ -64,19 +89,116 @@ int main(int argc, char** argv) {
     for (std::filesystem::path additionalLosingFilename : config["minimax"]["files-to-load-from"]["losing"]) {
         archive.loadLosing(additionalLosingFilename);
     }
+    if (stoppedAt("loading the archive")) {
+        return EXIT_STOPPED;
+    }
+
+    // Warm start from the checkpoints of earlier runs, so a requeued job does not solve their boards again
+    std::vector<std::filesystem::path> winningCheckpoints, losingCheckpoints;
+    if (config["minimax"].value("warm-start", true)) {
+        winningCheckpoints = findCheckpoints(std::filesystem::path("winning") / "temp", N, K, GOAL);
+        losingCheckpoints = findCheckpoints(std::filesystem::path("losing") / "temp", N, K, GOAL);
+        archive.loadWinning(mergeArchiveFiles(winningCheckpoints, GOAL));
+        archive.loadLosing(mergeArchiveFiles(losingCheckpoints, GOAL));
+        printf("Warm start: %zu winning and %zu losing checkpoints merged, %zu winning and %zu losing boards\n",
+               winningCheckpoints.size(), losingCheckpoints.size(), archive.getWinningCount(),
+               archive.getLosingCount());
+        if (stoppedAt("the warm start")) {
+            return EXIT_STOPPED;
+        }
+    }
+
+    // Continue from the base and the journal of a previous run, and record the changes of this run in the journal
+    std::unique_ptr<ArchiveJournal> journal;
+    if (config["minimax"].value("journal", false)) {
+        std::filesystem::path baseFilename = getFilename(N, K, GOAL, "_base", getExtension(archiveFormat));
+        std::filesystem::path journalDirectory = "journal" / getFilename(N, K, GOAL, "", "");
+        auto loadBase = [GOAL](const std::filesystem::path& filename) {
+            return std::filesystem::exists(filename) ? loadArchiveFile(filename, GOAL) : BinaryArchive();
+        };
+        BinaryArchive winningBase = loadBase("winning" / ("temp" / baseFilename));
+        BinaryArchive losingBase = loadBase("losing" / ("temp" / baseFilename));
+        size_t numBaseBoards = winningBase.header.numBoards + losingBase.header.numBoards;
+        size_t numRecords = ArchiveJournal::replay(journalDirectory, winningBase, losingBase, GOAL);
+        printf("Journal: %zu records replayed over %zu boards\n", numRecords, numBaseBoards);
+        archive.loadWinning(winningBase);
+        archive.loadLosing(losingBase);
+        if (stoppedAt("replaying the journal")) {
+            return EXIT_STOPPED;
+        }
+        journal = std::make_unique<ArchiveJournal>(journalDirectory, N, K, GOAL);
+    }
+
+    // Continue the search of the last checkpoint, with the archive it was saved with
+    std::optional<SearchPath> resumePath;
+    if (resume) {
+        std::filesystem::path searchPathFilename = getSearchPathFilename(N, K, GOAL);
+        try {
+            resumePath = loadSearchPath(searchPathFilename);
+        } catch (const std::exception& e) {
+            fprintf(stderr, "Failed to load %s: %s\n", searchPathFilename.string().c_str(), e.what());
+        }
+        if (resumePath && (resumePath->n != N || resumePath->k != K || resumePath->goal != GOAL)) {
+            fprintf(stderr, "Skipping %s: saved for another game\n", searchPathFilename.string().c_str());
+            resumePath.reset();
+        }
+        if (resumePath) {
+            // The files of the checkpoint are already loaded if the warm start found them
+            auto isLoaded = [](const std::vector<std::filesystem::path>& checkpoints, const std::filesystem::path& f) {
+                return std::find(checkpoints.begin(), checkpoints.end(), f.lexically_normal()) != checkpoints.end();
+            };
+            if (!resumePath->winningFilename.empty() && !isLoaded(winningCheckpoints, resumePath->winningFilename)) {
+                archive.loadWinning(resumePath->winningFilename);
+            }
+            if (!resumePath->losingFilename.empty() && !isLoaded(losingCheckpoints, resumePath->losingFilename)) {
+                archive.loadLosing(resumePath->losingFilename);
+            }
+            printf("Resuming at depth %zu after %zu states\n", resumePath->frames.size(), resumePath->count);
+        } else {
+            printf("No search to resume, starting over\n");
+        }
+    }
     archive.prune(1);
+    if (stoppedAt("pruning the archive")) {
+        return EXIT_STOPPED;
+    }
+    archive.setJournal(journal.get());
+
+    // Initialize transposition table
+    size_t tableMegabytes = config["minimax"].value("transposition-table-mb", 256);
+    TranspositionTable table(tableMegabytes, GOAL);
+    printf("Transposition table: %zu entries\n", table.getCapacity());
 
+    size_t searchThreads = config["minimax"].value("search-threads", 1);
+    printf("Search threads: %zu\n", searchThreads);
+
+    bool stopped = false;
     {
         ScopedTimer timer;
 
         // Start minimax algorithm
         printf("\n[Minimax start]\n");
-        size_t count = 0;
-        Player winner = minimax(startingGameState, archive, config["minimax"]["hours-per-save"], config["minimax"]["threads"], count);
+        size_t count = resumePath ? resumePath->count : 0;
+        Player winner = minimax(
+                startingGameState, archive, table, config["minimax"]["hours-per-save"], config["minimax"]["threads"],
+                searchThreads, count, resumePath ? &*resumePath : nullptr);
+
+        // The search is complete, so there is nothing left to resume
+        stopped = isStopRequested();
+        if (!stopped) {
+            std::filesystem::remove(getSearchPathFilename(N, K, GOAL));
+        }
 
         // End minimax algorithm
         printf("\n[Minimax end]\n");
         printf("Total number of cases evaluated: %zu\n", count);
+        printf("Transposition table: %zu hits, %zu misses, %zu stores, %zu replacements\n",
+               table.getHits(), table.getMisses(), table.getStores(), table.getReplacements());
+        CompareStats compareStats = getCompareStats();
+        printf("Board comparisons: %zu, without signatures: %zu, settled by size: %zu, chip count: %zu, histogram: %zu, "
+               "ranks: %zu, column codes: %zu, matching: %zu\n",
+               compareStats.calls, compareStats.withoutSignatures, compareStats.bySize, compareStats.byChipCount,
+               compareStats.byHistogram, compareStats.byRanks, compareStats.byColumnCodes, compareStats.matched);
         switch (winner) {
         case Player::PUSHER:
             printf("\033[38;2;0;38;255mWinner: Pusher\033[0m\n");
@@ -85,12 +207,18 @@ int main(int argc, char** argv) {
             printf("\033[38;2;255;95;5mWinner: Remover\033[0m\n");
             break;
         case Player::NONE:
-            printf("Winner not found\n");
+            printf(stopped ? "Stopped by SIGTERM\n" : "Winner not found\n");
             break;
         }
     }
 
+    // The checkpoint is saved, and the final files are left for the run that completes the search
+    if (stopped) {
+        return EXIT_STOPPED;
+    }
+
     // Save the winning and losing states to files
+    archive.setJournal(nullptr);
     archive.prune();
     printf("\n[Saving winning and losing states]\n");
     archive.saveWinning(winningFilename);
@@ -11,7 +11,8 @@
  * ```
  *
  * Where `N` is the number of columns, `K` is the number of chips per column, and `GOAL` is the target row to reach. The
- * program automatically loads the files `winning/N[N]_K[K]_goal[GOAL].txt` and `losing/N[N]_K[K]_goal[GOAL].txt`.
+ * program automatically loads the files `winning/N[N]_K[K]_goal[GOAL].txt` and `losing/N[N]_K[K]_goal[GOAL].txt`, or
+ * the binary files with the extension `.bin` instead if they exist.
  *
  * The first step is to decide if the initial state (i.e. the state where all chips are at row 0) is a winning or
  * losing. This can be done by comparing the initial state with the winning and losing states. Note that this step is
@@ -39,20 +40,19 @@
 
 #include <algorithm>
 #include <vector>
-#include "archive.h"
+#include "archive_view.h"
 #include "board.h"
 #include "game_state.h"
 #include "helper.h"
 
 /**
  * @brief Verify if winning states are indeed winning.
- * @param archive Archive containing the exact list of winning states to verify.
+ * @param archive View of the exact list of winning states to verify.
  * @param goal The target row to reach.
  * @return The number of states failed to verify.
  */
-size_t verifyWinningStates(const Archive& archive, int goal) {
-    std::vector<Board> winningStates = archive.getWinningBoardsAsVector();
-    size_t total = winningStates.size();
+size_t verifyWinningStates(const ArchiveView& archive, int goal) {
+    size_t total = archive.size();
     size_t numFailedToVerify = 0;
 
     // If there are no winning states, then there is nothing to verify
@@ -64,7 +64,7 @@ size_t verifyWinningStates(const Archive& archive, int goal) {
     // Otherwise, verify the winning states one by one
     for (size_t i = 0; i < total; i++) {
         // Fetch the game state to verify
-        GameState state(winningStates[i], goal);
+        GameState state(archive.getBoard(i), goal);
 
         // For any pusher move...
         std::vector<GameState> nextStates = state.step();
@@ -96,13 +96,12 @@ size_t verifyWinningStates(const Archive& archive, int goal) {
 
 /**
  * @brief Verify if losing states are indeed losing.
- * @param archive Archive containing the exact list of losing states to verify.
+ * @param archive View of the exact list of losing states to verify.
  * @param goal The target row to reach.
  * @return The number of states failed to verify.
  */
-size_t verifyLosingStates(const Archive& archive, int goal) {
-    std::vector<Board> losingStates = archive.getLosingBoardsAsVector();
-    size_t total = losingStates.size();
+size_t verifyLosingStates(const ArchiveView& archive, int goal) {
+    size_t total = archive.size();
     size_t numFailedToVerify = 0;
 
     // If there are no losing states, then there is nothing to verify
@@ -114,7 +113,7 @@ size_t verifyLosingStates(const Archive& archive, int goal) {
     // Otherwise, verify the losing states one by one
     for (size_t i = 0; i < total; i++) {
         // Fetch the game state to verify
-        GameState state(losingStates[i], goal);
+        GameState state(archive.getBoard(i), goal);
 
         // For all pusher moves...
         std::vector<GameState> nextStates = state.step();
@@ -165,14 +164,17 @@ int main(int argc, char** argv) {
     // Load the winning and losing states
     printf("\n[Loading winning and losing states]\n");
     std::filesystem::path filename = getFilename(N, K, GOAL);
+    std::filesystem::path binaryFilename = getFilename(N, K, GOAL, "", getExtension(ArchiveFormat::BINARY));
     std::filesystem::path winningFilename = "winning" / filename;
     std::filesystem::path losingFilename = "losing" / filename;
-
-    // Create the archive
-    // Archives organize game states in a way that is easy to do batch comparisons.
-    Archive winningArchive, losingArchive;
-    winningArchive.loadWinning(winningFilename);
-    losingArchive.loadLosing(losingFilename);
+    if (std::filesystem::exists("winning" / binaryFilename)) winningFilename = "winning" / binaryFilename;
+    if (std::filesystem::exists("losing" / binaryFilename)) losingFilename = "losing" / binaryFilename;
+
+    // Open the archives
+    // Binary files are mapped and queried in place, so their states are never copied into memory. Text files are
+    // converted into the binary layout in memory instead.
+    ArchiveView winningArchive(winningFilename, Player::PUSHER, GOAL);
+    ArchiveView losingArchive(losingFilename, Player::REMOVER, GOAL);
 
     // Check if starting game state is winning or losing
     printf("\n[Verification]\n");
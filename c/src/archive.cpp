@@ -1,132 +1,238 @@
-#include <fstream>
-#include <future>
+#include <chrono>
+#include <mutex>
 #include "archive.h"
+#include "archive_file.h"
 #include "compare.h"
+#include "epoch.h"
+#include "progress.h"
+#include "signals.h"
+#include "thread_pool.h"
 
 #define TIDY_ON_INSERT
 
-static const char* BOARD_DELIMITER = "---";
-
-Archive::Archive() noexcept
-        : winningCount_(0), losingCount_(0), winningPruneThreshold_(10), losingPruneThreshold_(10) {}
+Archive::Archive(int goal, ArchiveFormat fileFormat) noexcept
+        : goal_(goal), fileFormat_(fileFormat), journal_(nullptr), winningCount_(0), losingCount_(0),
+          winningPruneThreshold_(10), losingPruneThreshold_(10), inserted_(0), rejected_(0), replaced_(0), pruned_(0) {}
 
 // Helper function
-void saveBoardsTo(std::map<size_t, std::vector<Board>>& boards, const std::filesystem::path& filename) {
-    std::filesystem::create_directories(filename.parent_path());
-    std::ofstream file(filename);
-    if (!file.is_open()) {
-        fprintf(stderr, "Failed to open file for writing: %s\n", filename.string().c_str());
-        return;
-    }
+void saveBoardsTo(
+        const Archive::Buckets& boards, const std::filesystem::path& filename, ArchiveFormat format, int goal) {
 
-    for (const auto& [numChips, boards_] : boards) {
-        for (const Board& board : boards_) {
-            file << board.toString();
-            file << BOARD_DELIMITER << std::endl;
-        }
+    try {
+        saveArchiveFile(ArchiveSnapshot(boards, goal).pack(), filename, format);
+    } catch (const std::exception& e) {
+        ProgressReporter::printMessage("Failed to save %s: %s\n", filename.string().c_str(), e.what());
     }
-
-    file.close();
 }
 
 // Helper function
-void loadBoardsFrom(std::map<size_t, std::vector<Board>>& boards, const std::filesystem::path& filename) {
-    std::ifstream file(filename);
-    if (!file.is_open()) {
-        fprintf(stderr, "Failed to open file for reading: %s\n", filename.string().c_str());
-        return;
-    }
-
-    std::string line;
-    std::string boardString;
-    while (std::getline(file, line)) {
-        if (line == BOARD_DELIMITER) {
-            if (!boardString.empty()) {
-                Board board(boardString);
-                boards[board.getNumChips()].emplace_back(board);
-                boardString.clear();
+size_t loadBoardsFrom(Archive::Buckets& boards, const BinaryArchive& file) {
+    // The file is grouped by number of chips, so each bucket is filled by its own task, in the order of the file. The
+    // queries skip buckets by number of chips, so a board is added to the bucket of the chips it actually has, even if
+    // a corrupt file lists it with others.
+    TaskGroup group(ThreadPool::getShared());
+    for (size_t c = 0; c <= Board::MAX_CHIPS; c++) {
+        std::uint64_t begin = file.header.bucketOffsets[c], end = file.header.bucketOffsets[c + 1];
+        if (begin == end) continue;
+        group.run([&file, &boards, begin, end]() {
+            for (std::uint64_t i = begin; i < end; i++) {
+                Board board = file.getBoard(i);
+                boards[board.getNumChips()].push_back(ArchivedBoard(board));
             }
-        } else {
-            boardString += line + "\n";
-        }
+        });
     }
+    group.wait();
 
-    // Don't forget to add the last board if the file doesn't end with "---"
-    if (!boardString.empty()) {
-        Board board(boardString);
-        boards[board.getNumChips()].emplace_back(board);
+    size_t count = 0;
+    for (const ArchiveBucket& bucket : boards) {
+        count += bucket.size();
     }
+    return count;
+}
+
+// Helper function
+size_t loadBoardsFrom(Archive::Buckets& boards, const std::filesystem::path& filename, int goal) {
+    return loadBoardsFrom(boards, loadArchiveFile(filename, goal));
 }
 
 void Archive::saveWinning(const std::filesystem::path& filename) {
-    saveBoardsTo(this->winningBoards_, filename);
+    saveBoardsTo(this->winningBoards_, filename, this->fileFormat_, this->goal_);
 }
 
 void Archive::saveLosing(const std::filesystem::path& filename) {
-    saveBoardsTo(this->losingBoards_, filename);
+    saveBoardsTo(this->losingBoards_, filename, this->fileFormat_, this->goal_);
+}
+
+ArchiveSnapshot Archive::getWinningSnapshot() const {
+    return { this->winningBoards_, this->goal_ };
+}
+
+ArchiveSnapshot Archive::getLosingSnapshot() const {
+    return { this->losingBoards_, this->goal_ };
+}
+
+void Archive::loadWinning(const BinaryArchive& boards) {
+    this->winningCount_ = loadBoardsFrom(this->winningBoards_, boards);
+}
+
+void Archive::loadLosing(const BinaryArchive& boards) {
+    this->losingCount_ = loadBoardsFrom(this->losingBoards_, boards);
+}
+
+void Archive::setJournal(ArchiveJournal* journal) noexcept {
+    this->journal_ = journal;
 }
 
 void Archive::loadWinning(const std::filesystem::path& filename) {
     if (std::filesystem::exists(filename)) {
-        loadBoardsFrom(this->winningBoards_, filename);
-        // Update the size
-        this->winningCount_ = 0;
-        for (const auto& [numChips, boards] : this->winningBoards_) {
-            this->winningCount_ += boards.size();
-        }
+        this->winningCount_ = loadBoardsFrom(this->winningBoards_, filename, this->goal_);
     }
 }
 
 void Archive::loadLosing(const std::filesystem::path& filename) {
     if (std::filesystem::exists(filename)) {
-        loadBoardsFrom(this->losingBoards_, filename);
-        // Update the size
-        this->losingCount_ = 0;
-        for (const auto& [numChips, boards] : this->losingBoards_) {
-            this->losingCount_ += boards.size();
-        }
+        this->losingCount_ = loadBoardsFrom(this->losingBoards_, filename, this->goal_);
     }
 }
 
-void Archive::addWinning(const Board& board) noexcept {
-#ifdef TIDY_ON_INSERT
-    size_t newSize = 0;
+/**
+ * Helper function
+ *
+ * Inserts a board while keeping the buckets an antichain, even if other threads insert at the same time. The board
+ * is first compared with the published boards: it is dropped if one of them makes it redundant, and replaces the ones
+ * it makes redundant. Boards published by other threads during that check are compared once more after publishing the
+ * new board. Two threads that insert comparable boards at the same time see each other in this second pass, so the
+ * redundant one is removed by at least one of them.
+ *
+ * A board can only be greater than boards with at most as many chips, and less than boards with at least as many. So
+ * each bucket is only searched in the directions its chip count allows, through the bounds index of the bucket, and
+ * with a one-directional comparison. The bucket with the same chip count as the new board still compares in both
+ * directions, as equal boards are neither redundant nor replaced.
+ *
+ * Each insertion and removal is recorded in the journal, if any, once it is published. Another thread may remove the
+ * new board before its insertion is recorded, in which case a replay keeps it as a redundant board.
+ *
+ * @param redundant The comparison result that makes the new board redundant. The opposite one makes the other board
+ * redundant.
+ * @param journal The journal of the archive, or nullptr.
+ * @param replaced Counts the boards the new board removes.
+ * @return Whether the new board was kept. A board kept and then removed by another thread counts as replaced there.
+ */
+bool addTidy(
+        Archive::Buckets& buckets, std::atomic<size_t>& count, ArchivedBoard entry, CompResult redundant,
+        ArchiveJournal* journal, std::atomic<size_t>& replaced) noexcept {
+
+    CompResult replaces = redundant == CompResult::GREATER ? CompResult::LESS : CompResult::GREATER;
+    size_t numChipsToAdd = entry.board.getNumChips();
+    EpochManager::Guard guard;
+
+    // Records a change in the journal, if any
+    bool winning = redundant == CompResult::GREATER;
+    auto record = [journal, winning](bool add, const Board& board) {
+        if (!journal) return;
+        using RecordType = ArchiveJournal::RecordType;
+        journal->append(add ? (winning ? RecordType::ADD_WINNING : RecordType::ADD_LOSING)
+                            : (winning ? RecordType::REMOVE_WINNING : RecordType::REMOVE_LOSING), board);
+    };
+
+    // Boards that are less than the new board are below it, and vice versa
+    auto dominance = [](CompResult result) {
+        return result == CompResult::GREATER ? Dominance::BELOW : Dominance::ABOVE;
+    };
+    auto purpose = [numChipsToAdd](size_t numChips, CompResult result) {
+        if (numChips == numChipsToAdd) return Purpose::BOTH;
+        return result == CompResult::GREATER ? Purpose::GREATER : Purpose::LESS;
+    };
+
+    // Whether a bucket may hold boards that make the new board redundant, or that it makes redundant
+    auto mayBeRedundant = [&](size_t numChips) {
+        return redundant == CompResult::GREATER ? numChips <= numChipsToAdd : numChips >= numChipsToAdd;
+    };
+    auto mayReplace = [&](size_t numChips) {
+        return redundant == CompResult::GREATER ? numChips >= numChipsToAdd : numChips <= numChipsToAdd;
+    };
 
     // Check if the board to add is comparable to any existing boards
-    for (auto& [numChips, boards] : this->winningBoards_) {
-        std::vector<bool> shouldRemove(boards.size(), false);
-        for (size_t i = 0; i < boards.size(); i++) {
-            switch (compareBoards(board, boards[i], Purpose::BOTH)) {
-                case CompResult::LESS:
-                    // Should replace the existing board
-                    shouldRemove[i] = true;
-                    break;
-                case CompResult::GREATER:
-                    // Should not add the new board
-                    return;
-                default:
-                    break;
-            }
+    std::array<std::uint64_t, Board::MAX_CHIPS + 1> checked{};
+    std::vector<const ArchivedBoard*> toRemove;
+    size_t maxChips = entry.board.getN() * entry.board.getK();
+    for (size_t numChips = 0; numChips <= maxChips; numChips++) {
+        ArchiveBucket::Snapshot snapshot = buckets[numChips].getSnapshot();
+        checked[numChips] = snapshot.getNextId();
+
+        bool isRedundant = mayBeRedundant(numChips) && snapshot.find(
+                entry.signature, dominance(redundant), [&](const ArchivedBoard& other) {
+                    return compareBoards(entry.board, entry.signature, other.board, other.signature,
+                                         purpose(numChips, redundant)) == redundant;
+                });
+        if (isRedundant) {
+            // Should not add the new board
+            return false;
+        }
+        if (!mayReplace(numChips)) {
+            continue;
         }
 
         // Remove boards to be replaced
-        size_t i = 0;
-        std::erase_if(boards, [&shouldRemove, &i](const Board&) {
-            return shouldRemove[i++];
+        toRemove.clear();
+        snapshot.find(entry.signature, dominance(replaces), [&](const ArchivedBoard& other) {
+            CompResult result = compareBoards(
+                    entry.board, entry.signature, other.board, other.signature, purpose(numChips, replaces));
+            if (result == replaces) {
+                toRemove.push_back(&other);
+            }
+            return false;
         });
-
-        newSize += boards.size();
+        for (const ArchivedBoard* other : toRemove) {
+            if (buckets[numChips].remove(other->id)) {
+                count--;
+                replaced++;
+                record(false, other->board);
+            }
+        }
     }
 
-    // Update the size
-    this->winningCount_ = newSize;
-#endif
-
-    this->winningBoards_[board.getNumChips()].emplace_back(board);
-    this->winningCount_++;
+    ArchiveBucket& bucket = buckets[numChipsToAdd];
+    std::uint64_t id = bucket.push_back(entry);
+    count++;
+    record(true, entry.board);
+
+    // Compare with the boards published since the first pass
+    for (size_t numChips = 0; numChips <= maxChips; numChips++) {
+        ArchiveBucket::Snapshot snapshot = buckets[numChips].getSnapshot();
+        Purpose direction = purpose(numChips, mayBeRedundant(numChips) ? redundant : replaces);
+        bool isRedundant = snapshot.forEach([&](const ArchivedBoard& other) {
+            if (&buckets[numChips] == &bucket && other.id == id) return false;
+            CompResult result = compareBoards(entry.board, entry.signature, other.board, other.signature, direction);
+            if (result == replaces && buckets[numChips].remove(other.id)) {
+                count--;
+                replaced++;
+                record(false, other.board);
+            }
+            return result == redundant;
+        }, checked[numChips]);
+        if (isRedundant) {
+            if (bucket.remove(id)) {
+                count--;
+                record(false, entry.board);
+                return false;
+            }
+            return true;
+        }
+    }
+    return true;
+}
 
-#ifndef TIDY_ON_INSERT
-    if (this->winningCount_ >= this->winningPruneThreshold_) {
+void Archive::addWinning(const Board& board) noexcept {
+#ifdef TIDY_ON_INSERT
+    bool kept = addTidy(this->winningBoards_, this->winningCount_, ArchivedBoard(board), CompResult::GREATER,
+                        this->journal_, this->replaced_);
+    kept ? this->inserted_++ : this->rejected_++;
+#else
+    this->inserted_++;
+    this->winningBoards_[board.getNumChips()].push_back(ArchivedBoard(board));
+    if (this->journal_) this->journal_->append(ArchiveJournal::RecordType::ADD_WINNING, board);
+    if (++this->winningCount_ >= this->winningPruneThreshold_) {
         this->pruneWinningBoards();
     }
 #endif
@@ -134,67 +240,69 @@ void Archive::addWinning(const Board& board) noexcept {
 
 void Archive::addLosing(const Board& board) noexcept {
 #ifdef TIDY_ON_INSERT
-    size_t newSize = 0;
-
-    // Check if the board to add is comparable to any existing boards
-    for (auto& [numChips, boards] : this->losingBoards_) {
-        std::vector<bool> shouldRemove(boards.size(), false);
-        for (size_t i = 0; i < boards.size(); i++) {
-            switch (compareBoards(board, boards[i], Purpose::BOTH)) {
-                case CompResult::GREATER:
-                    // Should replace the existing board
-                    shouldRemove[i] = true;
-                    break;
-                case CompResult::LESS:
-                    // Should not add the new board
-                    return;
-                default:
-                    break;
-            }
-        }
-
-        // Remove boards to be replaced
-        size_t i = 0;
-        std::erase_if(boards, [&shouldRemove, &i](const Board&) {
-            return shouldRemove[i++];
-        });
-
-        newSize += boards.size();
-    }
-
-    // Update the size
-    this->losingCount_ = newSize;
-#endif
-
-    this->losingBoards_[board.getNumChips()].emplace_back(board);
-    this->losingCount_++;
-
-#ifndef TIDY_ON_INSERT
-    if (this->losingCount_ >= this->losingPruneThreshold_) {
+    bool kept = addTidy(this->losingBoards_, this->losingCount_, ArchivedBoard(board), CompResult::LESS,
+                        this->journal_, this->replaced_);
+    kept ? this->inserted_++ : this->rejected_++;
+#else
+    this->inserted_++;
+    this->losingBoards_[board.getNumChips()].push_back(ArchivedBoard(board));
+    if (this->journal_) this->journal_->append(ArchiveJournal::RecordType::ADD_LOSING, board);
+    if (++this->losingCount_ >= this->losingPruneThreshold_) {
         this->pruneLosingBoards();
     }
 #endif
 }
 
-bool findAnyMatchThread(
-        const Board& target, const std::vector<Board>& boards, Purpose purpose,
-        const std::vector<CompResult>& expectations, std::atomic<size_t>& counter) noexcept {
+// Helper function
+bool findAnyMatch(
+        const Board& target, const BoardSignature& signature, const ArchiveBucket::Snapshot& boards, Purpose purpose,
+        const std::vector<CompResult>& expectations, size_t threads, size_t& scanned) noexcept {
+
+    // Boards that match are below the target if we look for a greater result, and above it otherwise
+    bool lookForGreater = std::find(expectations.begin(), expectations.end(), CompResult::GREATER) != expectations.end();
+    Dominance dominance = lookForGreater ? Dominance::BELOW : Dominance::ABOVE;
+    auto matches = [&](const ArchivedBoard& entry, size_t& count) {
+        count++;
+        CompResult result = compareBoards(target, signature, entry.board, entry.signature, purpose);
+        return std::find(expectations.begin(), expectations.end(), result) != expectations.end();
+    };
+
+    // Small buckets are not worth forking for
+    size_t t_ = std::max(std::min(threads, boards.countSuperBlocks()), (size_t)1);
+    if (t_ == 1) {
+        return boards.find(signature, dominance, [&](const ArchivedBoard& entry) { return matches(entry, scanned); });
+    }
 
-    while (true) {
-        size_t i = counter.fetch_add(1, std::memory_order_relaxed);
-        if (i >= boards.size()) {
-            break;
-        }
+    // Fork-join on the shared pool. The tasks share the super-blocks of the bucket, and the first task to find a match
+    // cancels the others.
+    std::atomic<size_t> counter = 0, totalScanned = 0;
+    std::atomic<bool> found = false;
+    TaskGroup group(ThreadPool::getShared());
+    for (size_t i = 0; i < t_; i++) {
+        group.run([&]() {
+            size_t localScanned = 0;
+            auto stopOrMatches = [&](const ArchivedBoard& entry) {
+                return group.isCancelled() || matches(entry, localScanned);
+            };
+            while (!group.isCancelled()) {
+                size_t s = counter.fetch_add(1, std::memory_order_relaxed);
+                if (s >= boards.countSuperBlocks()) {
+                    break;
+                }
 
-        CompResult result = compareBoards(target, boards[i], purpose);
-        if (std::find(expectations.begin(), expectations.end(), result) != expectations.end()) {
-            // If found, skip the rest
-            counter.store(boards.size(), std::memory_order_relaxed);
-            return true;
-        }
+                // The search also stops early when cancelled, which is not a match
+                if (boards.findInSuperBlock(s, signature, dominance, stopOrMatches) && !group.isCancelled()) {
+                    found.store(true, std::memory_order_relaxed);
+                    group.cancel();
+                }
+            }
+            totalScanned.fetch_add(localScanned, std::memory_order_relaxed);
+        });
     }
+    group.wait();
 
-    return false;
+    scanned += totalScanned.load(std::memory_order_relaxed);
+    return found.load(std::memory_order_relaxed);
 }
 
 Player Archive::predictWinner(const GameState& gameState, size_t threads) const noexcept {
@@ -207,234 +315,264 @@ Player Archive::predictWinner(const GameState& gameState, size_t threads) const
     // Get the board and restore any moved chip
     const Board& board = gameState.getBoardWithoutMovedChips();
     size_t numChips = board.getNumChips();
+    BoardSignature signature(board);
+    EpochManager::Guard guard;
+
+    static const std::vector<CompResult> greaterOrEqual = { CompResult::GREATER, CompResult::EQUAL };
+    static const std::vector<CompResult> greater = { CompResult::GREATER };
+    static const std::vector<CompResult> lessOrEqual = { CompResult::LESS, CompResult::EQUAL };
+    static const std::vector<CompResult> less = { CompResult::LESS };
+    size_t scanned = 0;
 
-    for (const auto& [numChipsInWinningBoard, winningBoards] : this->winningBoards_) {
+    for (size_t numChipsInWinningBoard = 0; numChipsInWinningBoard <= numChips; numChipsInWinningBoard++) {
         // Skip winning boards with more chips than the target game state
-        if (numChipsInWinningBoard > numChips) {
+        ArchiveBucket::Snapshot winningBoards = this->winningBoards_[numChipsInWinningBoard].getSnapshot();
+        if (!winningBoards.countSuperBlocks()) {
             continue;
         }
 
-        // Multithreading
-        std::atomic<size_t> counter = 0;
-        std::vector<std::future<bool>> futures;
-        size_t t_ = std::max(std::min(threads, winningBoards.size() / 2), (size_t)1);
-        futures.reserve(t_);
-
-        // Compare with all winning boards
-        for (size_t i = 0; i < t_; i++) {
-            if (numChipsInWinningBoard == numChips) {
-                futures.push_back(std::async(
-                        std::launch::async,
-                        findAnyMatchThread,
-                        std::ref(board), std::ref(winningBoards), Purpose::BOTH,
-                        std::vector{ CompResult::GREATER, CompResult::EQUAL }, std::ref(counter)));
-            } else {
-                futures.push_back(std::async(
-                        std::launch::async,
-                        findAnyMatchThread,
-                        std::ref(board), std::ref(winningBoards), Purpose::GREATER,
-                        std::vector{ CompResult::GREATER }, std::ref(counter)));
-            }
-        }
-
-        // Wait for all threads to finish
-        bool found = false;
-        for (std::future<bool>& future : futures) {
-            if (future.get()) {
-                found = true;
-            }
-        }
+        // Compare with the winning boards that may be less than the target
+        bool found = numChipsInWinningBoard == numChips
+                     ? findAnyMatch(board, signature, winningBoards, Purpose::BOTH, greaterOrEqual, threads, scanned)
+                     : findAnyMatch(board, signature, winningBoards, Purpose::GREATER, greater, threads, scanned);
         if (found) {
-            return Player::PUSHER;
+            return this->countQuery(numChips, Player::PUSHER, scanned);
         }
     }
 
-    for (const auto& [numChipsInLosingBoard, losingBoards] : this->losingBoards_) {
+    // Boards of the same game never have more chips than the board is sized for
+    size_t maxChips = board.getN() * board.getK();
+    for (size_t numChipsInLosingBoard = numChips; numChipsInLosingBoard <= maxChips; numChipsInLosingBoard++) {
         // Skip losing boards with fewer chips than the target game state
-        if (numChipsInLosingBoard < numChips) {
+        ArchiveBucket::Snapshot losingBoards = this->losingBoards_[numChipsInLosingBoard].getSnapshot();
+        if (!losingBoards.countSuperBlocks()) {
             continue;
         }
 
-        // Multithreading
-        std::atomic<size_t> counter = 0;
-        std::vector<std::future<bool>> futures;
-        size_t t_ = std::max(std::min(threads, losingBoards.size() / 2), (size_t)1);
-        futures.reserve(t_);
-
-        // Compare with all losing boards
-        for (size_t i = 0; i < t_; i++) {
-            if (numChipsInLosingBoard == numChips) {
-                futures.push_back(std::async(
-                        std::launch::async,
-                        findAnyMatchThread,
-                        std::ref(board), std::ref(losingBoards), Purpose::BOTH,
-                        std::vector{ CompResult::LESS, CompResult::EQUAL }, std::ref(counter)));
-            } else {
-                futures.push_back(std::async(
-                        std::launch::async,
-                        findAnyMatchThread,
-                        std::ref(board), std::ref(losingBoards), Purpose::LESS,
-                        std::vector{ CompResult::LESS }, std::ref(counter)));
-            }
-        }
-
-        // Wait for all threads to finish
-        bool found = false;
-        for (std::future<bool>& future : futures) {
-            if (future.get()) {
-                found = true;
-            }
-        }
+        // Compare with the losing boards that may be greater than the target
+        bool found = numChipsInLosingBoard == numChips
+                     ? findAnyMatch(board, signature, losingBoards, Purpose::BOTH, lessOrEqual, threads, scanned)
+                     : findAnyMatch(board, signature, losingBoards, Purpose::LESS, less, threads, scanned);
         if (found) {
-            return Player::REMOVER;
+            return this->countQuery(numChips, Player::REMOVER, scanned);
         }
     }
 
-    return Player::NONE;
+    return this->countQuery(numChips, Player::NONE, scanned);
 }
 
-void Archive::prune(int verbose) noexcept {
-    pruneWinningBoards(verbose);
-    pruneLosingBoards(verbose);
+Player Archive::countQuery(size_t numChips, Player winner, size_t scanned) const noexcept {
+    QueryCounters& counters = this->queryCounters_[numChips];
+    counters.calls.fetch_add(1, std::memory_order_relaxed);
+    if (winner != Player::NONE) {
+        counters.hits.fetch_add(1, std::memory_order_relaxed);
+    }
+    counters.scanned.fetch_add(scanned, std::memory_order_relaxed);
+    return winner;
 }
 
-void Archive::pruneWinningBoards(int verbose) noexcept {
-    size_t startCount = this->winningCount_;
+// Helper function
+std::vector<ArchivedBoard> flattenBuckets(const Archive::Buckets& buckets) noexcept {
+    EpochManager::Guard guard;
+    std::vector<ArchivedBoard> result;
+    for (const ArchiveBucket& bucket : buckets) {
+        bucket.getSnapshot().forEach([&result](const ArchivedBoard& entry) {
+            result.push_back(entry);
+            return false;
+        });
+    }
+    return result;
+}
 
-    // Flatten the winning boards
-    std::vector<Board> winningBoards;
-    std::vector<bool> shouldRemove;
-    for (auto& [numChips, boards] : this->winningBoards_) {
-        for (Board& board : boards) {
-            winningBoards.emplace_back(board);
-        }
+/**
+ * Helper function
+ *
+ * Removes every board that another board makes redundant, and keeps the first of equal boards. Strict dominance is
+ * transitive, so whether a board is redundant does not depend on which other boards are removed, and every board is
+ * checked independently against the whole archive, in parallel on the shared pool. A board is only compared with the
+ * buckets whose chip counts allow them to make it redundant, through their bounds index, and with a one-directional
+ * comparison outside its own bucket.
+ *
+ * Stops early once isStopRequested(), keeping the boards not checked yet, so a stopped run does not wait for a full
+ * prune. Prints the progress every few seconds, and the throughput at the end, if verbose.
+ *
+ * @param redundant The comparison result that makes a board redundant.
+ * @return Number of boards removed.
+ */
+size_t pruneBuckets(Archive::Buckets& buckets, CompResult redundant, const char* name, int verbose) noexcept {
+    using clock = std::chrono::steady_clock;
+    constexpr size_t TILE_SIZE = 64;
+    constexpr auto REPORT_INTERVAL = std::chrono::seconds(10);
+
+    EpochManager::Guard guard;
+    auto start = clock::now();
+    size_t startComparisons = getCompareStats().calls;
+
+    // Flatten the boards in their saved order, and take a snapshot of every bucket
+    std::vector<ArchiveBucket::Snapshot> snapshots;
+    std::vector<const ArchivedBoard*> boards;
+    for (const ArchiveBucket& bucket : buckets) {
+        snapshots.push_back(bucket.getSnapshot());
+        snapshots.back().forEach([&boards](const ArchivedBoard& entry) {
+            boards.push_back(&entry);
+            return false;
+        });
+    }
+    if (boards.empty()) {
+        return 0;
     }
-    shouldRemove.resize(winningBoards.size(), false);
 
-    // Mark redundant winning boards
-    for (size_t i = 0; i < winningBoards.size(); i++) {
-        for (size_t j = i + 1; j < winningBoards.size(); j++) {
-            if (shouldRemove[i] || shouldRemove[j]) {
-                break;
-            }
-            switch (compareBoards(winningBoards[i], winningBoards[j], Purpose::BOTH)) {
-                case CompResult::GREATER:
-                    shouldRemove[i] = true;
-                    break;
-                case CompResult::LESS:
-                case CompResult::EQUAL:
-                    shouldRemove[j] = true;
-                    break;
-                default:
+    // Only boards with fewer chips can be less than a board, and only boards with more can be greater
+    Dominance dominance = redundant == CompResult::GREATER ? Dominance::BELOW : Dominance::ABOVE;
+    Purpose purpose = redundant == CompResult::GREATER ? Purpose::GREATER : Purpose::LESS;
+    size_t maxChips = boards[0]->board.getN() * boards[0]->board.getK();
+    auto isRedundant = [&](const ArchivedBoard& entry) {
+        size_t numChips = entry.board.getNumChips();
+        size_t first = redundant == CompResult::GREATER ? 0 : numChips;
+        size_t last = redundant == CompResult::GREATER ? numChips : maxChips;
+        for (size_t c = first; c <= last; c++) {
+            bool found = snapshots[c].find(entry.signature, dominance, [&](const ArchivedBoard& other) {
+                if (c != numChips) {
+                    return compareBoards(entry.board, entry.signature, other.board, other.signature, purpose)
+                           == redundant;
+                }
+                if (other.id == entry.id) return false;
+                CompResult result = compareBoards(
+                        entry.board, entry.signature, other.board, other.signature, Purpose::BOTH);
+                return result == redundant || (result == CompResult::EQUAL && other.id < entry.id);
+            });
+            if (found) return true;
+        }
+        return false;
+    };
+
+    // Check the tiles of boards in parallel
+    std::vector<std::uint8_t> shouldRemove(boards.size(), false);
+    std::atomic<size_t> nextTile = 0, checked = 0;
+    std::mutex reportMutex;
+    auto lastReport = start;
+    ThreadPool& pool = ThreadPool::getShared();
+    TaskGroup group(pool);
+    for (size_t t = 0; t <= pool.getNumThreads(); t++) {
+        group.run([&]() {
+            while (!isStopRequested()) {
+                size_t begin = nextTile.fetch_add(1, std::memory_order_relaxed) * TILE_SIZE;
+                if (begin >= boards.size()) {
                     break;
+                }
+                size_t end = std::min(begin + TILE_SIZE, boards.size());
+                for (size_t i = begin; i < end; i++) {
+                    shouldRemove[i] = isRedundant(*boards[i]);
+                }
+                checked.fetch_add(end - begin, std::memory_order_relaxed);
+
+                // Report the progress, from one thread at a time
+                std::unique_lock lock(reportMutex, std::try_to_lock);
+                if (verbose && lock.owns_lock() && clock::now() - lastReport >= REPORT_INTERVAL) {
+                    lastReport = clock::now();
+                    double seconds = std::chrono::duration<double>(lastReport - start).count();
+                    printf("Pruning %s boards: %zu / %zu (%.0f boards/s)\n", name, checked.load(), boards.size(),
+                           (double)checked.load() / seconds);
+                    fflush(stdout);
+                }
             }
-        }
+        });
     }
+    group.wait();
 
-    // Remove redundant winning boards
-    size_t i = 0;
-    std::erase_if(winningBoards, [&shouldRemove, &i](const Board&) {
-        return shouldRemove[i++];
-    });
+    // Remove the redundant boards
+    size_t removed = 0;
+    for (size_t i = 0; i < boards.size(); i++) {
+        if (shouldRemove[i]) {
+            removed += buckets[boards[i]->board.getNumChips()].remove(boards[i]->id);
+        }
+    }
 
-    // Rebuild the winning boards
-    this->winningBoards_.clear();
-    for (const Board& board : winningBoards) {
-        this->winningBoards_[board.getNumChips()].emplace_back(board);
+    if (verbose && checked < boards.size()) {
+        printf("Stopped pruning %s boards after %zu / %zu\n", name, checked.load(), boards.size());
+    } else if (verbose) {
+        double seconds = std::chrono::duration<double>(clock::now() - start).count();
+        size_t comparisons = getCompareStats().calls - startComparisons;
+        printf("Checked %zu %s boards in %.2f seconds: %zu comparisons (%.0f boards/s, %.0f comparisons/s)\n",
+               boards.size(), name, seconds, comparisons, (double)boards.size() / seconds,
+               (double)comparisons / seconds);
     }
+    return removed;
+}
+
+void Archive::prune(int verbose) noexcept {
+    pruneWinningBoards(verbose);
+    pruneLosingBoards(verbose);
+
+    // Free the storage replaced by compacting the buckets, unless a query still holds it
+    EpochManager::getShared().reclaim();
+}
+
+void Archive::pruneWinningBoards(int verbose) noexcept {
+    size_t startCount = this->winningCount_;
+    size_t removed = pruneBuckets(this->winningBoards_, CompResult::GREATER, "winning", verbose);
+    this->winningCount_ -= removed;
+    this->pruned_ += removed;
 
-    // Update the winning count and prune threshold
-    this->winningCount_ = winningBoards.size();
+    // Update the prune threshold
     this->winningPruneThreshold_ = std::max((size_t)100, this->winningCount_ * 3);
 
 #ifdef TIDY_ON_INSERT
     if (verbose) {
-        printf("Pruned winning boards: %zu -> %zu\n", startCount, this->winningCount_);
+        printf("Pruned winning boards: %zu -> %zu\n", startCount, this->winningCount_.load());
     }
 #endif
 }
 
 void Archive::pruneLosingBoards(int verbose) noexcept {
     size_t startCount = this->losingCount_;
+    size_t removed = pruneBuckets(this->losingBoards_, CompResult::LESS, "losing", verbose);
+    this->losingCount_ -= removed;
+    this->pruned_ += removed;
 
-    // Flatten the losing boards
-    std::vector<Board> losingBoards;
-    std::vector<bool> shouldRemove;
-    for (auto& [numChips, boards] : this->losingBoards_) {
-        for (Board& board : boards) {
-            losingBoards.emplace_back(board);
-        }
-    }
-    shouldRemove.resize(losingBoards.size(), false);
-
-    // Mark redundant losing boards
-    for (size_t i = 0; i < losingBoards.size(); i++) {
-        for (size_t j = i + 1; j < losingBoards.size(); j++) {
-            if (shouldRemove[i] || shouldRemove[j]) {
-                break;
-            }
-            switch (compareBoards(losingBoards[i], losingBoards[j], Purpose::BOTH)) {
-                case CompResult::LESS:
-                    shouldRemove[i] = true;
-                    break;
-                case CompResult::GREATER:
-                case CompResult::EQUAL:
-                    shouldRemove[j] = true;
-                    break;
-                default:
-                    break;
-            }
-        }
-    }
-
-    // Remove redundant losing boards
-    size_t i = 0;
-    std::erase_if(losingBoards, [&shouldRemove, &i](const Board&) {
-        return shouldRemove[i++];
-    });
-
-    // Rebuild the winning boards
-    this->losingBoards_.clear();
-    for (const Board& board : losingBoards) {
-        this->losingBoards_[board.getNumChips()].emplace_back(board);
-    }
-
-    // Update the losing count and prune threshold
-    this->losingCount_ = losingBoards.size();
+    // Update the prune threshold
     this->losingPruneThreshold_ = std::max((size_t)100, this->losingCount_ * 3);
 
 #ifdef TIDY_ON_INSERT
     if (verbose) {
-        printf("Pruned losing boards: %zu -> %zu\n", startCount, this->losingCount_);
+        printf("Pruned losing boards: %zu -> %zu\n", startCount, this->losingCount_.load());
     }
 #endif
 }
 
 std::vector<Board> Archive::getWinningBoardsAsVector() const noexcept {
     std::vector<Board> result;
-    for (const auto& [numChips, boards] : this->winningBoards_) {
-        for (const Board& board : boards) {
-            result.push_back(board);
-        }
+    for (const ArchivedBoard& entry : flattenBuckets(this->winningBoards_)) {
+        result.push_back(entry.board);
     }
     return result;
 }
 
 std::vector<Board> Archive::getLosingBoardsAsVector() const noexcept {
     std::vector<Board> result;
-    for (const auto& [numChips, boards] : this->losingBoards_) {
-        for (const Board& board : boards) {
-            result.push_back(board);
-        }
+    for (const ArchivedBoard& entry : flattenBuckets(this->losingBoards_)) {
+        result.push_back(entry.board);
     }
     return result;
 }
 
-const std::map<size_t, std::vector<Board>>& Archive::getWinningBoards() const noexcept {
+int Archive::getGoal() const noexcept {
+    return this->goal_;
+}
+
+ArchiveFormat Archive::getFileFormat() const noexcept {
+    return this->fileFormat_;
+}
+
+ArchiveJournal* Archive::getJournal() const noexcept {
+    return this->journal_;
+}
+
+const Archive::Buckets& Archive::getWinningBoards() const noexcept {
     return this->winningBoards_;
 }
 
-const std::map<size_t, std::vector<Board>>& Archive::getLosingBoards() const noexcept {
+const Archive::Buckets& Archive::getLosingBoards() const noexcept {
     return this->losingBoards_;
 }
 
@@ -445,3 +583,55 @@ size_t Archive::getWinningCount() const noexcept {
 size_t Archive::getLosingCount() const noexcept {
     return this->losingCount_;
 }
+
+ArchiveStats Archive::getStats() const noexcept {
+    ArchiveStats stats;
+    for (size_t c = 0; c <= Board::MAX_CHIPS; c++) {
+        const QueryCounters& counters = this->queryCounters_[c];
+        stats.queries[c] = { counters.calls.load(std::memory_order_relaxed),
+                             counters.hits.load(std::memory_order_relaxed),
+                             counters.scanned.load(std::memory_order_relaxed) };
+    }
+    stats.inserted = this->inserted_;
+    stats.rejected = this->rejected_;
+    stats.replaced = this->replaced_;
+    stats.pruned = this->pruned_;
+    return stats;
+}
+
+ArchiveSnapshot::ArchiveSnapshot(const Archive::Buckets& buckets, int goal) : goal_(goal) {
+    for (size_t c = 0; c < buckets.size(); c++) {
+        this->buckets_[c] = buckets[c].getSharedSnapshot();
+    }
+}
+
+BinaryArchive ArchiveSnapshot::pack() const {
+    BinaryArchive archive;
+    BinaryArchiveHeader& header = archive.header;
+    header.goal = this->goal_;
+
+    // Room for every published board, including the few removed ones, so the chips are never moved while copied
+    size_t published = 0;
+    for (const ArchiveBucket::SharedSnapshot& bucket : this->buckets_) {
+        published += bucket.getPublishedSize();
+    }
+
+    // The buckets are in ascending number of chips, as the binary layout requires
+    for (size_t c = 0; c < this->buckets_.size(); c++) {
+        header.bucketOffsets[c] = header.numBoards;
+        this->buckets_[c].forEach([&archive, &header, published](const ArchivedBoard& entry) {
+            if (header.numBoards == 0) {
+                header.n = entry.board.getN();
+                header.k = entry.board.getK();
+                header.rowSize = header.n * header.k;
+                archive.chips.reserve(published * header.rowSize);
+            }
+            std::span<const Chip> chips = entry.board.getChips();
+            archive.chips.insert(archive.chips.end(), chips.begin(), chips.end());
+            header.numBoards++;
+            return false;
+        });
+    }
+    header.bucketOffsets.back() = header.numBoards;
+    return archive;
+}
@@ -0,0 +1,281 @@
+#include <bit>
+#include "archive_bucket.h"
+#include "epoch.h"
+
+namespace {
+    static_assert(sizeof(BoardSignature) % sizeof(std::uint64_t) == 0);
+
+    // The words of the bounds are written by the thread holding the mutex while readers load them
+    using Words = std::array<std::uint64_t, sizeof(BoardSignature) / sizeof(std::uint64_t)>;
+
+    BoardSignature loadWords(const Words& words) noexcept {
+        Words copy;
+        for (size_t i = 0; i < words.size(); i++) {
+            copy[i] = std::atomic_ref(const_cast<std::uint64_t&>(words[i])).load(std::memory_order_relaxed);
+        }
+        return std::bit_cast<BoardSignature>(copy);
+    }
+
+    void storeWords(Words& words, const BoardSignature& signature) noexcept {
+        Words copy = std::bit_cast<Words>(signature);
+        for (size_t i = 0; i < words.size(); i++) {
+            std::atomic_ref(words[i]).store(copy[i], std::memory_order_relaxed);
+        }
+    }
+}
+
+ArchivedBoard::ArchivedBoard(const Board& board) noexcept : board(board), signature(board) {}
+
+ArchiveBucket::Storage::Storage(size_t capacity, std::uint64_t nextId) noexcept
+        : capacity(capacity), chunks(new std::shared_ptr<Chunk>[capacity]), baseId(nextId) {}
+
+ArchiveBucket::Snapshot::Snapshot(const Storage* storage, size_t size) noexcept : storage_(storage), size_(size) {}
+
+size_t ArchiveBucket::Snapshot::countSuperBlocks() const noexcept {
+    return (this->size_ + CHUNK_SIZE - 1) / CHUNK_SIZE;
+}
+
+std::uint64_t ArchiveBucket::Snapshot::getNextId() const noexcept {
+    if (this->size_ == 0) return this->storage_->baseId;
+    return std::max(this->storage_->baseId, this->at(this->size_ - 1).id + 1);
+}
+
+const ArchivedBoard& ArchiveBucket::Snapshot::at(size_t i) const noexcept {
+    return this->storage_->chunks[i / CHUNK_SIZE]->entries[i % CHUNK_SIZE];
+}
+
+ArchiveBucket::ArchiveBucket() noexcept
+        : storage_(new Storage(0, 0)), live_(0), removed_(0), removals_(0), nextId_(0) {}
+
+ArchiveBucket::~ArchiveBucket() {
+    delete this->storage_.load();
+}
+
+BoardSignature ArchiveBucket::Bounds::loadMin() const noexcept {
+    return loadWords(this->min);
+}
+
+BoardSignature ArchiveBucket::Bounds::loadMax() const noexcept {
+    return loadWords(this->max);
+}
+
+void ArchiveBucket::Bounds::expand(const BoardSignature& signature) noexcept {
+    if (!this->live.load(std::memory_order_relaxed)) {
+        this->assign(signature, signature, true);
+        return;
+    }
+    BoardSignature newMin = this->loadMin(), newMax = this->loadMax();
+    newMin.expandMin(signature);
+    newMax.expandMax(signature);
+    storeWords(this->min, newMin);
+    storeWords(this->max, newMax);
+}
+
+void ArchiveBucket::Bounds::assign(const BoardSignature& newMin, const BoardSignature& newMax, bool newLive) noexcept {
+    if (newLive) {
+        storeWords(this->min, newMin);
+        storeWords(this->max, newMax);
+    }
+    this->live.store(newLive, std::memory_order_release);
+}
+
+bool ArchiveBucket::mayContain(const Bounds& bounds, const BoardSignature& target, Dominance dominance) noexcept {
+    // An entry below the target needs the minimum of the group below the target, and vice versa
+    if (!bounds.live.load(std::memory_order_acquire)) return false;
+    return dominance == Dominance::BELOW ? bounds.loadMin().isBelow(target) : target.isBelow(bounds.loadMax());
+}
+
+std::uint64_t ArchiveBucket::push_back(ArchivedBoard entry) {
+    std::lock_guard lock(this->mutex_);
+
+    // Grow the directory if the next entry needs a chunk it has no room for
+    Storage* storage = this->storage_.load(std::memory_order_relaxed);
+    size_t size = storage->size.load(std::memory_order_relaxed);
+    if (size == storage->capacity * CHUNK_SIZE) {
+        this->rebuild(std::max(size * 2, CHUNK_SIZE * 4), false);
+    }
+
+    entry.id = this->nextId_++;
+    append(*this->storage_.load(std::memory_order_relaxed), std::move(entry));
+    this->live_.fetch_add(1, std::memory_order_relaxed);
+    return this->nextId_ - 1;
+}
+
+void ArchiveBucket::append(Storage& storage, ArchivedBoard entry) {
+    size_t size = storage.size.load(std::memory_order_relaxed);
+    std::shared_ptr<Chunk>& chunk = storage.chunks[size / CHUNK_SIZE];
+    if (!chunk) {
+        chunk = std::make_shared<Chunk>();
+    }
+
+    // Widen the bounds of the block and the chunk, starting them if needed. Readers that see the wider bounds before
+    // the entry is published only scan a little more.
+    size_t i = size % CHUNK_SIZE;
+    chunk->blockBounds[i / BLOCK_SIZE].expand(entry.signature);
+    chunk->bounds.expand(entry.signature);
+    chunk->entries[i] = std::move(entry);
+
+    // Publish the entry along with the bounds. Sequentially consistent, so that of two threads that each publish an
+    // entry and then take a snapshot, at least one sees the other's entry.
+    storage.size.store(size + 1, std::memory_order_seq_cst);
+}
+
+bool ArchiveBucket::remove(std::uint64_t id) {
+    std::lock_guard lock(this->mutex_);
+    Storage* storage = this->storage_.load(std::memory_order_relaxed);
+    Snapshot snapshot(storage, storage->size.load(std::memory_order_relaxed));
+
+    // Binary search the entry, as the ids increase with the position
+    size_t lo = 0, hi = snapshot.size_;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (snapshot.at(mid).id < id) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo == snapshot.size_ || snapshot.at(lo).id != id) {
+        return false;
+    }
+    Chunk& chunk = *storage->chunks[lo / CHUNK_SIZE];
+    if (chunk.removed[lo % CHUNK_SIZE].load(std::memory_order_relaxed)) {
+        return false;
+    }
+
+    // Number the removal, so shared snapshots taken before it still see the entry
+    std::uint64_t removal = this->removals_.load(std::memory_order_relaxed) + 1;
+    chunk.removed[lo % CHUNK_SIZE].store(removal, std::memory_order_relaxed);
+    this->removals_.store(removal, std::memory_order_release);
+
+    // Shrink the bounds to the live entries
+    size_t count = std::min(CHUNK_SIZE, snapshot.size_ - lo / CHUNK_SIZE * CHUNK_SIZE);
+    updateBlockBounds(chunk, lo % CHUNK_SIZE / BLOCK_SIZE, count);
+    updateChunkBounds(chunk);
+
+    size_t live = this->live_.fetch_sub(1, std::memory_order_relaxed) - 1;
+    this->removed_++;
+
+    // Compact once the tombstones take up a chunk of their own, so queries never fork over more chunks than the live
+    // entries need. A few tombstones are tolerated, so an entry removed and added back doesn't compact every time.
+    size_t chunks = (snapshot.size_ + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    if (this->removed_ >= BLOCK_SIZE && (live + CHUNK_SIZE - 1) / CHUNK_SIZE < chunks) {
+        this->rebuild(live * 2, true);
+    }
+    return true;
+}
+
+void ArchiveBucket::clear() {
+    std::lock_guard lock(this->mutex_);
+    this->live_.store(0, std::memory_order_relaxed);
+    this->removed_ = 0;
+    this->publish(new Storage(0, this->nextId_));
+}
+
+void ArchiveBucket::rebuild(size_t capacity, bool compact) {
+    Storage* old = this->storage_.load(std::memory_order_relaxed);
+    size_t oldSize = old->size.load(std::memory_order_relaxed);
+    auto* storage = new Storage((capacity + CHUNK_SIZE - 1) / CHUNK_SIZE, this->nextId_);
+
+    if (compact) {
+        // Copy the live entries into new chunks, so readers of the old storage are not disturbed
+        size_t size = 0;
+        Snapshot(old, oldSize).forEach([storage, &size](const ArchivedBoard& entry) {
+            std::shared_ptr<Chunk>& chunk = storage->chunks[size / CHUNK_SIZE];
+            if (!chunk) {
+                chunk = std::make_shared<Chunk>();
+            }
+            chunk->entries[size++ % CHUNK_SIZE] = entry;
+            return false;
+        });
+
+        // Compute the bounds once the chunks are full, rather than entry by entry
+        for (size_t c = 0; c * CHUNK_SIZE < size; c++) {
+            Chunk& chunk = *storage->chunks[c];
+            size_t count = std::min(CHUNK_SIZE, size - c * CHUNK_SIZE);
+            for (size_t b = 0; b * BLOCK_SIZE < count; b++) {
+                updateBlockBounds(chunk, b, count);
+            }
+            updateChunkBounds(chunk);
+        }
+
+        storage->size.store(size, std::memory_order_relaxed);
+        this->removed_ = 0;
+        this->live_.store(size, std::memory_order_relaxed);
+    } else {
+        // Share the chunks with the old storage
+        std::copy(old->chunks.get(), old->chunks.get() + old->capacity, storage->chunks.get());
+        storage->baseId = old->baseId;
+        storage->size.store(oldSize, std::memory_order_relaxed);
+    }
+
+    this->publish(storage);
+}
+
+void ArchiveBucket::updateBlockBounds(Chunk& chunk, size_t block, size_t count) {
+    // Computed aside and then stored, so readers never see bounds tighter than the live entries
+    BoardSignature min, max;
+    bool live = false;
+    for (size_t i = block * BLOCK_SIZE; i < std::min((block + 1) * BLOCK_SIZE, count); i++) {
+        if (chunk.removed[i].load(std::memory_order_relaxed)) continue;
+        const BoardSignature& signature = chunk.entries[i].signature;
+        if (live) {
+            min.expandMin(signature);
+            max.expandMax(signature);
+        } else {
+            min = max = signature;
+            live = true;
+        }
+    }
+    chunk.blockBounds[block].assign(min, max, live);
+}
+
+void ArchiveBucket::updateChunkBounds(Chunk& chunk) {
+    BoardSignature min, max;
+    bool live = false;
+    for (const Bounds& block : chunk.blockBounds) {
+        if (!block.live.load(std::memory_order_relaxed)) continue;
+        if (live) {
+            min.expandMin(block.loadMin());
+            max.expandMax(block.loadMax());
+        } else {
+            min = block.loadMin();
+            max = block.loadMax();
+            live = true;
+        }
+    }
+    chunk.bounds.assign(min, max, live);
+}
+
+void ArchiveBucket::publish(Storage* storage) {
+    // Delete the old storage once no reader can still see it
+    Storage* old = this->storage_.exchange(storage, std::memory_order_seq_cst);
+    EpochManager::getShared().retire([old]() { delete old; });
+}
+
+ArchiveBucket::Snapshot ArchiveBucket::getSnapshot() const noexcept {
+    const Storage* storage = this->storage_.load(std::memory_order_seq_cst);
+    return { storage, storage->size.load(std::memory_order_seq_cst) };
+}
+
+ArchiveBucket::SharedSnapshot ArchiveBucket::getSharedSnapshot() const {
+    // The chunks never change below the published size, and the storage that replaces this one shares or copies them,
+    // so holding the chunks is enough once the pointers are copied
+    EpochManager::Guard guard;
+    SharedSnapshot shared;
+    shared.removals_ = this->removals_.load(std::memory_order_acquire);
+    Snapshot snapshot = this->getSnapshot();
+    shared.chunks_.assign(
+            snapshot.storage_->chunks.get(), snapshot.storage_->chunks.get() + snapshot.countSuperBlocks());
+    shared.size_ = snapshot.size_;
+    return shared;
+}
+
+size_t ArchiveBucket::SharedSnapshot::getPublishedSize() const noexcept {
+    return this->size_;
+}
+
+size_t ArchiveBucket::size() const noexcept {
+    return this->live_.load(std::memory_order_relaxed);
+}
+
+bool ArchiveBucket::empty() const noexcept {
+    return this->size() == 0;
+}
@@ -0,0 +1,511 @@
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <format>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include "archive_file.h"
+#include "thread_pool.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+static const char* BOARD_DELIMITER = "---";
+
+static_assert(std::is_trivially_copyable_v<BinaryArchiveHeader>);
+static_assert(sizeof(BinaryArchiveHeader) == 40 + 8 * (Board::MAX_CHIPS + 2), "BinaryArchiveHeader must not be padded");
+
+ArchiveFormat parseArchiveFormat(const std::string& name) {
+    if (name == "text") return ArchiveFormat::TEXT;
+    if (name == "binary") return ArchiveFormat::BINARY;
+    throw std::invalid_argument(std::format("Unknown archive format: {}", name));
+}
+
+std::string getExtension(ArchiveFormat format) {
+    return format == ArchiveFormat::BINARY ? ".bin" : ".txt";
+}
+
+void BinaryArchiveHeader::validate(std::uintmax_t fileSize) const {
+    if (this->magic != MAGIC) {
+        throw std::runtime_error("Not a binary archive");
+    }
+    if (this->byteOrderMark != BYTE_ORDER_MARK) {
+        throw std::runtime_error("Binary archive written with a different byte order");
+    }
+    if (this->version != VERSION) {
+        throw std::runtime_error(std::format("Unsupported binary archive version: {}", this->version));
+    }
+    if (static_cast<size_t>(this->n) * this->k > Board::MAX_CHIPS || this->rowSize != this->n * this->k) {
+        throw std::runtime_error(std::format("Invalid board size: n={}, k={}", this->n, this->k));
+    }
+    if (this->rowSize == 0 && this->numBoards > 0) {
+        throw std::runtime_error("Binary archive has boards without chips");
+    }
+
+    // A corrupt number of boards must not wrap around to the size of the file
+    std::uint64_t maxBoards = this->rowSize ? (UINT64_MAX - sizeof(BinaryArchiveHeader)) / this->rowSize : 0;
+    if (this->numBoards > maxBoards || fileSize != sizeof(BinaryArchiveHeader) + this->numBoards * this->rowSize) {
+        throw std::runtime_error("Binary archive size does not match its number of boards");
+    }
+    for (size_t c = 0; c <= Board::MAX_CHIPS; c++) {
+        if (this->bucketOffsets[c] > this->bucketOffsets[c + 1]) {
+            throw std::runtime_error("Binary archive bucket offsets are not sorted");
+        }
+    }
+    if (this->bucketOffsets.front() != 0 || this->bucketOffsets.back() != this->numBoards) {
+        throw std::runtime_error("Binary archive bucket offsets do not cover all boards");
+    }
+}
+
+bool isBinaryArchive(const std::filesystem::path& filename) {
+    std::ifstream file(filename, std::ios::binary);
+    std::array<char, 8> magic{};
+    file.read(magic.data(), magic.size());
+    return file && magic == BinaryArchiveHeader::MAGIC;
+}
+
+std::filesystem::path getTemporaryFilename(const std::filesystem::path& filename) {
+    std::filesystem::path temporaryFilename = filename;
+    temporaryFilename += ".tmp";
+    return temporaryFilename;
+}
+
+void syncToDisk(const std::filesystem::path& path) noexcept {
+#ifndef _WIN32
+    int fd = open(path.empty() ? "." : path.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        fsync(fd);
+        ::close(fd);
+    }
+#endif
+}
+
+void replaceFile(const std::filesystem::path& temporaryFilename, const std::filesystem::path& filename) {
+    // Make sure the data reaches the disk before the rename does, so a crash cannot leave an empty file in place
+    syncToDisk(temporaryFilename);
+
+    std::error_code error;
+    std::filesystem::rename(temporaryFilename, filename, error);
+    if (error) {
+        std::filesystem::remove(temporaryFilename, error);
+        throw std::runtime_error(std::format("Failed to replace file: {}", filename.string()));
+    }
+
+    // The rename itself is only durable once the directory holding the file reaches the disk
+    syncToDisk(filename.parent_path());
+}
+
+void saveJsonFile(const nlohmann::json& json, const std::filesystem::path& filename) {
+    std::filesystem::create_directories(filename.parent_path());
+    std::filesystem::path temporaryFilename = getTemporaryFilename(filename);
+    {
+        std::ofstream file(temporaryFilename);
+        file << json.dump(2) << '\n';
+        if (!file) {
+            throw std::runtime_error(std::format("Failed to write file: {}", filename.string()));
+        }
+    }
+    replaceFile(temporaryFilename, filename);
+}
+
+TextArchiveWriter::TextArchiveWriter(const std::filesystem::path& filename)
+        : filename_(filename), temporaryFilename_(getTemporaryFilename(filename)), file_(this->temporaryFilename_) {
+
+    if (!this->file_.is_open()) {
+        throw std::runtime_error(std::format("Failed to open file for writing: {}", filename.string()));
+    }
+    this->buffer_.reserve(BUFFER_SIZE);
+}
+
+TextArchiveWriter::~TextArchiveWriter() {
+    if (this->file_.is_open()) {
+        this->file_.close();
+        std::error_code error;
+        std::filesystem::remove(this->temporaryFilename_, error);
+    }
+}
+
+void TextArchiveWriter::add(const Board& board) {
+    if (this->buffer_.size() + MAX_BOARD_LENGTH > BUFFER_SIZE) {
+        this->flush();
+    }
+    board.appendTo(this->buffer_);
+    this->buffer_.append(BOARD_DELIMITER);
+    this->buffer_.push_back('\n');
+}
+
+void TextArchiveWriter::close() {
+    this->flush();
+    this->file_.close();
+    if (!this->file_) {
+        std::error_code error;
+        std::filesystem::remove(this->temporaryFilename_, error);
+        throw std::runtime_error(std::format("Failed to write file: {}", this->filename_.string()));
+    }
+    replaceFile(this->temporaryFilename_, this->filename_);
+}
+
+void TextArchiveWriter::flush() {
+    this->file_.write(this->buffer_.data(), static_cast<std::streamsize>(this->buffer_.size()));
+    this->buffer_.clear();
+}
+
+BinaryArchiveWriter::BinaryArchiveWriter(const std::filesystem::path& filename, int goal)
+        : filename_(filename), temporaryFilename_(getTemporaryFilename(filename)),
+          file_(this->temporaryFilename_, std::ios::binary), numChips_(0) {
+
+    if (!this->file_.is_open()) {
+        throw std::runtime_error(std::format("Failed to open file for writing: {}", filename.string()));
+    }
+    this->header_.goal = goal;
+    this->buffer_.reserve(BUFFER_SIZE);
+
+    // Reserve the space of the header, which is only complete once all boards are written
+    this->file_.write(reinterpret_cast<const char*>(&this->header_), sizeof(BinaryArchiveHeader));
+}
+
+BinaryArchiveWriter::~BinaryArchiveWriter() {
+    if (this->file_.is_open()) {
+        this->file_.close();
+        std::error_code error;
+        std::filesystem::remove(this->temporaryFilename_, error);
+    }
+}
+
+void BinaryArchiveWriter::add(const Board& board) {
+    if (this->header_.numBoards == 0) {
+        this->header_.n = board.getN();
+        this->header_.k = board.getK();
+        this->header_.rowSize = board.getN() * board.getK();
+    } else if (board.getN() != this->header_.n || board.getK() != this->header_.k) {
+        throw std::invalid_argument("All boards of a binary archive must have the same size");
+    }
+    if (board.getNumChips() < this->numChips_) {
+        throw std::invalid_argument("Boards of a binary archive must come in ascending number of chips");
+    }
+
+    // Close the buckets of the smaller chip counts
+    for (size_t c = this->numChips_ + 1; c <= board.getNumChips(); c++) {
+        this->header_.bucketOffsets[c] = this->header_.numBoards;
+    }
+    this->numChips_ = board.getNumChips();
+
+    if (this->buffer_.size() + this->header_.rowSize > BUFFER_SIZE) {
+        this->flush();
+    }
+    std::span<const Chip> chips = board.getChips();
+    this->buffer_.insert(this->buffer_.end(), chips.begin(), chips.end());
+    this->header_.numBoards++;
+}
+
+void BinaryArchiveWriter::close() {
+    this->flush();
+    for (size_t c = this->numChips_ + 1; c < this->header_.bucketOffsets.size(); c++) {
+        this->header_.bucketOffsets[c] = this->header_.numBoards;
+    }
+
+    this->file_.seekp(0);
+    this->file_.write(reinterpret_cast<const char*>(&this->header_), sizeof(BinaryArchiveHeader));
+    this->file_.close();
+    if (!this->file_) {
+        std::error_code error;
+        std::filesystem::remove(this->temporaryFilename_, error);
+        throw std::runtime_error(std::format("Failed to write file: {}", this->filename_.string()));
+    }
+    replaceFile(this->temporaryFilename_, this->filename_);
+}
+
+void BinaryArchiveWriter::flush() {
+    this->file_.write(this->buffer_.data(), static_cast<std::streamsize>(this->buffer_.size()));
+    this->buffer_.clear();
+}
+
+std::span<const Chip> BinaryArchive::getRow(size_t i) const noexcept {
+    return { this->chips.data() + i * this->header.rowSize, this->header.rowSize };
+}
+
+Board BinaryArchive::getBoard(size_t i) const {
+    return { this->header.n, this->header.k, this->getRow(i) };
+}
+
+BinaryArchive loadBinaryArchive(const std::filesystem::path& filename) {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error(std::format("Failed to open file for reading: {}", filename.string()));
+    }
+
+    BinaryArchive archive;
+    if (!file.read(reinterpret_cast<char*>(&archive.header), sizeof(BinaryArchiveHeader))) {
+        throw std::runtime_error("Binary archive is shorter than its header");
+    }
+    archive.header.validate(std::filesystem::file_size(filename));
+
+    // The rows are read in one go, straight into their final place
+    archive.chips.resize(archive.header.numBoards * archive.header.rowSize);
+    if (!file.read(reinterpret_cast<char*>(archive.chips.data()), static_cast<std::streamsize>(archive.chips.size()))) {
+        throw std::runtime_error(std::format("Failed to read file: {}", filename.string()));
+    }
+    return archive;
+}
+
+namespace {
+    /// @brief Number of bytes of a text file read at a time.
+    constexpr size_t READ_SIZE = 64 << 20;
+
+    /// @brief Number of bytes of a text file parsed by a single task.
+    constexpr size_t PIECE_SIZE = 1 << 20;
+
+    /// @brief The boards parsed from a piece of a text file, packed in the layout of a binary archive.
+    struct ParsedPiece {
+        size_t n = 0, k = 0;
+        std::vector<Chip> chips;
+        std::vector<std::uint8_t> numChips;
+    };
+
+    /**
+     * @return The position of the first delimiter line at or after pos, and the position just past it, or npos if
+     * there is none.
+     */
+    std::pair<size_t, size_t> findDelimiter(std::string_view text, size_t pos) noexcept {
+        std::string_view delimiter = BOARD_DELIMITER;
+        for (size_t found = text.find(delimiter, pos); found != std::string_view::npos;
+             found = text.find(delimiter, found + 1)) {
+
+            // The delimiter must be a whole line, possibly ending with "\r\n"
+            size_t end = found + delimiter.size();
+            if (end < text.size() && text[end] == '\r') end++;
+            if ((found == 0 || text[found - 1] == '\n') && (end == text.size() || text[end] == '\n')) {
+                return { found, std::min(end + 1, text.size()) };
+            }
+        }
+        return { std::string_view::npos, std::string_view::npos };
+    }
+
+    /// @brief Parses the boards of a piece of a text file that starts at the beginning of a board.
+    void parsePiece(std::string_view text, ParsedPiece& piece) {
+        size_t begin = 0;
+        while (begin < text.size()) {
+            auto [delimiter, next] = findDelimiter(text, begin);
+            if (delimiter == std::string_view::npos) {
+                delimiter = next = text.size();
+            }
+
+            std::string_view boardString = text.substr(begin, delimiter - begin);
+            begin = next;
+            if (std::all_of(boardString.begin(), boardString.end(), [](char c) { return std::isspace((unsigned char)c); })) {
+                continue;
+            }
+
+            Board board(boardString);
+            if (piece.numChips.empty()) {
+                piece.n = board.getN();
+                piece.k = board.getK();
+            } else if (board.getN() != piece.n || board.getK() != piece.k) {
+                throw std::runtime_error("Boards of different sizes");
+            }
+            std::span<const Chip> chips = board.getChips();
+            piece.chips.insert(piece.chips.end(), chips.begin(), chips.end());
+            piece.numChips.push_back(static_cast<std::uint8_t>(board.getNumChips()));
+        }
+    }
+}
+
+BinaryArchive loadTextArchive(const std::filesystem::path& filename) {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error(std::format("Failed to open file for reading: {}", filename.string()));
+    }
+
+    // Read the file in large blocks, and split each block into pieces ending with a delimiter line, which are parsed on
+    // the shared thread pool. The text after the last delimiter of a block is carried over to the next block.
+    std::deque<ParsedPiece> pieces;
+    std::string buffer;
+    bool eof = false;
+    while (!eof) {
+        size_t carried = buffer.size();
+        buffer.resize(carried + READ_SIZE);
+        file.read(buffer.data() + carried, READ_SIZE);
+        buffer.resize(carried + file.gcount());
+        eof = !file;
+
+        std::string_view text = buffer;
+        size_t begin = 0;
+        TaskGroup group(ThreadPool::getShared());
+        while (begin < text.size()) {
+            size_t end = text.size();
+            if (begin + PIECE_SIZE < text.size()) {
+                end = findDelimiter(text, begin + PIECE_SIZE).second;
+            }
+            if (!eof && (end == std::string_view::npos || end == text.size())) {
+                // The rest may end in the middle of a board, so it waits for the next block
+                break;
+            }
+            end = std::min(end, text.size());
+
+            ParsedPiece& piece = pieces.emplace_back();
+            group.run([&piece, pieceText = text.substr(begin, end - begin)]() { parsePiece(pieceText, piece); });
+            begin = end;
+        }
+        group.wait();
+        buffer.erase(0, begin);
+    }
+
+    // Count the boards of each number of chips, then place each board after the boards with fewer chips
+    BinaryArchive archive;
+    BinaryArchiveHeader& header = archive.header;
+    for (const ParsedPiece& piece : pieces) {
+        if (piece.numChips.empty()) continue;
+        if (header.numBoards == 0) {
+            header.n = piece.n;
+            header.k = piece.k;
+            header.rowSize = piece.n * piece.k;
+        } else if (piece.n != header.n || piece.k != header.k) {
+            throw std::runtime_error(std::format("Boards of different sizes in {}", filename.string()));
+        }
+        header.numBoards += piece.numChips.size();
+        for (std::uint8_t numChips : piece.numChips) {
+            header.bucketOffsets[numChips + 1]++;
+        }
+    }
+    for (size_t c = 1; c < header.bucketOffsets.size(); c++) {
+        header.bucketOffsets[c] += header.bucketOffsets[c - 1];
+    }
+
+    archive.chips.resize(header.numBoards * header.rowSize);
+    std::array<std::uint64_t, Board::MAX_CHIPS + 2> next = header.bucketOffsets;
+    for (const ParsedPiece& piece : pieces) {
+        for (size_t i = 0; i < piece.numChips.size(); i++) {
+            auto row = piece.chips.begin() + (std::ptrdiff_t)(i * header.rowSize);
+            std::copy(row, row + header.rowSize, archive.chips.begin() + next[piece.numChips[i]]++ * header.rowSize);
+        }
+    }
+    return archive;
+}
+
+BinaryArchive loadArchiveFile(const std::filesystem::path& filename) {
+    return isBinaryArchive(filename) ? loadBinaryArchive(filename) : loadTextArchive(filename);
+}
+
+bool isSavedForGoal(const BinaryArchiveHeader& header, int goal, const std::filesystem::path& filename) {
+    if (goal == BinaryArchiveHeader::UNKNOWN_GOAL || header.goal == BinaryArchiveHeader::UNKNOWN_GOAL ||
+        header.goal == goal) {
+        return true;
+    }
+    fprintf(stderr, "Skipping %s: saved for goal %d, not %d\n", filename.string().c_str(), header.goal, goal);
+    return false;
+}
+
+BinaryArchive loadArchiveFile(const std::filesystem::path& filename, int goal) noexcept {
+    try {
+        BinaryArchive file = loadArchiveFile(filename);
+        if (isSavedForGoal(file.header, goal, filename)) {
+            return file;
+        }
+    } catch (const std::exception& e) {
+        fprintf(stderr, "Failed to load %s: %s\n", filename.string().c_str(), e.what());
+    }
+    return {};
+}
+
+void saveArchiveFile(const BinaryArchive& archive, const std::filesystem::path& filename, ArchiveFormat format) {
+    std::filesystem::create_directories(filename.parent_path());
+    if (format == ArchiveFormat::BINARY) {
+        BinaryArchiveWriter writer(filename, archive.header.goal);
+        for (size_t i = 0; i < archive.header.numBoards; i++) {
+            writer.add(archive.getBoard(i));
+        }
+        writer.close();
+    } else {
+        TextArchiveWriter writer(filename);
+        for (size_t i = 0; i < archive.header.numBoards; i++) {
+            writer.add(archive.getBoard(i));
+        }
+        writer.close();
+    }
+}
+
+namespace {
+    /**
+     * Merges the boards of a file into boards merged so far, whose buckets are already sorted and deduplicated. Equal
+     * boards have the same number of chips, so every bucket is merged on its own, in parallel on the shared pool.
+     */
+    BinaryArchive mergeInto(const BinaryArchive& merged, const BinaryArchive& file) {
+        size_t rowSize = merged.header.rowSize;
+        auto less = [rowSize](const Chip* a, const Chip* b) { return std::memcmp(a, b, rowSize) < 0; };
+        auto equal = [rowSize](const Chip* a, const Chip* b) { return std::memcmp(a, b, rowSize) == 0; };
+
+        std::array<std::vector<const Chip*>, Board::MAX_CHIPS + 1> buckets;
+        TaskGroup group(ThreadPool::getShared());
+        for (size_t c = 0; c <= Board::MAX_CHIPS; c++) {
+            group.run([&rows = buckets[c], &merged, &file, c, rowSize, less, equal]() {
+                std::vector<const Chip*> fileRows;
+                for (std::uint64_t i = file.header.bucketOffsets[c]; i < file.header.bucketOffsets[c + 1]; i++) {
+                    fileRows.push_back(file.chips.data() + i * rowSize);
+                }
+                std::sort(fileRows.begin(), fileRows.end(), less);
+                fileRows.erase(std::unique(fileRows.begin(), fileRows.end(), equal), fileRows.end());
+
+                std::vector<const Chip*> mergedRows;
+                for (std::uint64_t i = merged.header.bucketOffsets[c]; i < merged.header.bucketOffsets[c + 1]; i++) {
+                    mergedRows.push_back(merged.chips.data() + i * rowSize);
+                }
+                rows.reserve(mergedRows.size() + fileRows.size());
+                std::set_union(mergedRows.begin(), mergedRows.end(), fileRows.begin(), fileRows.end(),
+                               std::back_inserter(rows), less);
+            });
+        }
+        group.wait();
+
+        BinaryArchive result;
+        BinaryArchiveHeader& header = result.header;
+        header = merged.header;
+        header.numBoards = 0;
+        for (size_t c = 0; c <= Board::MAX_CHIPS; c++) {
+            header.bucketOffsets[c] = header.numBoards;
+            header.numBoards += buckets[c].size();
+        }
+        header.bucketOffsets.back() = header.numBoards;
+        result.chips.resize(header.numBoards * rowSize);
+        for (size_t c = 0; c <= Board::MAX_CHIPS; c++) {
+            group.run([&result, &rows = buckets[c], c, rowSize]() {
+                Chip* out = result.chips.data() + result.header.bucketOffsets[c] * rowSize;
+                for (const Chip* row : rows) {
+                    out = std::copy(row, row + rowSize, out);
+                }
+            });
+        }
+        group.wait();
+        return result;
+    }
+}
+
+BinaryArchive mergeArchiveFiles(const std::vector<std::filesystem::path>& filenames, int goal) {
+    BinaryArchive merged;
+    BinaryArchiveHeader& header = merged.header;
+    header.goal = goal;
+    bool sized = false;
+    for (const std::filesystem::path& filename : filenames) {
+        BinaryArchive file = loadArchiveFile(filename, goal);
+        const BinaryArchiveHeader& fileHeader = file.header;
+        if (fileHeader.numBoards == 0) continue;
+        if (!sized) {
+            header.n = fileHeader.n;
+            header.k = fileHeader.k;
+            header.rowSize = fileHeader.rowSize;
+            sized = true;
+        } else if (fileHeader.n != header.n || fileHeader.k != header.k) {
+            fprintf(stderr, "Skipping %s: boards of size %ux%u, not %ux%u\n", filename.string().c_str(),
+                    fileHeader.n, fileHeader.k, header.n, header.k);
+            continue;
+        }
+        merged = mergeInto(merged, file);
+    }
+    return merged;
+}
@@ -0,0 +1,363 @@
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <format>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include "archive_journal.h"
+#include "progress.h"
+
+static const char* GENERATION_EXTENSION = ".journal";
+
+static_assert(std::is_trivially_copyable_v<ArchiveJournal::Header>);
+static_assert(sizeof(ArchiveJournal::Header) == 32, "ArchiveJournal::Header must not be padded");
+
+namespace {
+    /// @return The 32-bit FNV-1a hash of the bytes. Never 0 for the type and chips of a record full of zeros.
+    std::uint32_t checksum(const void* data, size_t size) noexcept {
+        const auto* bytes = static_cast<const unsigned char*>(data);
+        std::uint32_t hash = 2166136261u;
+        for (size_t i = 0; i < size; i++) {
+            hash = (hash ^ bytes[i]) * 16777619u;
+        }
+        return hash;
+    }
+}
+
+ArchiveJournal::ArchiveJournal(const std::filesystem::path& directory, size_t n, size_t k, int goal)
+        : directory_(directory), numRecords_(0), failed_(false), generation_(0) {
+
+    this->header_.n = n;
+    this->header_.k = k;
+    this->header_.goal = goal;
+    this->header_.rowSize = n * k;
+    this->buffer_.reserve(BUFFER_SIZE);
+    this->spare_.reserve(BUFFER_SIZE);
+
+    std::filesystem::create_directories(directory);
+    std::vector<std::filesystem::path> generations = findGenerations(directory);
+    if (!generations.empty()) {
+        this->generation_ = std::stoull(generations.back().stem().string());
+    }
+
+    std::scoped_lock lock(this->mutex_, this->fileMutex_);
+    this->open();
+}
+
+ArchiveJournal::~ArchiveJournal() {
+    this->flush();
+}
+
+void ArchiveJournal::append(RecordType type, const Board& board) noexcept {
+    std::unique_lock lock(this->mutex_);
+    if (this->failed_.load(std::memory_order_relaxed)) {
+        return;
+    }
+    std::unique_lock<std::mutex> fileLock;
+    if (this->buffer_.size() + 1 + this->header_.rowSize + CHECKSUM_SIZE > BUFFER_SIZE) {
+        fileLock = this->swapBuffers();
+    }
+
+    // The record goes to the buffer before the lock is released, so the records keep the order of the calls
+    std::span<const Chip> chips = board.getChips();
+    size_t start = this->buffer_.size();
+    this->buffer_.push_back(static_cast<char>(type));
+    this->buffer_.insert(this->buffer_.end(), chips.begin(), chips.end());
+
+    std::uint32_t sum = checksum(this->buffer_.data() + start, 1 + chips.size());
+    const char* sumBytes = reinterpret_cast<const char*>(&sum);
+    this->buffer_.insert(this->buffer_.end(), sumBytes, sumBytes + CHECKSUM_SIZE);
+    this->numRecords_++;
+
+    if (fileLock.owns_lock()) {
+        lock.unlock();
+        this->write();
+    }
+}
+
+void ArchiveJournal::flush() noexcept {
+    std::unique_lock lock(this->mutex_);
+    std::unique_lock<std::mutex> fileLock = this->swapBuffers();
+    lock.unlock();
+    this->write();
+    this->sync();
+}
+
+std::uint64_t ArchiveJournal::rotate() {
+    // Both locks are held throughout, so no record is appended between the last write and the new generation
+    std::lock_guard lock(this->mutex_);
+    std::unique_lock<std::mutex> fileLock = this->swapBuffers();
+    this->write();
+    this->sync();
+    this->file_.close();
+    std::uint64_t lastGeneration = this->generation_;
+    this->numRecords_ = 0;
+    this->open();
+    return lastGeneration;
+}
+
+void ArchiveJournal::removeGenerations(std::uint64_t lastGeneration) const {
+    for (const std::filesystem::path& filename : findGenerations(this->directory_)) {
+        if (std::stoull(filename.stem().string()) <= lastGeneration) {
+            std::filesystem::remove(filename);
+        }
+    }
+}
+
+size_t ArchiveJournal::countRecords() const noexcept {
+    std::lock_guard lock(this->mutex_);
+    return this->numRecords_;
+}
+
+std::vector<std::filesystem::path> ArchiveJournal::findGenerations(const std::filesystem::path& directory) {
+    std::vector<std::filesystem::path> generations;
+    if (!std::filesystem::is_directory(directory)) {
+        return generations;
+    }
+    for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(directory)) {
+        std::string stem = entry.path().stem().string();
+        if (entry.path().extension() == GENERATION_EXTENSION && !stem.empty() &&
+            std::all_of(stem.begin(), stem.end(), [](char c) { return std::isdigit((unsigned char)c); })) {
+            generations.push_back(entry.path());
+        }
+    }
+    std::sort(generations.begin(), generations.end(), [](const auto& a, const auto& b) {
+        return std::stoull(a.stem().string()) < std::stoull(b.stem().string());
+    });
+    return generations;
+}
+
+std::filesystem::path ArchiveJournal::getGenerationFilename(std::uint64_t generation) const {
+    return this->directory_ / (std::to_string(generation) + GENERATION_EXTENSION);
+}
+
+void ArchiveJournal::open() {
+    this->generation_++;
+    std::filesystem::path filename = this->getGenerationFilename(this->generation_);
+    this->file_ = std::ofstream(filename, std::ios::binary);
+    if (!this->file_.is_open()) {
+        throw std::runtime_error(std::format("Failed to open file for writing: {}", filename.string()));
+    }
+    this->file_.write(reinterpret_cast<const char*>(&this->header_), sizeof(Header));
+
+    // Records flushed to the new file are lost if its directory entry is
+    this->file_.flush();
+    syncToDisk(this->directory_);
+}
+
+void ArchiveJournal::sync() noexcept {
+    this->file_.flush();
+    syncToDisk(this->getGenerationFilename(this->generation_));
+}
+
+std::unique_lock<std::mutex> ArchiveJournal::swapBuffers() {
+    std::unique_lock fileLock(this->fileMutex_);
+    this->buffer_.swap(this->spare_);
+    return fileLock;
+}
+
+void ArchiveJournal::write() noexcept {
+    this->file_.write(this->spare_.data(), static_cast<std::streamsize>(this->spare_.size()));
+    this->spare_.clear();
+    if (!this->file_ && !this->failed_.exchange(true, std::memory_order_relaxed)) {
+        ProgressReporter::printMessage("Failed to write journal %s, dropping the next records\n",
+                                       this->directory_.string().c_str());
+    }
+}
+
+namespace {
+    /**
+     * @brief The boards of one side of the archive during a replay, in the order they were first added.
+     *
+     * The boards are packed in rows like BinaryArchive::chips, starting with the rows of the base, and the index keys
+     * each board by the position of its row, so no board is copied out of the rows to be looked up.
+     */
+    class ReplayedBoards {
+    public:
+        /// @brief Starts from the boards of a base snapshot, taking over its rows. Duplicate boards are dropped.
+        ReplayedBoards(BinaryArchive&& base, size_t rowSize)
+                : rowSize_(rowSize), chips_(std::move(base.chips)),
+                  index_(0, RowHash{ this }, RowEqual{ this }) {
+
+            size_t numBoards = base.header.numBoards;
+            this->live_.reserve(numBoards);
+            this->index_.reserve(numBoards);
+            for (size_t i = 0; i < numBoards; i++) {
+                this->live_.push_back(this->index_.insert(i).second);
+            }
+        }
+
+        ReplayedBoards(const ReplayedBoards&) = delete;
+        ReplayedBoards& operator=(const ReplayedBoards&) = delete;
+
+        /// @brief Sets the size of the rows, once the first generation tells it for an empty base.
+        void setRowSize(size_t rowSize) noexcept {
+            this->rowSize_ = rowSize;
+        }
+
+        void add(std::span<const Chip> row) {
+            size_t i = this->append(row);
+            auto [it, inserted] = this->index_.insert(i);
+            if (inserted) {
+                this->live_.push_back(true);
+            } else {
+                this->chips_.resize(i * this->rowSize_);
+                this->live_[*it] = true;
+            }
+        }
+
+        void remove(std::span<const Chip> row) {
+            size_t i = this->append(row);
+            auto it = this->index_.find(i);
+            if (it != this->index_.end()) {
+                this->live_[*it] = false;
+            }
+            this->chips_.resize(i * this->rowSize_);
+        }
+
+        /// @brief Packs the live boards into a binary archive, grouped by number of chips.
+        [[nodiscard]] BinaryArchive pack(const BinaryArchiveHeader& base) const {
+            BinaryArchive archive;
+            BinaryArchiveHeader& header = archive.header;
+            header.n = base.n;
+            header.k = base.k;
+            header.goal = base.goal;
+            header.rowSize = base.rowSize;
+
+            std::vector<std::uint8_t> numChips(this->live_.size());
+            for (size_t i = 0; i < this->live_.size(); i++) {
+                if (!this->live_[i]) continue;
+                std::span<const Chip> row = this->getRow(i);
+                numChips[i] = std::count_if(row.begin(), row.end(), [](Chip chip) { return chip >= 0; });
+                header.bucketOffsets[numChips[i] + 1]++;
+                header.numBoards++;
+            }
+            for (size_t c = 1; c < header.bucketOffsets.size(); c++) {
+                header.bucketOffsets[c] += header.bucketOffsets[c - 1];
+            }
+
+            archive.chips.resize(header.numBoards * header.rowSize);
+            std::array<std::uint64_t, Board::MAX_CHIPS + 2> next = header.bucketOffsets;
+            for (size_t i = 0; i < this->live_.size(); i++) {
+                if (!this->live_[i]) continue;
+                std::memcpy(archive.chips.data() + next[numChips[i]]++ * header.rowSize, this->getRow(i).data(),
+                            header.rowSize);
+            }
+            return archive;
+        }
+
+    private:
+        struct RowHash {
+            const ReplayedBoards* boards;
+            size_t operator()(size_t i) const noexcept {
+                return std::hash<std::string_view>()(this->boards->getBytes(i));
+            }
+        };
+
+        struct RowEqual {
+            const ReplayedBoards* boards;
+            bool operator()(size_t i, size_t j) const noexcept {
+                return this->boards->getBytes(i) == this->boards->getBytes(j);
+            }
+        };
+
+        [[nodiscard]] std::span<const Chip> getRow(size_t i) const noexcept {
+            return { this->chips_.data() + i * this->rowSize_, this->rowSize_ };
+        }
+
+        [[nodiscard]] std::string_view getBytes(size_t i) const noexcept {
+            return { reinterpret_cast<const char*>(this->chips_.data() + i * this->rowSize_), this->rowSize_ };
+        }
+
+        /// @return The index of the row, appended after the others so it can be looked up.
+        size_t append(std::span<const Chip> row) {
+            size_t i = this->chips_.size() / this->rowSize_;
+            this->chips_.insert(this->chips_.end(), row.begin(), row.end());
+            return i;
+        }
+
+        size_t rowSize_;
+        std::vector<Chip> chips_;
+        std::vector<bool> live_;
+        std::unordered_set<size_t, RowHash, RowEqual> index_;
+    };
+}
+
+size_t ArchiveJournal::replay(
+        const std::filesystem::path& directory, BinaryArchive& winning, BinaryArchive& losing, int goal) {
+
+    // The size of the boards comes from the base, or from the first generation if the base is empty
+    BinaryArchiveHeader header = winning.header.numBoards > 0 ? winning.header : losing.header;
+    if (header.numBoards == 0) {
+        header.rowSize = 0;
+    }
+    header.goal = goal;
+
+    ReplayedBoards winningBoards(std::move(winning), header.rowSize), losingBoards(std::move(losing), header.rowSize);
+    std::array<ReplayedBoards*, 2> sides = { &winningBoards, &losingBoards };
+
+    size_t numRecords = 0;
+    for (const std::filesystem::path& filename : findGenerations(directory)) {
+        std::ifstream file(filename, std::ios::binary);
+        Header fileHeader;
+        if (!file.read(reinterpret_cast<char*>(&fileHeader), sizeof(Header)) || fileHeader.magic != Header::MAGIC ||
+            fileHeader.version != Header::VERSION || fileHeader.byteOrderMark != BinaryArchiveHeader::BYTE_ORDER_MARK ||
+            fileHeader.rowSize != fileHeader.n * fileHeader.k || fileHeader.rowSize == 0 ||
+            fileHeader.rowSize > Board::MAX_CHIPS) {
+            fprintf(stderr, "Skipping %s: not a journal this program can read\n", filename.string().c_str());
+            continue;
+        }
+        if (goal != BinaryArchiveHeader::UNKNOWN_GOAL && fileHeader.goal != goal) {
+            fprintf(stderr, "Skipping %s: written for goal %d, not %d\n", filename.string().c_str(), fileHeader.goal,
+                    goal);
+            continue;
+        }
+        if (header.rowSize == 0) {
+            header.n = fileHeader.n;
+            header.k = fileHeader.k;
+            header.rowSize = fileHeader.rowSize;
+            for (ReplayedBoards* side : sides) {
+                side->setRowSize(header.rowSize);
+            }
+        } else if (fileHeader.n != header.n || fileHeader.k != header.k) {
+            fprintf(stderr, "Skipping %s: boards of a different size\n", filename.string().c_str());
+            continue;
+        }
+
+        // A record cut short by a crash, or never completely written before it, ends the generation
+        std::vector<Chip> record(1 + header.rowSize + CHECKSUM_SIZE);
+        std::span<const Chip> row(record.data() + 1, header.rowSize);
+        while (file.read(reinterpret_cast<char*>(record.data()), static_cast<std::streamsize>(record.size()))) {
+            std::uint32_t sum;
+            std::memcpy(&sum, record.data() + 1 + header.rowSize, CHECKSUM_SIZE);
+            auto type = static_cast<RecordType>(record[0]);
+            if (sum != checksum(record.data(), 1 + header.rowSize) || type > RecordType::REMOVE_LOSING) {
+                fprintf(stderr, "Journal %s ends with an invalid record, replayed up to it\n",
+                        filename.string().c_str());
+                break;
+            }
+
+            switch (type) {
+            case RecordType::ADD_WINNING:
+                winningBoards.add(row);
+                break;
+            case RecordType::ADD_LOSING:
+                losingBoards.add(row);
+                break;
+            case RecordType::REMOVE_WINNING:
+                winningBoards.remove(row);
+                break;
+            case RecordType::REMOVE_LOSING:
+                losingBoards.remove(row);
+                break;
+            }
+            numRecords++;
+        }
+    }
+
+    winning = winningBoards.pack(header);
+    losing = losingBoards.pack(header);
+    return numRecords;
+}
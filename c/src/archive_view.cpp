@@ -0,0 +1,318 @@
+#include <atomic>
+#include <cstring>
+#include <stdexcept>
+#include "archive_view.h"
+#include "compare.h"
+#include "thread_pool.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    /**
+     * Summaries of the target board that can be checked against the packed chips of a row without sorting. Like the
+     * summaries of a BoardSignature, each one is monotone under the column matching of compareBoards(): a row with a
+     * larger summary than the target at any position cannot be below the target, and vice versa. Most rows are ruled
+     * out by them before a Board and a signature are built.
+     */
+    struct RowFilter {
+        size_t n, k;
+        /// @brief rowCounts[r] is the number of chips on row r or above, as in BoardSignature.
+        std::array<std::uint8_t, BoardSignature::HISTOGRAM_ROWS> rowCounts{};
+        /// @brief The largest and the sum of (row + 1) of the i-th chips of all columns, for each i.
+        std::array<Chip, Board::MAX_CHIPS> maxChips{};
+        std::array<std::int16_t, Board::MAX_CHIPS> sums{};
+
+        RowFilter(const Board& target, const BoardSignature& signature) noexcept
+                : n(target.getN()), k(target.getK()), rowCounts(signature.rowCounts) {
+            this->summarize(target.getChips(), this->maxChips, this->sums);
+        }
+
+        void summarize(std::span<const Chip> chips, std::array<Chip, Board::MAX_CHIPS>& maxChips,
+                       std::array<std::int16_t, Board::MAX_CHIPS>& sums) const noexcept {
+            for (size_t i = 0; i < this->k; i++) {
+                maxChips[i] = -1;
+                sums[i] = 0;
+            }
+            for (size_t c = 0; c < this->n; c++) {
+                for (size_t i = 0; i < this->k; i++) {
+                    Chip chip = chips[c * this->k + i];
+                    maxChips[i] = std::max(maxChips[i], chip);
+                    sums[i] = static_cast<std::int16_t>(sums[i] + chip + 1);
+                }
+            }
+        }
+
+        /// @return Whether the row may be below the target (or above it if not below).
+        [[nodiscard]] bool mayMatch(std::span<const Chip> chips, bool below) const noexcept {
+            // The histogram rules out the most rows, so it goes first
+            std::array<std::uint8_t, BoardSignature::HISTOGRAM_ROWS> counts{};
+            for (Chip chip : chips) {
+                if (chip >= 0) counts[std::min((size_t)chip, BoardSignature::HISTOGRAM_ROWS - 1)]++;
+            }
+            std::uint8_t count = 0;
+            for (size_t r = BoardSignature::HISTOGRAM_ROWS; r-- > 0;) {
+                count += counts[r];
+                if (below ? count > this->rowCounts[r] : count < this->rowCounts[r]) return false;
+            }
+
+            std::array<Chip, Board::MAX_CHIPS> rowMaxChips;
+            std::array<std::int16_t, Board::MAX_CHIPS> rowSums;
+            this->summarize(chips, rowMaxChips, rowSums);
+            for (size_t i = 0; i < this->k; i++) {
+                if (below ? rowMaxChips[i] > this->maxChips[i] || rowSums[i] > this->sums[i]
+                          : rowMaxChips[i] < this->maxChips[i] || rowSums[i] < this->sums[i]) {
+                    return false;
+                }
+            }
+            return true;
+        }
+    };
+}
+
+ArchiveView::ArchiveView(const std::filesystem::path& filename, Player winner, int goal)
+        : winner_(winner), rows_(nullptr), mapping_(nullptr), mappingSize_(0), firstChunk_{} {
+
+    // A missing file is an empty archive, as with Archive::loadWinning() and Archive::loadLosing()
+    if (!std::filesystem::exists(filename)) {
+        return;
+    }
+    try {
+        if (isBinaryArchive(filename)) {
+            this->map(filename);
+            if (!isSavedForGoal(this->header_, goal, filename)) {
+                this->header_ = {};
+            }
+        } else {
+            BinaryArchive file = loadArchiveFile(filename, goal);
+            this->header_ = file.header;
+            this->owned_ = std::move(file.chips);
+            this->rows_ = this->owned_.data();
+        }
+        this->buildIndex();
+    } catch (const std::exception& e) {
+        fprintf(stderr, "Failed to load %s: %s\n", filename.string().c_str(), e.what());
+        this->header_ = {};
+        this->chunks_.clear();
+        this->blocks_.clear();
+        this->firstChunk_ = {};
+    }
+}
+
+ArchiveView::~ArchiveView() {
+#ifndef _WIN32
+    if (this->mapping_) {
+        munmap(this->mapping_, this->mappingSize_);
+    }
+#endif
+}
+
+void ArchiveView::map(const std::filesystem::path& filename) {
+#ifdef _WIN32
+    // No mapping on Windows: read the file in bulk instead
+    BinaryArchive file = loadBinaryArchive(filename);
+    this->header_ = file.header;
+    this->owned_ = std::move(file.chips);
+    this->rows_ = this->owned_.data();
+#else
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open file for reading");
+    }
+    struct stat status{};
+    if (fstat(fd, &status) != 0 || static_cast<size_t>(status.st_size) < sizeof(BinaryArchiveHeader)) {
+        close(fd);
+        throw std::runtime_error("Binary archive is shorter than its header");
+    }
+
+    // The mapping stays valid after the file is closed
+    size_t size = status.st_size;
+    void* mapping = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        throw std::runtime_error("Failed to map file");
+    }
+    this->mapping_ = mapping;
+    this->mappingSize_ = size;
+
+    std::memcpy(&this->header_, mapping, sizeof(BinaryArchiveHeader));
+    this->header_.validate(size);
+    this->rows_ = reinterpret_cast<const Chip*>(static_cast<const char*>(mapping) + sizeof(BinaryArchiveHeader));
+#endif
+}
+
+void ArchiveView::buildIndex() {
+    // Lay out the chunks and blocks of every bucket first, so the bounds can then be computed in parallel
+    for (size_t c = 0; c <= Board::MAX_CHIPS; c++) {
+        this->firstChunk_[c] = this->chunks_.size();
+        std::uint64_t end = this->header_.bucketOffsets[c + 1];
+        for (std::uint64_t begin = this->header_.bucketOffsets[c]; begin < end; begin += CHUNK_SIZE) {
+            Chunk& chunk = this->chunks_.emplace_back();
+            chunk.begin = begin;
+            chunk.end = std::min(begin + CHUNK_SIZE, end);
+            chunk.numChips = c;
+            chunk.firstBlock = this->blocks_.size();
+            this->blocks_.resize(this->blocks_.size() + (chunk.end - chunk.begin + BLOCK_SIZE - 1) / BLOCK_SIZE);
+        }
+    }
+    this->firstChunk_.back() = this->chunks_.size();
+
+    // The signatures are computed from the packed rows, without building boards. The first entry of the histogram is
+    // the number of chips, which also checks that every row is in the bucket of its number of chips, as the queries
+    // skip buckets by number of chips.
+    std::atomic<size_t> nextChunk = 0;
+    std::atomic<bool> misplaced = false;
+    ThreadPool& pool = ThreadPool::getShared();
+    TaskGroup group(pool);
+    for (size_t t = 0; t <= pool.getNumThreads(); t++) {
+        group.run([&]() {
+            while (true) {
+                size_t c = nextChunk.fetch_add(1, std::memory_order_relaxed);
+                if (c >= this->chunks_.size()) {
+                    break;
+                }
+                Chunk& chunk = this->chunks_[c];
+                auto signatureOf = [&](size_t i) {
+                    BoardSignature signature(this->header_.n, this->header_.k, this->getRow(i));
+                    if (signature.rowCounts[0] != chunk.numChips) {
+                        misplaced.store(true, std::memory_order_relaxed);
+                    }
+                    return signature;
+                };
+
+                Bounds* bounds = &this->blocks_[chunk.firstBlock];
+                for (size_t block = chunk.begin; block < chunk.end; block += BLOCK_SIZE, bounds++) {
+                    BoardSignature first = signatureOf(block);
+                    *bounds = { first, first };
+                    for (size_t i = block + 1; i < std::min(block + BLOCK_SIZE, chunk.end); i++) {
+                        BoardSignature signature = signatureOf(i);
+                        bounds->min.expandMin(signature);
+                        bounds->max.expandMax(signature);
+                    }
+                }
+
+                chunk.bounds = this->blocks_[chunk.firstBlock];
+                for (const Bounds* b = &this->blocks_[chunk.firstBlock] + 1; b < bounds; b++) {
+                    chunk.bounds.min.expandMin(b->min);
+                    chunk.bounds.max.expandMax(b->max);
+                }
+            }
+        });
+    }
+    group.wait();
+
+    if (misplaced) {
+        throw std::runtime_error("Binary archive lists boards with the boards of another number of chips");
+    }
+}
+
+bool ArchiveView::mayContain(const Bounds& bounds, const BoardSignature& target) const noexcept {
+    // A winning board below the target needs the minimum of the group below the target, and a losing board above the
+    // target needs the maximum above it
+    return this->winner_ == Player::PUSHER ? bounds.min.isBelow(target) : target.isBelow(bounds.max);
+}
+
+Player ArchiveView::predictWinner(const GameState& gameState, size_t threads) const noexcept {
+    // If the game is already finished, return the winner
+    Player winner = gameState.getWinner();
+    if (winner != Player::NONE) {
+        return winner;
+    }
+
+    // Get the board and restore any moved chip
+    const Board& board = gameState.getBoardWithoutMovedChips();
+    if (this->chunks_.empty() || board.getN() != this->header_.n || board.getK() != this->header_.k) {
+        return Player::NONE;
+    }
+    size_t numChips = board.getNumChips();
+    BoardSignature signature(board);
+    RowFilter filter(board, signature);
+
+    // Winning boards with at most as many chips as the target may be less than it, and losing boards with at least as
+    // many chips may be greater
+    bool winning = this->winner_ == Player::PUSHER;
+    size_t firstChunk = this->firstChunk_[winning ? 0 : numChips];
+    size_t lastChunk = this->firstChunk_[winning ? numChips + 1 : this->header_.n * this->header_.k + 1];
+    CompResult expected = winning ? CompResult::GREATER : CompResult::LESS;
+    Purpose directed = winning ? Purpose::GREATER : Purpose::LESS;
+
+    auto chunkMatches = [&](size_t c) {
+        const Chunk& chunk = this->chunks_[c];
+        if (!this->mayContain(chunk.bounds, signature)) {
+            return false;
+        }
+
+        // Equal boards only have the same number of chips, and only show up when comparing in both directions
+        Purpose purpose = chunk.numChips == numChips ? Purpose::BOTH : directed;
+        for (size_t begin = chunk.begin; begin < chunk.end; begin += BLOCK_SIZE) {
+            if (!this->mayContain(this->blocks_[chunk.firstBlock + (begin - chunk.begin) / BLOCK_SIZE], signature)) {
+                continue;
+            }
+            for (size_t i = begin; i < std::min(begin + BLOCK_SIZE, chunk.end); i++) {
+                if (!filter.mayMatch(this->getRow(i), winning)) continue;
+                Board other = this->getBoard(i);
+                CompResult result = compareBoards(board, signature, other, BoardSignature(other), purpose);
+                if (result == expected || result == CompResult::EQUAL) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    };
+
+    // Small ranges are not worth forking for
+    static constexpr size_t CHUNKS_PER_TASK = 4;
+    size_t numTasks = (lastChunk - firstChunk + CHUNKS_PER_TASK - 1) / CHUNKS_PER_TASK;
+    size_t t_ = std::max(std::min(threads, numTasks), (size_t)1);
+    if (t_ == 1) {
+        for (size_t c = firstChunk; c < lastChunk; c++) {
+            if (chunkMatches(c)) return this->winner_;
+        }
+        return Player::NONE;
+    }
+
+    // Fork-join on the shared pool. The tasks take batches of chunks, and the first task to find a match cancels the
+    // others.
+    std::atomic<size_t> counter = firstChunk;
+    std::atomic<bool> found = false;
+    TaskGroup group(ThreadPool::getShared());
+    for (size_t i = 0; i < t_; i++) {
+        group.run([&]() {
+            while (!group.isCancelled()) {
+                size_t begin = counter.fetch_add(CHUNKS_PER_TASK, std::memory_order_relaxed);
+                if (begin >= lastChunk) {
+                    break;
+                }
+                for (size_t c = begin; c < std::min(begin + CHUNKS_PER_TASK, lastChunk) && !group.isCancelled(); c++) {
+                    if (chunkMatches(c)) {
+                        found.store(true, std::memory_order_relaxed);
+                        group.cancel();
+                    }
+                }
+            }
+        });
+    }
+    group.wait();
+
+    return found.load(std::memory_order_relaxed) ? this->winner_ : Player::NONE;
+}
+
+size_t ArchiveView::size() const noexcept {
+    return this->header_.numBoards;
+}
+
+std::span<const Chip> ArchiveView::getRow(size_t i) const noexcept {
+    return { this->rows_ + i * this->header_.rowSize, this->header_.rowSize };
+}
+
+Board ArchiveView::getBoard(size_t i) const {
+    return { this->header_.n, this->header_.k, this->getRow(i) };
+}
+
+const BinaryArchiveHeader& ArchiveView::getHeader() const noexcept {
+    return this->header_;
+}
@@ -1,8 +1,21 @@
 #include <algorithm>
-#include <format>
-#include <regex>
-#include <sstream>
+#include <array>
+#include <cctype>
+#include <charconv>
+#include <limits>
+#include <stdexcept>
 #include "board.h"
+#include "column_kernels.h"
+
+namespace {
+    /// @brief Converts a row to a chip, throwing std::invalid_argument instead of wrapping rows outside its range.
+    Chip toChip(int row) {
+        if (row < std::numeric_limits<Chip>::min() || row > std::numeric_limits<Chip>::max()) {
+            throw std::invalid_argument("Row does not fit in a Chip");
+        }
+        return static_cast<Chip>(row);
+    }
+}
 
 std::string toString(const Player& player) {
     switch (player) {
@@ -24,68 +37,114 @@ Board::Board(size_t n, size_t k, std::vector<std::vector<int>> boardState)
         : Board(n, k, std::move(boardState), std::vector(n, std::vector(k, false))) {}
 
 Board::Board(size_t n, size_t k, std::vector<std::vector<int>> boardState, std::vector<std::vector<bool>> chipIsMoved)
-        : n_(n), k_(k), boardState_(std::move(boardState)), chipIsMoved_(std::move(chipIsMoved)) {
+        : n_(n), k_(k), numChips_(0), chips_{}, chipIsMoved_(0) {
 
-    this->numChips_ = 0;
-    for (const std::vector<int>& col : this->boardState_) {
-        for (int chip : col) {
-            if (chip >= 0) {
+    if (n * k > MAX_CHIPS) {
+        throw std::invalid_argument("Board has more than Board::MAX_CHIPS chips");
+    }
+
+    // Copy the chips into the flat buffer. Missing entries are treated as removed chips.
+    for (size_t c = 0; c < this->n_; c++) {
+        for (size_t idx = 0; idx < this->k_; idx++) {
+            size_t i = c * this->k_ + idx;
+            bool exists = c < boardState.size() && idx < boardState[c].size();
+            this->chips_[i] = exists ? toChip(boardState[c][idx]) : -1;
+            if (c < chipIsMoved.size() && idx < chipIsMoved[c].size() && chipIsMoved[c][idx]) {
+                this->chipIsMoved_ |= 1ULL << i;
+            }
+            if (this->chips_[i] >= 0) {
                 this->numChips_++;
             }
         }
     }
 }
 
-Board::Board(const std::string& boardString) {
-    // Split the board string into the first line and the rest of the board (can be multiple lines)
-    std::stringstream ss(boardString);
-    std::string firstLine;
-    std::getline(ss, firstLine);
-    std::string boardStructure = boardString.substr(ss.tellg());
+Board::Board(size_t n, size_t k, std::span<const Chip> chips)
+        : n_(n), k_(k), numChips_(0), chips_{}, chipIsMoved_(0) {
 
-    // Parse the first line: n={},k={},n_chips={}
-    std::regex firstLineRegex(R"(n=(\d+),k=(\d+),n_chips=(\d+))");
-    std::smatch firstLineMatch;
-    if (!std::regex_match(firstLine, firstLineMatch, firstLineRegex)) {
-        throw std::invalid_argument("Invalid board string");
+    if (n * k > MAX_CHIPS) {
+        throw std::invalid_argument("Board has more than Board::MAX_CHIPS chips");
+    }
+    if (chips.size() != n * k) {
+        throw std::invalid_argument("Number of chips does not match the size of the board");
     }
-    this->n_ = std::stoi(firstLineMatch[1]);
-    this->k_ = std::stoi(firstLineMatch[2]);
 
-    // Parse the board structure
-    this->boardState_.resize(this->n_, std::vector(this->k_, 0));
-    this->chipIsMoved_.resize(this->n_, std::vector(this->k_, false));
-    for (size_t i = 0; i < this->n_ * this->k_; i++) {
-        size_t c = i / this->k_;
-        size_t idx = i % this->k_;
-        ss >> this->boardState_[c][idx];
+    std::copy(chips.begin(), chips.end(), this->chips_.begin());
+    this->numChips_ = std::count_if(chips.begin(), chips.end(), [](Chip chip) { return chip >= 0; });
+}
+
+Board::Board(std::string_view boardString) : numChips_(0), chips_{}, chipIsMoved_(0) {
+    const char* p = boardString.data();
+    const char* end = p + boardString.size();
+    auto expect = [&p, end](std::string_view text) {
+        if ((size_t)(end - p) < text.size() || std::string_view(p, text.size()) != text) {
+            throw std::invalid_argument("Invalid board string");
+        }
+        p += text.size();
+    };
+    auto parse = [&p, end](auto& value) {
+        while (p != end && std::isspace((unsigned char)*p)) p++;
+        auto [next, error] = std::from_chars(p, end, value);
+        if (error != std::errc()) {
+            throw std::invalid_argument("Invalid board string");
+        }
+        p = next;
+    };
+
+    // Parse the first line: n={},k={},n_chips={}
+    size_t numChips = 0;
+    expect("n=");
+    parse(this->n_);
+    expect(",k=");
+    parse(this->k_);
+    expect(",n_chips=");
+    parse(numChips);
+    if (this->n_ > MAX_CHIPS || this->k_ > MAX_CHIPS || this->n_ * this->k_ > MAX_CHIPS) {
+        throw std::invalid_argument("Board has more than Board::MAX_CHIPS chips");
     }
 
+    // Parse the board structure
     // Number of chips is calculated instead of retrieved from the first line
-    this->numChips_ = 0;
-    for (const std::vector<int>& col : this->boardState_) {
-        for (int chip : col) {
-            if (chip >= 0) {
-                this->numChips_++;
-            }
+    for (size_t i = 0; i < this->n_ * this->k_; i++) {
+        int row = 0;
+        parse(row);
+        this->chips_[i] = toChip(row);
+        if (row >= 0) {
+            this->numChips_++;
         }
     }
 }
 
 std::string Board::toString() const noexcept {
+    std::string result;
+    this->appendTo(result);
+    return result;
+}
+
+void Board::appendTo(std::string& out) const {
+    // Formats into a small array on the stack, then appends it in one go
+    std::array<char, 16> number{};
+    auto appendNumber = [&out, &number](auto value) {
+        std::to_chars_result result = std::to_chars(number.data(), number.data() + number.size(), value);
+        out.append(number.data(), result.ptr);
+    };
+
     // Serialize basic member variables
-    std::stringstream ss;
-    ss << std::format("n={},k={},n_chips={}\n", this->n_, this->k_, this->numChips_);
+    out.append("n=");
+    appendNumber(this->n_);
+    out.append(",k=");
+    appendNumber(this->k_);
+    out.append(",n_chips=");
+    appendNumber(this->numChips_);
+    out.push_back('\n');
     // Serialize the board structure
-    for (const std::vector<int>& col : this->boardState_) {
+    for (size_t c = 0; c < this->n_; c++) {
         for (size_t idx = 0; idx < this->k_; idx++) {
-            if (idx > 0) ss << " ";
-            ss << col[idx];
+            if (idx > 0) out.push_back(' ');
+            appendNumber(static_cast<int>(this->chips_[c * this->k_ + idx]));
         }
-        ss << "\n"; // Newline to separate rows
+        out.push_back('\n'); // Newline to separate rows
     }
-
-    return ss.str();
 }
 
 int Board::calcMaxRow() const noexcept {
@@ -94,8 +153,8 @@ int Board::calcMaxRow() const noexcept {
         return maxRow;
     }
 
-    for (const std::vector<int>& col : this->boardState_) {
-        maxRow = std::max(maxRow, col[0]);
+    for (size_t c = 0; c < this->n_; c++) {
+        maxRow = std::max(maxRow, static_cast<int>(this->chips_[c * this->k_]));
     }
 
     return maxRow;
@@ -103,16 +162,48 @@ int Board::calcMaxRow() const noexcept {
 
 Player Board::calcCurrentPlayer() const noexcept {
     // If at least one chip is moved, then the current player is the Remover
-    for (const std::vector<bool>& col : this->chipIsMoved_) {
-        for (bool moved : col) {
-            if (moved) {
-                return Player::REMOVER;
-            }
+    // Otherwise the current player is the Pusher
+    return this->chipIsMoved_ ? Player::REMOVER : Player::PUSHER;
+}
+
+void Board::undoPusherMove() noexcept {
+    for (size_t i = 0; i < this->n_ * this->k_; i++) {
+        if (this->chipIsMoved_ & (1ULL << i)) {
+            this->chips_[i]--;
         }
     }
+    this->chipIsMoved_ = 0;
+}
 
-    // Otherwise the current player is the Pusher
-    return Player::PUSHER;
+void Board::canonicalize() noexcept {
+    size_t n = this->n_;
+    size_t k = this->k_;
+
+    // Order column indices from largest to smallest, comparing the chips first and then the moved flags
+    auto isGreater = [this, k](size_t c1, size_t c2) {
+        ColumnView col1 = this->getColumn(c1);
+        ColumnView col2 = this->getColumn(c2);
+        for (size_t idx = 0; idx < k; idx++) {
+            if (col1[idx] != col2[idx]) return col1[idx] > col2[idx];
+        }
+        return this->getColumnMoved(c1) > this->getColumnMoved(c2);
+    };
+    std::array<std::uint8_t, MAX_CHIPS> order;
+    for (size_t c = 0; c < n; c++) {
+        order[c] = static_cast<std::uint8_t>(c);
+    }
+    std::sort(order.begin(), order.begin() + (std::ptrdiff_t)n, isGreater);
+
+    // Rebuild the chips and the moved flags in the new column order
+    std::array<Chip, MAX_CHIPS> chips{};
+    std::uint64_t chipIsMoved = 0;
+    for (size_t c = 0; c < n; c++) {
+        ColumnView column = this->getColumn(order[c]);
+        std::copy(column.begin(), column.end(), chips.begin() + (std::ptrdiff_t)(c * k));
+        chipIsMoved |= this->getColumnMoved(order[c]) << (c * k);
+    }
+    this->chips_ = chips;
+    this->chipIsMoved_ = chipIsMoved;
 }
 
 size_t Board::getN() const noexcept {
@@ -127,38 +218,43 @@ size_t Board::getNumChips() const noexcept {
     return this->numChips_;
 }
 
-const std::vector<std::vector<int>>& Board::getBoardState() const noexcept {
-    return this->boardState_;
+BoardState Board::getBoardState() const noexcept {
+    BoardState boardState(this->n_);
+    for (size_t c = 0; c < this->n_; c++) {
+        ColumnView column = this->getColumn(c);
+        boardState[c].assign(column.begin(), column.end());
+    }
+    return boardState;
+}
+
+std::span<const Chip> Board::getChips() const noexcept {
+    return { this->chips_.data(), this->n_ * this->k_ };
+}
+
+ColumnView Board::getColumn(size_t c) const noexcept {
+    return { this->chips_.data() + c * this->k_, this->k_ };
 }
 
 int Board::getChipRow(size_t c, size_t idx) const noexcept {
-    return this->boardState_.at(c).at(idx);
+    return this->chips_[c * this->k_ + idx];
 }
 
 bool Board::chipIsMoved(size_t c, size_t idx) const noexcept {
-    return this->chipIsMoved_.at(c).at(idx);
+    return (this->chipIsMoved_ >> (c * this->k_ + idx)) & 1;
 }
 
-void Board::tidy() noexcept {
-    // Sort the chips in each column
-    for (size_t c = 0; c < this->n_; c++) {
-        this->tidy(c);
-    }
+std::uint64_t Board::getColumnMoved(size_t c) const noexcept {
+    std::uint64_t columnMask = this->k_ >= 64 ? ~0ULL : (1ULL << this->k_) - 1;
+    return (this->chipIsMoved_ >> (c * this->k_)) & columnMask;
 }
 
 void Board::tidy(size_t c) noexcept {
-    // Bind each chip to its corresponding moved boolean
-    std::vector<std::pair<int, bool>> chips;
-    for (size_t idx = 0; idx < this->k_; idx++) {
-        chips.emplace_back(this->boardState_[c][idx], this->chipIsMoved_[c][idx]);
-    }
-
-    // Sort the chips in descending order
-    std::sort(chips.begin(), chips.end(), std::greater<>());
-
-    // Update the board state and chipIsMoved
-    for (size_t idx = 0; idx < this->k_; idx++) {
-        this->boardState_[c][idx] = chips[idx].first;
-        this->chipIsMoved_[c][idx] = chips[idx].second;
-    }
+    // Extract the moved flags of the column, sort, and put them back
+    size_t begin = c * this->k_;
+    std::uint64_t columnMask = this->k_ >= 64 ? ~0ULL : (1ULL << this->k_) - 1;
+    std::uint64_t moved = this->getColumnMoved(c);
+    dispatchOnK(this->k_, [&]<size_t K>() {
+        column_kernels::sortColumn<K>(this->chips_.data() + begin, moved, this->k_);
+    });
+    this->chipIsMoved_ = (this->chipIsMoved_ & ~(columnMask << begin)) | (moved << begin);
 }
@@ -1,3 +1,4 @@
+#include <bit>
 #include "board.h"
 
 bool Board::apply(const PusherMove& move) {
@@ -5,6 +6,7 @@ bool Board::apply(const PusherMove& move) {
     size_t k = this->k_;
 
     bool result = false;
+    std::uint64_t touchedColumns = 0;
     for (size_t encodedIndex : move) {
         size_t c = encodedIndex / k;
         size_t idx = encodedIndex % k;
@@ -15,18 +17,22 @@ bool Board::apply(const PusherMove& move) {
         }
 
         // Skip removed chip
-        if (this->boardState_[c][idx] == -1) {
+        if (this->chips_[encodedIndex] == -1) {
             continue;
         }
 
         // Move the chip
-        this->boardState_[c][idx]++;
-        this->chipIsMoved_[c][idx] = true;
+        this->chips_[encodedIndex]++;
+        this->chipIsMoved_ |= 1ULL << encodedIndex;
+        touchedColumns |= 1ULL << c;
         result = true;
     }
 
-    // Tidy the board
-    this->tidy();
+    // Tidy the columns that were pushed. The other columns are still sorted.
+    while (touchedColumns) {
+        this->tidy(std::countr_zero(touchedColumns));
+        touchedColumns &= touchedColumns - 1;
+    }
 
     return result;
 }
@@ -43,19 +49,16 @@ bool Board::apply(RemoverMove move) {
     // Remove the chips
     bool result = false;
     for (size_t idx = 0; idx < k; idx++) {
-        if (this->chipIsMoved_[move][idx]) {
-            this->boardState_[move][idx] = -1;
+        size_t i = move * k + idx;
+        if (this->chipIsMoved_ & (1ULL << i)) {
+            this->chips_[i] = -1;
             this->numChips_--;
             result = true;
         }
     }
 
     // Reset chipIsMoved to false
-    for (size_t c = 0; c < n; c++) {
-        for (size_t idx = 0; idx < k; idx++) {
-            this->chipIsMoved_[c][idx] = false;
-        }
-    }
+    this->chipIsMoved_ = 0;
 
     // Tidy the board
     if (result) {
@@ -7,7 +7,7 @@ std::vector<PusherMove> Board::getPusherMoves() const noexcept {
     std::vector<size_t> movableChips;
     for (size_t c = 0; c < this->n_; c++) {
         for (size_t idx = 0; idx < this->k_; idx++) {
-            if (this->boardState_[c][idx] != -1) {
+            if (this->chips_[c * this->k_ + idx] != -1) {
                 movableChips.push_back(c * this->k_ + idx);
             }
         }
@@ -26,8 +26,8 @@ std::vector<RemoverMove> Board::getRemoverMoves() const noexcept {
     std::vector<RemoverMove> moves;
     std::vector<size_t> countMoved(this->n_, 0);
     for (size_t c = 0; c < this->n_; c++) {
-        for (bool moved : this->chipIsMoved_.at(c)) {
-            if (moved) {
+        for (size_t idx = 0; idx < this->k_; idx++) {
+            if (this->chipIsMoved(c, idx)) {
                 moves.push_back(c);
                 countMoved[c]++;
             }
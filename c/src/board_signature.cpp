@@ -0,0 +1,74 @@
+#include <algorithm>
+#include <functional>
+#include "board_signature.h"
+
+namespace {
+    template<typename T, size_t N>
+    bool isBelow(const std::array<T, N>& summary1, const std::array<T, N>& summary2) noexcept {
+        bool anyGreater = false;
+        for (size_t i = 0; i < N; i++) {
+            anyGreater |= summary1[i] > summary2[i];
+        }
+        return !anyGreater;
+    }
+
+    template<typename T, size_t N, typename F>
+    void merge(std::array<T, N>& summary, const std::array<T, N>& other, F&& pick) noexcept {
+        for (size_t i = 0; i < N; i++) {
+            summary[i] = pick(summary[i], other[i]);
+        }
+    }
+}
+
+BoardSignature::BoardSignature() noexcept : rowCounts(), ranks(), columnCodes() {}
+
+BoardSignature::BoardSignature(const Board& board) noexcept
+        : BoardSignature(board.getN(), board.getK(), board.getChips()) {}
+
+BoardSignature::BoardSignature(size_t n, size_t k, std::span<const Chip> chips) noexcept : BoardSignature() {
+    for (size_t c = 0; c < n; c++) {
+        const Chip* column = chips.data() + c * k;
+        int code = 0;
+        for (size_t i = 0; i < k; i++) {
+            Chip chip = column[i];
+            this->ranks[i * n + c] = chip;
+            code += chip + 1;
+
+            // Count the chip on every row up to its own
+            if (chip >= 0) {
+                size_t top = std::min((size_t)chip, HISTOGRAM_ROWS - 1);
+                for (size_t r = 0; r <= top; r++) {
+                    this->rowCounts[r]++;
+                }
+            }
+        }
+        this->columnCodes[c] = static_cast<std::int16_t>(code);
+    }
+
+    // Sort each rank and the column codes
+    for (size_t i = 0; i < k; i++) {
+        auto begin = this->ranks.begin() + (std::ptrdiff_t)(i * n);
+        std::sort(begin, begin + (std::ptrdiff_t)n, std::greater<>());
+    }
+    std::sort(this->columnCodes.begin(), this->columnCodes.begin() + (std::ptrdiff_t)n, std::greater<>());
+}
+
+bool BoardSignature::isBelow(const BoardSignature& other) const noexcept {
+    return ::isBelow(this->rowCounts, other.rowCounts)
+           && ::isBelow(this->ranks, other.ranks)
+           && ::isBelow(this->columnCodes, other.columnCodes);
+}
+
+void BoardSignature::expandMin(const BoardSignature& other) noexcept {
+    auto pick = [](auto a, auto b) { return std::min(a, b); };
+    merge(this->rowCounts, other.rowCounts, pick);
+    merge(this->ranks, other.ranks, pick);
+    merge(this->columnCodes, other.columnCodes, pick);
+}
+
+void BoardSignature::expandMax(const BoardSignature& other) noexcept {
+    auto pick = [](auto a, auto b) { return std::max(a, b); };
+    merge(this->rowCounts, other.rowCounts, pick);
+    merge(this->ranks, other.ranks, pick);
+    merge(this->columnCodes, other.columnCodes, pick);
+}
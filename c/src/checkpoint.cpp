@@ -0,0 +1,30 @@
+#include <chrono>
+#include <cstdio>
+#include <exception>
+#include "checkpoint.h"
+#include "progress.h"
+
+CheckpointWriter::~CheckpointWriter() {
+    this->wait();
+}
+
+void CheckpointWriter::write(std::string name, std::function<void()> job) {
+    this->wait();
+    this->thread_ = std::thread([name = std::move(name), job = std::move(job)]() {
+        auto start = std::chrono::steady_clock::now();
+        try {
+            job();
+        } catch (const std::exception& e) {
+            ProgressReporter::printMessage("Failed to write checkpoint %s: %s\n", name.c_str(), e.what());
+            return;
+        }
+        double duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        ProgressReporter::printMessage("Wrote checkpoint %s in %.2f seconds\n", name.c_str(), duration);
+    });
+}
+
+void CheckpointWriter::wait() {
+    if (this->thread_.joinable()) {
+        this->thread_.join();
+    }
+}
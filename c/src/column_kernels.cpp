@@ -0,0 +1,36 @@
+#include "column_kernels.h"
+
+namespace {
+    using column_kernels::forEachChip;
+
+    template<size_t K>
+    EncodedColumnState encodeColumn(const Chip* column, size_t k, int goal) noexcept {
+        // Same digits as encodeColState(): the last chip is the most significant digit
+        size_t width = K ? K : k;
+        EncodedColumnState encoded = 0;
+        forEachChip<K>(k, [&](size_t i) {
+            encoded += (column[width - 1 - i] + 1);
+            encoded *= (goal + 2);
+        });
+        return encoded;
+    }
+
+    template<size_t K>
+    constexpr ColumnKernels makeKernels() {
+        return { K, column_kernels::sortColumn<K>, column_kernels::compareColumns<K>, encodeColumn<K> };
+    }
+
+    constexpr ColumnKernels GENERIC_KERNELS = makeKernels<0>();
+    constexpr ColumnKernels K2_KERNELS = makeKernels<2>();
+    constexpr ColumnKernels K3_KERNELS = makeKernels<3>();
+    constexpr ColumnKernels K4_KERNELS = makeKernels<4>();
+}
+
+const ColumnKernels& getColumnKernels(size_t k) noexcept {
+    return dispatchOnK(k, []<size_t K>() -> const ColumnKernels& {
+        if constexpr (K == 2) return K2_KERNELS;
+        else if constexpr (K == 3) return K3_KERNELS;
+        else if constexpr (K == 4) return K4_KERNELS;
+        else return GENERIC_KERNELS;
+    });
+}
@@ -1,5 +1,10 @@
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <functional>
+#include <mutex>
+#include "column_kernels.h"
 #include "compare.h"
 #include "graph.h"
 
@@ -48,114 +53,276 @@ CompResult compareSortedCols(const std::vector<int>& col1, const std::vector<int
     else return CompResult::INCOMPARABLE;
 }
 
+CompResult compareSortedCols(ColumnView col1, ColumnView col2) {
+    return getColumnKernels(col1.size()).compare(col1.data(), col2.data(), col1.size());
+}
+
 #ifdef USE_HOPCROFT_KARP
 
-CompResult compareBoards(const Board& board1, const Board& board2, Purpose purpose) {
-    // 1. Make sure the boards have the same dimensions
-    if (board1.getN() != board2.getN() || board1.getK() != board2.getK()) {
-        return CompResult::INCOMPARABLE;
-    }
-    size_t n = board1.getN();
-    size_t k = board1.getK();
+namespace {
+    // Counters of a single thread. Only the owning thread writes them, so plain loads and stores are enough, while the
+    // atomics let getCompareStats() read them from any thread.
+    struct LocalCompareStats {
+        std::array<std::atomic<size_t>, 10> counters{};
+        /// @brief Advanced by every call of this thread, to pick the calls that are timed. Only read by its thread.
+        size_t timingTick = 0;
 
-    // 2. Edge cases
-    if (n == 0 || k == 0) {
-        return CompResult::EQUAL;
-    }
+        LocalCompareStats() noexcept;
+        ~LocalCompareStats() noexcept;
 
-    bool possLess = true;  // Whether board 1 is possible to be less than board 2
-    bool possMore = true;  // Whether board 2 is possible to be more than board 1
-    if (purpose == Purpose::LESS) {
-        possMore = false;
-    }
-    if (purpose == Purpose::GREATER) {
-        possLess = false;
-    }
-    if (board1.getNumChips() > board2.getNumChips()) {
-        possLess = false;
-    }
-    if (board1.getNumChips() < board2.getNumChips()) {
-        possMore = false;
-    }
-    if (!possLess && !possMore) {
-        return CompResult::INCOMPARABLE;
+        void increment(size_t index, size_t value = 1) noexcept {
+            counters[index].store(counters[index].load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+        }
+    };
+
+    // All live per-thread counters, plus the totals of threads that already exited
+    struct CompareStatsRegistry {
+        std::mutex mutex;
+        std::vector<LocalCompareStats*> live;
+        std::array<size_t, 10> retired{};
+    };
+
+    CompareStatsRegistry& getRegistry() noexcept {
+        static CompareStatsRegistry registry;
+        return registry;
     }
 
-    // 3. Check the highest chip in each column. If they are incomparable then the entire boards are incomparable.
-    std::vector<int> board1Top;
-    std::vector<int> board2Top;
-    board1Top.reserve(n);
-    board2Top.reserve(n);
-    for (size_t i = 0; i < n; ++i) {
-        board1Top.push_back(board1.getBoardState().at(i).at(0));
-        board2Top.push_back(board2.getBoardState().at(i).at(0));
+    LocalCompareStats::LocalCompareStats() noexcept {
+        CompareStatsRegistry& registry = getRegistry();
+        std::lock_guard lock(registry.mutex);
+        registry.live.push_back(this);
     }
-    std::sort(board1Top.begin(), board1Top.end(), std::greater<>());
-    std::sort(board2Top.begin(), board2Top.end(), std::greater<>());
-    if (compareSortedCols(board1Top, board2Top) == CompResult::INCOMPARABLE) {
-        return CompResult::INCOMPARABLE;
+
+    LocalCompareStats::~LocalCompareStats() noexcept {
+        CompareStatsRegistry& registry = getRegistry();
+        std::lock_guard lock(registry.mutex);
+        for (size_t i = 0; i < counters.size(); i++) {
+            registry.retired[i] += counters[i].load(std::memory_order_relaxed);
+        }
+        std::erase(registry.live, this);
     }
 
-    // 4. Actual comparison algorithm. See paper for details
-    bool firstIsLess = false, secondIsLess = false;
+    thread_local LocalCompareStats localStats;
 
-    // Prepare the graph
-    Graph graph;
-    std::unordered_map<std::string, int> partition;
-    for (size_t i = 0; i < n; i++) {
-        std::string a = "A" + std::to_string(i);
-        std::string b = "B" + std::to_string(i);
-        partition[a] = 0; partition[b] = 1;
-        graph.addVertex(a); graph.addVertex(b);
+    // Indices into the counters, in the same order as CompareStats
+    enum StatIndex : size_t {
+        CALLS, WITHOUT_SIGNATURES, BY_SIZE, BY_CHIP_COUNT, BY_HISTOGRAM, BY_RANKS, BY_COLUMN_CODES, MATCHED,
+        TIMED_CALLS, TIMED_NANOSECONDS
+    };
+
+    // One call in this many is timed. Reading the clock costs about as much as a call settled by the filters, so timing
+    // every call would double the time it measures.
+    constexpr size_t TIMING_INTERVAL = 64;
+
+    // Counts a call of either overload of compareBoards(), and times it if it is the sampled one of its thread
+    template<typename F>
+    CompResult countCall(F&& compare) {
+        localStats.increment(CALLS);
+        if (++localStats.timingTick % TIMING_INTERVAL != 0) {
+            return compare();
+        }
+        auto start = std::chrono::steady_clock::now();
+        CompResult result = compare();
+        auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+        localStats.increment(TIMED_CALLS);
+        localStats.increment(TIMED_NANOSECONDS, (size_t)duration.count());
+        return result;
     }
 
-    // Find perfect matching
-    if (purpose != Purpose::GREATER) {
-        // Populate graph with edges
-        for (size_t i = 0; i < n; i++) {
-            for (size_t j = 0; j < n; j++) {
-                switch (compareSortedCols(board1.getBoardState().at(i), board2.getBoardState().at(j))) {
-                    case CompResult::LESS:
-                    case CompResult::EQUAL: {
-                        std::string a = "A" + std::to_string(i);
-                        std::string b = "B" + std::to_string(j);
-                        graph.addEdge(a, b);
-                        graph.addEdge(b, a);
-                        break;
-                    }
-                    default:
-                        break;
-                }
-            }
+    // Rules out the directions in which the summary of board 1 is not dominated by (or does not dominate) the summary of
+    // board 2 at every position. Returns whether any direction remains possible.
+    template<typename T, size_t N>
+    bool narrow(const std::array<T, N>& summary1, const std::array<T, N>& summary2, bool& possLess, bool& possMore) {
+        bool anyGreater = false, anyLess = false;
+        for (size_t i = 0; i < N; i++) {
+            anyGreater |= summary1[i] > summary2[i];
+            anyLess |= summary1[i] < summary2[i];
         }
-        firstIsLess = hopcroftKarp(graph, partition) == n;
+        if (anyGreater) possLess = false;
+        if (anyLess) possMore = false;
+        return possLess || possMore;
     }
-    if (purpose != Purpose::LESS) {
-        graph.clearEdges();
-        // Populate graph with edges
+
+    // Step 4 of compareBoards(): build the column graphs and find the perfect matchings. Templated on the number of
+    // chips per column, so the column comparison is inlined and unrolled in the n^2 loop.
+    template<size_t K>
+    CompResult matchColumns(const Board& board1, const Board& board2, bool possLess, bool possMore) noexcept {
+        size_t n = board1.getN();
+        size_t k = board1.getK();
+
+        // Board 1 is less than board 2 if the columns can be matched such that each column of board 1 is less than or
+        // equal to its partner in board 2, i.e. the bipartite graph of such pairs has a perfect matching. Same for
+        // greater.
+        BitMatrix lessOrEqual, greaterOrEqual;
         for (size_t i = 0; i < n; i++) {
+            std::uint64_t lessRow = 0, greaterRow = 0;
+            const Chip* col1 = board1.getColumn(i).data();
             for (size_t j = 0; j < n; j++) {
-                switch (compareSortedCols(board1.getBoardState().at(i), board2.getBoardState().at(j))) {
+                switch (column_kernels::compareColumns<K>(col1, board2.getColumn(j).data(), k)) {
+                    case CompResult::LESS:
+                        lessRow |= 1ULL << j;
+                        break;
                     case CompResult::GREATER:
-                    case CompResult::EQUAL: {
-                        std::string a = "A" + std::to_string(i);
-                        std::string b = "B" + std::to_string(j);
-                        graph.addEdge(a, b);
-                        graph.addEdge(b, a);
+                        greaterRow |= 1ULL << j;
+                        break;
+                    case CompResult::EQUAL:
+                        lessRow |= 1ULL << j;
+                        greaterRow |= 1ULL << j;
                         break;
-                    }
                     default:
                         break;
                 }
             }
+            lessOrEqual[i] = lessRow;
+            greaterOrEqual[i] = greaterRow;
         }
-        secondIsLess = hopcroftKarp(graph, partition) == n;
+
+        // Find perfect matching
+        // A perfect matching implies the chip counts are comparable too, so skipping the impossible direction is exact.
+        bool firstIsLess = possLess && hasPerfectMatching(lessOrEqual, n);
+        bool secondIsLess = possMore && hasPerfectMatching(greaterOrEqual, n);
+
+        if (firstIsLess && secondIsLess) return CompResult::EQUAL;
+        else if (firstIsLess) return CompResult::LESS;
+        else if (secondIsLess) return CompResult::GREATER;
+        else return CompResult::INCOMPARABLE;
     }
 
-    if (firstIsLess && secondIsLess) return CompResult::EQUAL;
-    else if (firstIsLess) return CompResult::LESS;
-    else if (secondIsLess) return CompResult::GREATER;
-    else return CompResult::INCOMPARABLE;
+    // Selects the instantiation of matchColumns() for the number of chips per column, once per comparison
+    CompResult matchColumns(const Board& board1, const Board& board2, bool possLess, bool possMore) noexcept {
+        return dispatchOnK(board1.getK(), [&]<size_t K>() {
+            return matchColumns<K>(board1, board2, possLess, possMore);
+        });
+    }
+
+    // compareBoards() without signatures, without the counting of the call
+    CompResult compareWithoutSignatures(const Board& board1, const Board& board2, Purpose purpose) {
+        // 1. Make sure the boards have the same dimensions
+        if (board1.getN() != board2.getN() || board1.getK() != board2.getK()) {
+            return CompResult::INCOMPARABLE;
+        }
+        size_t n = board1.getN();
+        size_t k = board1.getK();
+
+        // 2. Edge cases
+        if (n == 0 || k == 0) {
+            return CompResult::EQUAL;
+        }
+
+        bool possLess = true;  // Whether board 1 is possible to be less than board 2
+        bool possMore = true;  // Whether board 2 is possible to be more than board 1
+        if (purpose == Purpose::LESS) {
+            possMore = false;
+        }
+        if (purpose == Purpose::GREATER) {
+            possLess = false;
+        }
+        if (board1.getNumChips() > board2.getNumChips()) {
+            possLess = false;
+        }
+        if (board1.getNumChips() < board2.getNumChips()) {
+            possMore = false;
+        }
+        if (!possLess && !possMore) {
+            return CompResult::INCOMPARABLE;
+        }
+
+        // 3. Check the highest chip in each column. If they are incomparable then the entire boards are incomparable.
+        std::array<Chip, Board::MAX_CHIPS> board1Top, board2Top;
+        for (size_t i = 0; i < n; ++i) {
+            board1Top[i] = static_cast<Chip>(board1.getChipRow(i, 0));
+            board2Top[i] = static_cast<Chip>(board2.getChipRow(i, 0));
+        }
+        std::sort(board1Top.begin(), board1Top.begin() + (std::ptrdiff_t)n, std::greater<>());
+        std::sort(board2Top.begin(), board2Top.begin() + (std::ptrdiff_t)n, std::greater<>());
+        CompResult topResult = compareSortedCols(ColumnView(board1Top.data(), n), ColumnView(board2Top.data(), n));
+        if (topResult == CompResult::INCOMPARABLE) {
+            return CompResult::INCOMPARABLE;
+        }
+
+        // 4. Actual comparison algorithm. See paper for details
+        return matchColumns(board1, board2, possLess, possMore);
+    }
+
+    // compareBoards() with signatures, without the counting of the call
+    CompResult compareSignatures(
+            const Board& board1, const BoardSignature& signature1, const Board& board2,
+            const BoardSignature& signature2, Purpose purpose) {
+
+        // 1. Make sure the boards have the same dimensions
+        if (board1.getN() != board2.getN() || board1.getK() != board2.getK()) {
+            localStats.increment(BY_SIZE);
+            return CompResult::INCOMPARABLE;
+        }
+
+        // 2. Edge cases
+        if (board1.getN() == 0 || board1.getK() == 0) {
+            localStats.increment(BY_SIZE);
+            return CompResult::EQUAL;
+        }
+
+        bool possLess = purpose != Purpose::GREATER && board1.getNumChips() <= board2.getNumChips();
+        bool possMore = purpose != Purpose::LESS && board1.getNumChips() >= board2.getNumChips();
+        if (!possLess && !possMore) {
+            localStats.increment(BY_CHIP_COUNT);
+            return CompResult::INCOMPARABLE;
+        }
+
+        // 3. Signature filters, from cheapest to most expensive. The rank vectors include the top check.
+        if (!narrow(signature1.rowCounts, signature2.rowCounts, possLess, possMore)) {
+            localStats.increment(BY_HISTOGRAM);
+            return CompResult::INCOMPARABLE;
+        }
+        if (!narrow(signature1.ranks, signature2.ranks, possLess, possMore)) {
+            localStats.increment(BY_RANKS);
+            return CompResult::INCOMPARABLE;
+        }
+        if (!narrow(signature1.columnCodes, signature2.columnCodes, possLess, possMore)) {
+            localStats.increment(BY_COLUMN_CODES);
+            return CompResult::INCOMPARABLE;
+        }
+
+        // 4. Actual comparison algorithm
+        localStats.increment(MATCHED);
+        return matchColumns(board1, board2, possLess, possMore);
+    }
+}
+
+CompResult compareBoards(
+        const Board& board1, const BoardSignature& signature1, const Board& board2, const BoardSignature& signature2,
+        Purpose purpose) {
+
+    return countCall([&]() { return compareSignatures(board1, signature1, board2, signature2, purpose); });
+}
+
+CompResult compareBoards(const Board& board1, const Board& board2, Purpose purpose) {
+    localStats.increment(WITHOUT_SIGNATURES);
+    return countCall([&]() { return compareWithoutSignatures(board1, board2, purpose); });
+}
+
+CompareStats getCompareStats() noexcept {
+    CompareStatsRegistry& registry = getRegistry();
+    std::lock_guard lock(registry.mutex);
+    std::array<size_t, 10> totals = registry.retired;
+    for (const LocalCompareStats* stats : registry.live) {
+        for (size_t i = 0; i < totals.size(); i++) {
+            totals[i] += stats->counters[i].load(std::memory_order_relaxed);
+        }
+    }
+    return { totals[CALLS], totals[WITHOUT_SIGNATURES], totals[BY_SIZE], totals[BY_CHIP_COUNT], totals[BY_HISTOGRAM],
+             totals[BY_RANKS], totals[BY_COLUMN_CODES], totals[MATCHED], totals[TIMED_CALLS],
+             totals[TIMED_NANOSECONDS] };
+}
+
+void resetCompareStats() noexcept {
+    CompareStatsRegistry& registry = getRegistry();
+    std::lock_guard lock(registry.mutex);
+    registry.retired.fill(0);
+    for (LocalCompareStats* stats : registry.live) {
+        for (std::atomic<size_t>& counter : stats->counters) {
+            counter.store(0, std::memory_order_relaxed);
+        }
+    }
 }
 
 #else
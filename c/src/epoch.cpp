@@ -0,0 +1,98 @@
+#include <algorithm>
+#include "epoch.h"
+
+namespace {
+    // Owns the slot of the current thread, and gives it back when the thread exits
+    struct EpochSlotOwner {
+        void* slot = nullptr;
+        std::function<void()> release;
+
+        ~EpochSlotOwner() {
+            if (this->release) this->release();
+        }
+    };
+
+    thread_local EpochSlotOwner slotOwner;
+}
+
+EpochManager::EpochManager() noexcept : epoch_(1), reclaimThreshold_(MIN_RECLAIM_THRESHOLD) {}
+
+EpochManager& EpochManager::getShared() {
+    static EpochManager* manager = new EpochManager();
+    return *manager;
+}
+
+EpochManager::Slot& EpochManager::getSlot() {
+    if (!slotOwner.slot) {
+        auto* slot = new Slot();
+        {
+            std::lock_guard lock(this->mutex_);
+            this->slots_.push_back(slot);
+        }
+        slotOwner.slot = slot;
+        slotOwner.release = [this, slot]() { this->release(slot); };
+    }
+    return *static_cast<Slot*>(slotOwner.slot);
+}
+
+void EpochManager::release(Slot* slot) {
+    std::lock_guard lock(this->mutex_);
+    std::erase(this->slots_, slot);
+    delete slot;
+    this->reclaimLocked();
+}
+
+EpochManager::Guard::Guard() noexcept {
+    Slot& slot = EpochManager::getShared().getSlot();
+    if (slot.depth++ == 0) {
+        // Announce the current epoch before loading any shared pointer
+        slot.epoch.store(EpochManager::getShared().epoch_.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+    }
+}
+
+EpochManager::Guard::~Guard() noexcept {
+    Slot& slot = EpochManager::getShared().getSlot();
+    if (--slot.depth == 0) {
+        slot.epoch.store(0, std::memory_order_release);
+    }
+}
+
+void EpochManager::retire(std::function<void()> deleter) {
+    std::lock_guard lock(this->mutex_);
+
+    // Readers that announced this epoch or an earlier one may still see the object
+    std::uint64_t epoch = this->epoch_.fetch_add(1, std::memory_order_seq_cst);
+    this->retired_.push_back({ epoch, std::move(deleter) });
+
+    // Only scan the readers once the list has doubled, so retiring stays cheap while a long reader holds everything
+    if (this->retired_.size() >= this->reclaimThreshold_) {
+        this->reclaimLocked();
+        this->reclaimThreshold_ = std::max(MIN_RECLAIM_THRESHOLD, this->retired_.size() * 2);
+    }
+}
+
+void EpochManager::reclaim() {
+    std::lock_guard lock(this->mutex_);
+    this->reclaimLocked();
+}
+
+void EpochManager::reclaimLocked() {
+    // The oldest epoch still announced by a reader
+    std::uint64_t oldest = UINT64_MAX;
+    for (const Slot* slot : this->slots_) {
+        std::uint64_t epoch = slot->epoch.load(std::memory_order_seq_cst);
+        if (epoch) oldest = std::min(oldest, epoch);
+    }
+
+    // Delete everything retired before that epoch
+    std::erase_if(this->retired_, [oldest](Retired& retired) {
+        if (retired.epoch >= oldest) return false;
+        retired.deleter();
+        return true;
+    });
+}
+
+size_t EpochManager::getNumRetired() {
+    std::lock_guard lock(this->mutex_);
+    return this->retired_.size();
+}
@@ -16,18 +16,9 @@ Player GameState::getWinner() const noexcept {
 }
 
 Board GameState::getBoardWithoutMovedChips() const noexcept {
-    size_t n = this->board_.getN();
-    size_t k = this->board_.getK();
-    std::vector<std::vector<int>> boardState = this->board_.getBoardState();
-    for (size_t c = 0; c < n; c++) {
-        for (size_t idx = 0; idx < k; idx++) {
-            if (this->board_.chipIsMoved(c, idx)) {
-                boardState[c][idx]--;
-            }
-        }
-    }
-
-    return { n, k, boardState };
+    Board board = this->board_;
+    board.undoPusherMove();
+    return board;
 }
 
 bool GameState::apply(const PusherMove& move) {
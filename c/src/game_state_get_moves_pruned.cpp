@@ -1,3 +1,4 @@
+#include <array>
 #include <algorithm>
 #include <set>
 #include "compare.h"
@@ -26,7 +27,7 @@ std::vector<std::vector<size_t>> findEquivColumns(const Board& board) {
 
         for (size_t c2 = c1 + 1; c2 < n; c2++) {
             // Check if next and col are equivalent columns
-            if (compareSortedCols(board.getBoardState().at(c1), board.getBoardState().at(c2)) == CompResult::EQUAL) {
+            if (compareSortedCols(board.getColumn(c1), board.getColumn(c2)) == CompResult::EQUAL) {
                 remaining.erase(c2);
                 equivClass.push_back(c2);
             }
@@ -214,13 +215,16 @@ std::vector<PusherMove> GameState::getPusherMovesPruned(int verbose) const noexc
         // For each group of equivalent columns, generate a list of encoded moves for a single column.
         std::vector<EncodedMove> movesForSingleColumn;
         size_t c = *equivClasses[i].begin();
-        size_t k_ = countMovableChips(board.getBoardState().at(c));
+        ColumnView column = board.getColumn(c);
+        size_t k_ = countMovableChips({ column.begin(), column.end() });
         size_t two_to_the_k_ = integerPow(2, k_);
 
         // Find all moves that generate different column states
         std::unordered_set<EncodedColumnState> moveResults;
         for (EncodedMove move = 0; move < two_to_the_k_; move++) {
-            ColumnState columnState = board.getBoardState().at(c);
+            std::array<Chip, Board::MAX_CHIPS> buffer;
+            std::span<Chip> columnState(buffer.data(), column.size());
+            std::copy(column.begin(), column.end(), columnState.begin());
             applyMoveToColumn(columnState, move);
             EncodedColumnState encodedColumnState = encodeColState(columnState, this->goal_);
             // If this move generates a new column state
@@ -244,7 +248,8 @@ std::vector<PusherMove> GameState::getPusherMovesPruned(int verbose) const noexc
     // Get the combined moves
     std::vector<std::vector<PusherMove>> combinedMoves(equivClasses.size());
     for (size_t i = 0; i < equivClasses.size(); i++) {
-        getCombinedMoves(equivClasses[i], board.getBoardState().at(equivClasses[i][0]),
+        ColumnView column = board.getColumn(equivClasses[i][0]);
+        getCombinedMoves(equivClasses[i], { column.begin(), column.end() },
                          movesForEachClass[i], combinedMoves[i], k, verbose);
     }
 
@@ -1,8 +1,52 @@
 #include <algorithm>
-#include <queue>
-#include <unordered_set>
+#include <bit>
+#include <cstdio>
 #include "../include/graph.h"
 
+CsrGraph::CsrGraph() noexcept : offsets_(1, 0), targets_() {}
+
+CsrGraph::CsrGraph(size_t numVertices, std::vector<std::pair<Vertex, Vertex>> edges)
+        : offsets_(numVertices + 1, 0), targets_() {
+
+    std::erase_if(edges, [numVertices](const std::pair<Vertex, Vertex>& edge) {
+        return edge.first >= numVertices || edge.second >= numVertices;
+    });
+    std::sort(edges.begin(), edges.end());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+    // Count the degrees, then take the prefix sums
+    for (const auto& [start, _] : edges) {
+        this->offsets_[start + 1]++;
+    }
+    for (size_t v = 0; v < numVertices; v++) {
+        this->offsets_[v + 1] += this->offsets_[v];
+    }
+
+    // The edges are sorted, so the targets of each vertex are already in place and in order
+    this->targets_.reserve(edges.size());
+    for (const auto& [_, end] : edges) {
+        this->targets_.push_back(end);
+    }
+}
+
+size_t CsrGraph::countV() const noexcept {
+    return this->offsets_.size() - 1;
+}
+
+size_t CsrGraph::countE() const noexcept {
+    return this->targets_.size();
+}
+
+bool CsrGraph::hasEdge(Vertex start, Vertex end) const noexcept {
+    std::span<const Vertex> neighbors = this->getNeighbors(start);
+    return std::binary_search(neighbors.begin(), neighbors.end(), end);
+}
+
+std::span<const CsrGraph::Vertex> CsrGraph::getNeighbors(Vertex vertex) const noexcept {
+    if (vertex >= this->countV()) return {};
+    return { this->targets_.data() + this->offsets_[vertex], this->targets_.data() + this->offsets_[vertex + 1] };
+}
+
 Graph::Graph() noexcept : neighbors_(), edgeCount_(0) {}
 
 bool Graph::hasVertex(const std::string& vertex) const noexcept {
@@ -86,198 +130,228 @@ void Graph::clear() noexcept {
     this->edgeCount_ = 0;
 }
 
-// Helper
-std::vector<std::vector<std::string>> getDisjointPaths(
-        const Graph& graph, const std::unordered_map<std::string, std::string>& matching,
-        const std::unordered_set<std::string>& unmatched1, const std::unordered_set<std::string>& unmatched2,
-        int verbose) {
-
-    using namespace std;
+size_t hopcroftKarp(const Graph& graph, const std::unordered_map<std::string, int>& partition, int verbose) noexcept {
+    using Vertex = CsrGraph::Vertex;
+
+    // Label the vertices with integers
+    std::vector<std::string> labels = graph.getVertices();
+    std::unordered_map<std::string, Vertex> ids;
+    std::vector<std::uint8_t> parts(labels.size());
+    for (size_t i = 0; i < labels.size(); i++) {
+        ids[labels[i]] = (Vertex)i;
+        auto it = partition.find(labels[i]);
+        parts[i] = it != partition.end() && it->second ? 1 : 0;
+    }
 
-    Graph pathGraph;
+    // Convert the edges
+    std::vector<std::pair<Vertex, Vertex>> edges;
+    edges.reserve(graph.countE());
+    for (size_t i = 0; i < labels.size(); i++) {
+        for (const std::string& neighbor : graph.getNeighbors(labels[i])) {
+            edges.emplace_back((Vertex)i, ids.at(neighbor));
+        }
+    }
 
-    vector<string> frontier(unmatched1.begin(), unmatched1.end());
-    pathGraph.addVertices(unmatched1.begin(), unmatched1.end());
-    int curLevel = 0;
-    bool reachedEnd = false;
+    CsrGraph csr(labels.size(), std::move(edges));
+    HopcroftKarpScratch scratch;
+    size_t count = hopcroftKarp(csr, parts, scratch);
 
     if (verbose) {
-        printf("Path graph layers:\n");
-        if (!frontier.empty()) {
-            for (const string& vertex: frontier) {
-                printf("   %s", vertex.c_str());
-            }
-            printf("\n");
+        printf("Maximum matching:\n");
+        for (size_t i = 0; i < labels.size(); i++) {
+            if (parts[i]) continue;
+            Vertex match = scratch.match[i];
+            printf("  %s -- %s\n", labels[i].c_str(), match == HopcroftKarpScratch::NIL ? "" : labels[match].c_str());
         }
     }
 
-    // Do BFS to construct path graph
-    while (!reachedEnd && !frontier.empty()) {
-        curLevel++;
-        vector<string> newFrontier;
-
-        // Each time add a new layer
-        for (const string& vertex : frontier) {
-            const string& match = matching.at(vertex);
-
-            // Partition can be determined from the level
-            if ((curLevel - 1) % 2 == 0) {
-                // If vertex is in the first partition, then look for edges not in the matching
-                for (const string& neighbor : graph.getNeighbors(vertex)) {
-                    if (neighbor == match) continue;
-                    if (pathGraph.hasVertex(neighbor)) continue;
-
-                    // Add neighbor to graph
-                    pathGraph.addVertex(neighbor);
-                    pathGraph.addEdge(neighbor, vertex);
-
-                    // Add neighbor to frontier
-                    newFrontier.push_back(neighbor);
+    return count;
+}
 
-                    // Check if should end
-                    if (unmatched2.contains(neighbor)) reachedEnd = true;
-                }
+namespace {
+    // Compute the BFS layers of the first partition, starting from its unmatched vertices. Returns whether an unmatched
+    // vertex of the second partition is reachable, i.e. whether the matching can still be augmented.
+    bool layer(const CsrGraph& graph, std::span<const std::uint8_t> partition, HopcroftKarpScratch& scratch) noexcept {
+        constexpr CsrGraph::Vertex NIL = HopcroftKarpScratch::NIL;
+        scratch.queue.clear();
+        for (CsrGraph::Vertex u = 0; u < graph.countV(); u++) {
+            if (partition[u] == 0 && scratch.match[u] == NIL) {
+                scratch.distance[u] = 0;
+                scratch.queue.push_back(u);
             } else {
-                // If vertex is in the second partition, then look for edges in the matching
-                if (match.empty()) continue;
-                if (pathGraph.hasVertex(match)) continue;
-
-                // Add neighbor to graph
-                pathGraph.addVertex(match);
-                pathGraph.addEdge(match, vertex);
-
-                // Add neighbor to frontier
-                newFrontier.push_back(match);
-
-                // Check if should end
-                if (unmatched2.contains(match)) reachedEnd = true;
+                scratch.distance[u] = NIL;
             }
         }
 
-        frontier = std::move(newFrontier);
-        if (verbose) {
-            printf(" ");
-            for (const string& vertex : frontier) {
-                printf(" (%s)", pathGraph.getNeighbors(vertex)[0].c_str());
-            }
-            printf("\n");
-            for (const string& vertex : frontier) {
-                printf("   %s", vertex.c_str());
+        bool found = false;
+        for (size_t head = 0; head < scratch.queue.size(); head++) {
+            CsrGraph::Vertex u = scratch.queue[head];
+            for (CsrGraph::Vertex v : graph.getNeighbors(u)) {
+                if (partition[v] == 0) continue;
+                CsrGraph::Vertex w = scratch.match[v];
+                if (w == NIL) {
+                    found = true;
+                } else if (scratch.distance[w] == NIL) {
+                    scratch.distance[w] = scratch.distance[u] + 1;
+                    scratch.queue.push_back(w);
+                }
             }
-            printf("\n");
         }
+        return found;
     }
 
-    // Use DFS to find disjoint paths
-    vector<vector<string>> paths;
-    unordered_set<string> usedVertices;
-    for (const string& start : unmatched2) {
-        if (!pathGraph.hasVertex(start)) continue;
-        vector<string> path;
-        string curr = start;
-        path.push_back(start);
-
-        // Find a disjoint path
-        while (true) {
-            // Try finding a valid next step
-            bool found = false;
-            for (const string& next : pathGraph.getNeighbors(curr)) {
-                if (usedVertices.contains(next)) continue;
-                path.push_back(next);
-                curr = next;
-                found = true;
+    // Search for an augmenting path from the unmatched vertex `start` along the BFS layers, and apply it if found. The
+    // DFS is iterative: the stack holds the first-partition vertices of the current path, and scratch.next[u] - 1 is the
+    // position of the edge the path takes out of u.
+    bool augmentPath(
+            const CsrGraph& graph, std::span<const std::uint8_t> partition, HopcroftKarpScratch& scratch,
+            CsrGraph::Vertex start) noexcept {
+
+        constexpr CsrGraph::Vertex NIL = HopcroftKarpScratch::NIL;
+        scratch.stack.clear();
+        scratch.stack.push_back(start);
+
+        while (!scratch.stack.empty()) {
+            CsrGraph::Vertex u = scratch.stack.back();
+            std::span<const CsrGraph::Vertex> neighbors = graph.getNeighbors(u);
+
+            // Dead end: remove u from the layers so no other path tries it again in this phase
+            if (scratch.next[u] == neighbors.size()) {
+                scratch.distance[u] = NIL;
+                scratch.stack.pop_back();
+                continue;
             }
 
-            // If no valid next step, then end search for path
-            if (!found) {
-                break;
+            CsrGraph::Vertex v = neighbors[scratch.next[u]++];
+            if (partition[v] == 0) continue;
+            CsrGraph::Vertex w = scratch.match[v];
+
+            if (w == NIL) {
+                // Flip the matching along the path
+                for (CsrGraph::Vertex x : scratch.stack) {
+                    CsrGraph::Vertex y = graph.getNeighbors(x)[scratch.next[x] - 1];
+                    scratch.match[x] = y;
+                    scratch.match[y] = x;
+                }
+                return true;
             }
 
-            // If reached end point, then record this path
-            if (unmatched1.contains(curr)) {
-                paths.push_back(path);
-                usedVertices.insert(path.begin(), path.end());
-                break;
+            if (scratch.distance[w] != NIL && scratch.distance[w] == scratch.distance[u] + 1) {
+                scratch.stack.push_back(w);
             }
         }
-    }
 
-    return paths;
-}
-
-size_t hopcroftKarp(const Graph& graph, const std::unordered_map<std::string, int>& partition, int verbose) noexcept {
-    using namespace std;
-
-    // Find the partitions
-    vector<string> part1;
-    vector<string> part2;
-    for (const auto& [vertex, part] : partition) {
-        (part ? part2 : part1).push_back(vertex);
+        return false;
     }
+}
 
-    // Matching: Maps a vertex in part1 to a vertex in part2 and vice versa. If no match then maps to empty string.
-    unordered_map<string, string> matching;
-    // Unmatched vertices in part1
-    unordered_set<string> unmatched1(part1.begin(), part1.end());
-    unordered_set<string> unmatched2(part2.begin(), part2.end());
+size_t hopcroftKarp(
+        const CsrGraph& graph, std::span<const std::uint8_t> partition, HopcroftKarpScratch& scratch) noexcept {
 
-    // Start with empty set of matching
-    for (const auto& [vertex, part] : partition) {
-        matching[vertex];
-    }
+    size_t numVertices = graph.countV();
+    scratch.match.assign(numVertices, HopcroftKarpScratch::NIL);
+    scratch.distance.resize(numVertices);
+    scratch.next.resize(numVertices);
 
-    while (!part1.empty() && !part2.empty()) {
-        if (verbose) {
-            printf("Current matching:\n");
-            for (const string& vertex : part1) {
-                printf("  %s -- %s\n", vertex.c_str(), matching[vertex].c_str());
+    size_t count = 0;
+    while (layer(graph, partition, scratch)) {
+        // Find a maximal set of vertex-disjoint shortest augmenting paths
+        std::fill(scratch.next.begin(), scratch.next.end(), 0);
+        size_t augmented = 0;
+        for (CsrGraph::Vertex u = 0; u < numVertices; u++) {
+            if (partition[u] == 0 && scratch.match[u] == HopcroftKarpScratch::NIL
+                && augmentPath(graph, partition, scratch, u)) {
+                augmented++;
             }
         }
+        if (!augmented) break;
+        count += augmented;
+    }
 
-        // Get the disjoint paths
-        vector<vector<string>> disjointPaths = getDisjointPaths(graph, matching, unmatched1, unmatched2, verbose);
+    return count;
+}
 
-        if (verbose) {
-            printf("Disjoint paths:\n");
-            for (const vector<string>& path : disjointPaths) {
-                if (path.empty()) {
-                    printf("  (empty)\n");
-                    break;
-                }
-                for (size_t i = 0; i < path.size(); i++) {
-                    printf(i ? " --" : " ");
-                    printf(" %s", path[i].c_str());
+namespace {
+    // Reusable state of hasPerfectMatching(). Vertex indices fit in a byte since there are at most 64 per side.
+    struct MatchingWorkspace {
+        static constexpr std::uint8_t UNMATCHED = 0xff;
+        std::array<std::uint8_t, 64> matchLeft;   // Right vertex matched to each left vertex
+        std::array<std::uint8_t, 64> matchRight;  // Left vertex matched to each right vertex
+        std::array<std::uint8_t, 64> parent;      // Left vertex from which each right vertex was reached
+        std::array<std::uint8_t, 64> queue;       // BFS queue of left vertices
+    };
+
+    thread_local MatchingWorkspace workspace;
+
+    // Search for an augmenting path starting from the unmatched left vertex `start`, and apply it if found
+    bool augment(const BitMatrix& adjacency, MatchingWorkspace& ws, std::uint8_t start) noexcept {
+        std::uint64_t reached = 0;
+        size_t head = 0, tail = 0;
+        ws.queue[tail++] = start;
+
+        while (head < tail) {
+            std::uint8_t u = ws.queue[head++];
+            std::uint64_t candidates = adjacency[u] & ~reached;
+            reached |= candidates;
+
+            while (candidates) {
+                auto v = static_cast<std::uint8_t>(std::countr_zero(candidates));
+                candidates &= candidates - 1;
+                ws.parent[v] = u;
+
+                if (ws.matchRight[v] == MatchingWorkspace::UNMATCHED) {
+                    // Flip the matching along the path back to the start
+                    while (true) {
+                        std::uint8_t w = ws.parent[v];
+                        std::uint8_t next = ws.matchLeft[w];
+                        ws.matchLeft[w] = v;
+                        ws.matchRight[v] = w;
+                        if (w == start) return true;
+                        v = next;
+                    }
                 }
-                printf("\n");
+
+                // Continue from the left vertex currently matched to v
+                ws.queue[tail++] = ws.matchRight[v];
             }
         }
 
-        // If empty, we have the maximum matching
-        if (disjointPaths.empty()) break;
+        return false;
+    }
+}
 
-        for (const vector<string>& path : disjointPaths) {
-            // Augment the original matching
-            for (size_t i = 0; i + 1 < path.size(); i += 2) {
-                const string& v1 = path[i];
-                const string& v2 = path[i+1];
-                matching[v1] = v2;
-                matching[v2] = v1;
-            }
+bool hasPerfectMatching(const BitMatrix& adjacency, size_t n) noexcept {
+    // Every vertex on both sides needs at least one edge
+    std::uint64_t covered = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (!adjacency[i]) return false;
+        covered |= adjacency[i];
+    }
+    if ((size_t)std::popcount(covered) < n) return false;
+
+    MatchingWorkspace& ws = workspace;
+    ws.matchLeft.fill(MatchingWorkspace::UNMATCHED);
+    ws.matchRight.fill(MatchingWorkspace::UNMATCHED);
+
+    // Greedy initial matching
+    std::uint64_t matched = 0;
+    for (size_t i = 0; i < n; i++) {
+        std::uint64_t candidates = adjacency[i] & ~matched;
+        if (candidates) {
+            auto v = static_cast<std::uint8_t>(std::countr_zero(candidates));
+            ws.matchLeft[i] = v;
+            ws.matchRight[v] = static_cast<std::uint8_t>(i);
+            matched |= 1ULL << v;
         }
-
-        // Update unmatched vertices
-        erase_if(unmatched1, [&matching](const string& vertex) {
-            return !matching[vertex].empty();
-        });
-        erase_if(unmatched2, [&matching](const string& vertex) {
-            return !matching[vertex].empty();
-        });
     }
 
-    // Count final matching
-    size_t count = 0;
-    for (const string& vertex : part1) {
-        if (!matching[vertex].empty()) count++;
+    // Augment the rest. A vertex without an augmenting path can never be matched later, so stop early.
+    for (size_t i = 0; i < n; i++) {
+        if (ws.matchLeft[i] == MatchingWorkspace::UNMATCHED
+            && !augment(adjacency, ws, static_cast<std::uint8_t>(i))) {
+            return false;
+        }
     }
-    return count;
+
+    return true;
 }
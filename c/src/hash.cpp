@@ -1,5 +1,6 @@
 #include <algorithm>
 #include <ranges>
+#include "column_kernels.h"
 #include "hash.h"
 
 void decodeMove(EncodedMove encoded, PusherMove& decoded, size_t k, size_t col) {
@@ -18,6 +19,36 @@ EncodedColumnState encodeColState(const ColumnState& column, int goal) {
     return encoded;
 }
 
+EncodedColumnState encodeColState(ColumnView column, int goal) {
+    return getColumnKernels(column.size()).encode(column.data(), column.size(), goal);
+}
+
+// Helper
+// Finalizer of SplitMix64. Spreads the bits of a column code over the whole word before summing.
+static std::uint64_t mix(std::uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+BoardHash hashBoard(const Board& board, int goal) {
+    size_t n = board.getN();
+    size_t k = board.getK();
+
+    // Sum of the mixed column codes, which is independent of the column order
+    BoardHash hash = 0;
+    for (size_t c = 0; c < n; c++) {
+        EncodedColumnState code = encodeColState(board.getColumn(c), goal);
+        hash += mix(code * 0x9e3779b97f4a7c15ULL + board.getColumnMoved(c));
+    }
+
+    // Include the size so that boards of different shapes rarely collide
+    return mix(hash ^ (n << 32) ^ k);
+}
+
 void applyMoveToColumn(ColumnState& column, EncodedMove move) {
     for (int& r : column) {
         if (move == 0) break;
@@ -30,6 +61,19 @@ void applyMoveToColumn(ColumnState& column, EncodedMove move) {
     std::sort(column.begin(), column.end(), std::greater<>());
 }
 
+void applyMoveToColumn(std::span<Chip> column, EncodedMove move) {
+    for (Chip& r : column) {
+        if (move == 0) break;
+        bool shouldMove = move % 2;
+        move /= 2;
+        if (shouldMove && r != -1) {
+            r++;
+        }
+    }
+    std::uint64_t moved = 0;
+    getColumnKernels(column.size()).sort(column.data(), moved, column.size());
+}
+
 std::string toString(EncodedMove move, size_t k) {
     std::string result;
     for (size_t _ = 0; _ < k; _++) {
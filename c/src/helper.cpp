@@ -18,8 +18,9 @@ size_t countMovableChips(const std::vector<int>& column) {
     return count;
 }
 
-std::filesystem::path getFilename(size_t n, size_t k, int goal, const std::string& suffix) {
-    return std::format("N{}_K{}_goal{}_board{}.txt", n, k, goal, suffix);
+std::filesystem::path getFilename(
+        size_t n, size_t k, int goal, const std::string& suffix, const std::string& extension) {
+    return std::format("N{}_K{}_goal{}_board{}{}", n, k, goal, suffix, extension);
 }
 
 std::string getCurrentTime() {
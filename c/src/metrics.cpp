@@ -0,0 +1,110 @@
+#include "archive_file.h"
+#include "compare.h"
+#include "helper.h"
+#include "json.hpp"
+#include "metrics.h"
+
+/// @brief Bumped whenever the layout of the file changes, so scripts comparing runs can tell.
+static constexpr int METRICS_VERSION = 1;
+
+std::filesystem::path getMetricsFilename(size_t n, size_t k, int goal) {
+    return "metrics" / getFilename(n, k, goal, "", ".json");
+}
+
+void saveMetrics(
+    const std::filesystem::path& filename, const GameState& startingState, const ProgressCounters& progress,
+    const Archive& archive, const TranspositionTable& table, std::chrono::duration<double> duration) {
+
+    // Nodes and branching factor per depth, up to the deepest depth reached
+    nlohmann::json depths = nlohmann::json::array();
+    size_t deepest = 0;
+    for (size_t d = 0; d <= ProgressCounters::MAX_DEPTH; d++) {
+        if (progress.getNodes(d)) deepest = d;
+    }
+    for (size_t d = 0; d <= deepest; d++) {
+        size_t expanded = progress.getExpanded(d), children = progress.getChildren(d);
+        depths.push_back({
+            { "depth", d },
+            { "nodes", progress.getNodes(d) },
+            { "expanded", expanded },
+            { "children", children },
+            { "branching-factor", expanded ? (double)children / (double)expanded : 0.0 },
+        });
+    }
+    size_t expanded = 0;
+    for (size_t d = 0; d <= ProgressCounters::MAX_DEPTH; d++) {
+        expanded += progress.getExpanded(d);
+    }
+
+    // Queries of the archive, per number of chips of the queried board
+    ArchiveStats archiveStats = archive.getStats();
+    nlohmann::json buckets = nlohmann::json::array();
+    ArchiveQueryStats total;
+    for (size_t c = 0; c <= Board::MAX_CHIPS; c++) {
+        const ArchiveQueryStats& queries = archiveStats.queries[c];
+        total.calls += queries.calls;
+        total.hits += queries.hits;
+        total.scanned += queries.scanned;
+        if (!queries.calls) continue;
+        buckets.push_back({
+            { "chips", c },
+            { "calls", queries.calls },
+            { "hits", queries.hits },
+            { "misses", queries.calls - queries.hits },
+            { "boards-scanned", queries.scanned },
+            { "boards-scanned-per-query", (double)queries.scanned / (double)queries.calls },
+        });
+    }
+
+    CompareStats compareStats = getCompareStats();
+    const Board& board = startingState.getBoard();
+    nlohmann::json json = {
+        { "version", METRICS_VERSION },
+        { "n", board.getN() },
+        { "k", board.getK() },
+        { "goal", startingState.getGoal() },
+        { "seconds", duration.count() },
+        { "nodes", progress.getNodes() },
+        { "depths", depths },
+        { "move-generation", {
+            { "calls", expanded },
+            { "seconds", std::chrono::duration<double>(progress.getMoveGenerationTime()).count() },
+        } },
+        { "predict-winner", {
+            { "calls", total.calls },
+            { "hits", total.hits },
+            { "misses", total.calls - total.hits },
+            { "boards-scanned", total.scanned },
+            { "boards-scanned-per-query", total.calls ? (double)total.scanned / (double)total.calls : 0.0 },
+            { "buckets", buckets },
+        } },
+        { "compare-boards", {
+            { "calls", compareStats.calls },
+            { "without-signatures", compareStats.withoutSignatures },
+            { "settled-by-size", compareStats.bySize },
+            { "settled-by-chip-count", compareStats.byChipCount },
+            { "settled-by-histogram", compareStats.byHistogram },
+            { "settled-by-ranks", compareStats.byRanks },
+            { "settled-by-column-codes", compareStats.byColumnCodes },
+            { "matched", compareStats.matched },
+            { "timed-calls", compareStats.timedCalls },
+            { "estimated-seconds", compareStats.getEstimatedSeconds() },
+        } },
+        { "archive", {
+            { "winning", archive.getWinningCount() },
+            { "losing", archive.getLosingCount() },
+            { "inserted", archiveStats.inserted },
+            { "rejected", archiveStats.rejected },
+            { "replaced", archiveStats.replaced },
+            { "pruned", archiveStats.pruned },
+        } },
+        { "transposition-table", {
+            { "hits", table.getHits() },
+            { "misses", table.getMisses() },
+            { "stores", table.getStores() },
+            { "replacements", table.getReplacements() },
+        } },
+    };
+
+    saveJsonFile(json, filename);
+}
@@ -1,6 +1,15 @@
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <optional>
 #include <stack>
+#include "checkpoint.h"
 #include "helper.h"
+#include "metrics.h"
 #include "minimax.h"
+#include "progress.h"
+#include "signals.h"
+#include "thread_pool.h"
 
 struct ProgressTracker {
     size_t depth;
@@ -8,128 +17,419 @@ struct ProgressTracker {
     size_t total;
 };
 
-std::tuple<short, short, short> getColor(size_t idx, size_t total) {
-    // idx = 1: Red
-    // idx = total: Green
-    if (total <= 1) {
-        return std::make_tuple<short, short, short>(0, 255, 0);
-    }
+std::filesystem::path getSearchPathFilename(size_t n, size_t k, int goal) {
+    return "search" / getFilename(n, k, goal, "", ".json");
+}
 
-    // Ratio
-    float t = (float)(idx - 1) / (float)(total - 1);
+std::vector<std::filesystem::path> findCheckpoints(
+    const std::filesystem::path& directory, size_t n, size_t k, int goal) {
+    std::vector<std::filesystem::path> checkpoints;
+    std::error_code error;
+    if (!std::filesystem::is_directory(directory, error)) {
+        return checkpoints;
+    }
 
-    // Scale color to have maximum lightness
-    if (t < 0.5) {
-        return std::make_tuple<short, short, short>(255, (short)(255.0f * t / (1 - t)), 0);
-    } else {
-        return std::make_tuple<short, short, short>((short)(255.0f * (1 - t) / t), 255, 0);
+    // Checkpoints are named after the game and suffixed with the time they were saved at, so sorting by name sorts by
+    // time
+    std::string prefix = getFilename(n, k, goal, "_", "").string();
+    for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(directory, error)) {
+        std::filesystem::path filename = entry.path().filename();
+        std::string stem = filename.stem().string(), extension = filename.extension().string();
+        if (!entry.is_regular_file(error) || !stem.starts_with(prefix) || stem.ends_with("_base") ||
+            (extension != getExtension(ArchiveFormat::TEXT) && extension != getExtension(ArchiveFormat::BINARY))) {
+            continue;
+        }
+        checkpoints.push_back(entry.path());
     }
+    std::sort(checkpoints.begin(), checkpoints.end());
+    return checkpoints;
 }
 
-void log(const ProgressTracker& pt, const std::string& msg) {
-    static size_t currentDepth = 0;
-    static constexpr size_t DEPTH_THRESHOLD = 7;
-
-    // Skip if too deep
-    if (pt.depth > DEPTH_THRESHOLD) {
-        return;
-    }
+/**
+ * Helper function
+ *
+ * Saves the partial result under winning/temp and losing/temp. Only copying the boards pauses the search: they are
+ * formatted and written by the checkpoint writer while the search goes on.
+ *
+ * If the archive has a journal, the boards found since the last checkpoint are already in it, so it is only flushed.
+ * Once it holds more records than the archive has boards, the archive is saved as the new base of the journal instead,
+ * and the generations the base includes are deleted.
+ *
+ * If the path of the search is given, it is saved in the search directory after the archive, along with the archive
+ * files it goes with. The metrics of the search are saved last, with the counters as they are when the files are
+ * written.
+ */
+void saveCheckpoint(
+    const GameState& state, const Archive& archive, const TranspositionTable& table, const ProgressCounters& progress,
+    CheckpointWriter& checkpointWriter, const SearchPath* path) {
 
-    // Adjust cursor position
-    if (pt.depth > currentDepth) {
-        for (size_t i = 0; i < pt.depth - currentDepth; i++) {
-            printf("\n");
+    size_t n = state.getBoard().getN(), k = state.getBoard().getK();
+    ArchiveFormat format = archive.getFileFormat();
+    ArchiveJournal* journal = archive.getJournal();
+    std::uint64_t lastGeneration = 0;
+    bool saveArchive = true;
+    std::string suffix = "_" + getCurrentTime();
+    if (journal) {
+        journal->flush();
+        saveArchive = journal->countRecords() > archive.getWinningCount() + archive.getLosingCount();
+        if (saveArchive) {
+            lastGeneration = journal->rotate();
         }
-    } else if (pt.depth < currentDepth) {
-        for (size_t i = 0; i < currentDepth - pt.depth; i++) {
-            printf("\033[2K\033[F");
+        suffix = "_base";
+    }
+    std::filesystem::path filename = getFilename(n, k, state.getGoal(), suffix, getExtension(format));
+    std::optional<SearchPath> searchPath;
+    if (path) {
+        searchPath = *path;
+        if (!journal) {
+            searchPath->winningFilename = "winning" / ("temp" / filename);
+            searchPath->losingFilename = "losing" / ("temp" / filename);
         }
-        printf("\033[2K\033[G");
-    } else {
-        printf("\033[2K\033[G");
     }
-    currentDepth = pt.depth;
-
-    // Print actual message
-    auto [r, g, b] = getColor(pt.idx, pt.total);
-    printf("\033[38;2;%d;%d;%dm", r, g, b);
-    printf("Depth %zu [%zu/%zu]: %s", pt.depth, pt.idx, pt.total, msg.c_str());
-    printf("\033[0m");
+    ArchiveSnapshot winning, losing;
+    if (saveArchive) {
+        winning = archive.getWinningSnapshot();
+        losing = archive.getLosingSnapshot();
+    }
 
-    // Flush
-    fflush(stdout);
+    checkpointWriter.write(
+        filename.string(),
+        [winning = std::move(winning), losing = std::move(losing), filename, format, journal, lastGeneration,
+         saveArchive, searchPath = std::move(searchPath), state, &archive, &table, &progress]() {
+            if (saveArchive) {
+                saveArchiveFile(winning.pack(), "winning" / ("temp" / filename), format);
+                saveArchiveFile(losing.pack(), "losing" / ("temp" / filename), format);
+                if (journal) {
+                    journal->removeGenerations(lastGeneration);
+                }
+            }
+            if (searchPath) {
+                saveSearchPath(*searchPath, getSearchPathFilename(searchPath->n, searchPath->k, searchPath->goal));
+            }
+            const Board& board = state.getBoard();
+            saveMetrics(getMetricsFilename(board.getN(), board.getK(), state.getGoal()), state, progress, archive,
+                        table, progress.getElapsed());
+        });
 }
 
-Player minimax(
-    const GameState& state, Archive& archive, double hoursPerSave, size_t threads, size_t& count,
-    const ProgressTracker& pt, std::chrono::time_point<std::chrono::steady_clock>& lastSaveTime) {
-
-    // Save the partial result
-    // In case there is an exception, we can still continue from where we left off
-    if (hoursPerSave > 0) {
-        auto currentTime = std::chrono::steady_clock::now();
-        double duration = std::chrono::duration_cast<std::chrono::duration<double>>(currentTime - lastSaveTime).count();
-        if (duration >= hoursPerSave * 3600) {
-            std::filesystem::path filename = getFilename(
-                state.getBoard().getN(), state.getBoard().getK(), state.getGoal(),
-                "_" + getCurrentTime());
-            archive.saveWinning("winning" / ("temp" / filename));
-            archive.saveLosing("losing" / ("temp" / filename));
-            lastSaveTime = currentTime;
+namespace {
+    // What every search needs to look a node up, expand it and record its winner
+    struct SearchContext {
+        Archive& archive;
+        TranspositionTable& table;
+        ProgressCounters& progress;
+        size_t threads;
+    };
+
+    /**
+     * The steps of a node shared by the sequential and the parallel search: look the winner up in the transposition
+     * table and the archive, expand the node, let searchChildren find the winner among the children, and record it.
+     *
+     * searchChildren is called with the children and the player to move. It adds the states it visits to count, and
+     * returns the player to move if one of the children wins for them, the opponent if none does, or Player::NONE if the
+     * search stopped before the winner was known, in which case nothing is recorded.
+     */
+    template<typename SearchChildren>
+    Player searchNode(
+        const GameState& state, const SearchContext& context, const ProgressTracker& pt, size_t& count,
+        SearchChildren&& searchChildren) {
+
+        // Count the state for the progress reporter
+        context.progress.enter(pt.depth, pt.idx, pt.total);
+        count++;
+
+        Player currPlayer = state.getCurrentPlayer();
+        size_t countBefore = count;
+
+        // 1. If we already know the winner, no need to expand further.
+        // Exact repeats of a Pusher-turn position are answered by the transposition table before scanning the archive.
+        bool useTable = currPlayer == Player::PUSHER && state.getWinner() == Player::NONE;
+        TranspositionTable::Key key{};
+        if (useTable) {
+            key = context.table.makeKey(state.getBoard());
+            Player winner = context.table.probe(key);
+            if (winner != Player::NONE) {
+                return winner;
+            }
+        }
+
+        Player winner = context.archive.predictWinner(state, context.threads);
+        context.progress.countArchiveQuery(winner != Player::NONE);
+        if (winner != Player::NONE) {
+            if (useTable) {
+                context.table.store(key, winner, 0);
+            }
+            return winner;
         }
-    }
 
-    // Log current progress
-    log(pt, "In progress");
-    count++;
+        // 2. Otherwise, expand all possible next states.
+        auto expandStart = std::chrono::steady_clock::now();
+        std::vector<GameState> nextStates = state.stepPruned();
+        context.progress.countExpansion(pt.depth, nextStates.size(), std::chrono::steady_clock::now() - expandStart);
 
-    Player currPlayer = state.getCurrentPlayer();
+        winner = searchChildren(nextStates, currPlayer);
+        if (winner == Player::NONE) {
+            return Player::NONE;
+        }
+
+        // 3. Record the result to the archive and the transposition table if the current player is Pusher
+        if (currPlayer == Player::PUSHER) {
+            winner == Player::PUSHER ? context.archive.addWinning(state.getBoard())
+                                     : context.archive.addLosing(state.getBoard());
+            context.table.store(key, winner, count - countBefore);
+        }
 
-    // 1. If we already know the winner, no need to expand further.
-    Player winner = archive.predictWinner(state, threads);
-    if (winner != Player::NONE) {
         return winner;
     }
 
-    // 2. Otherwise, expand all possible next states.
-    std::vector<GameState> nextStates = state.stepPruned();
-    size_t total = nextStates.size();
+    // State of a sequential search besides the node being searched
+    struct SequentialSearch {
+        SearchContext context;
+        double hoursPerSave;
+        std::chrono::time_point<std::chrono::steady_clock> lastSaveTime;
+        CheckpointWriter& checkpointWriter;
 
-    // Set winner to the opponent as the default value (because the opponent will win unless we find a winning move for
-    // the current player)
-    winner = (currPlayer == Player::PUSHER) ? Player::REMOVER : Player::PUSHER;
+        SearchPath path;                // The path to the node being searched, saved with every checkpoint
+        const SearchPath* resumePath;   // The path to continue from, until its last node is reached
+    };
 
-    for (size_t i = 0; i < total; i++) {
-        Player nextWinner = minimax(
-            nextStates[i], archive, hoursPerSave, threads, count,
-            { pt.depth + 1, i + 1, total }, lastSaveTime);
+    Player sequentialMinimax(
+        const GameState& state, SequentialSearch& search, const ProgressTracker& pt, size_t& count) {
 
-        // If the current player will win by making this move, then the move is optimal
-        // In that case, we know the current player will win since they have the optimal strategy
-        if (currPlayer == nextWinner) {
-            winner = currPlayer;
-            break;
+        // Save the partial result
+        // In case there is an exception, we can still continue from where we left off
+        // When asked to stop, this state is the last one visited: it is searched again when resuming
+        bool stop = isStopRequested();
+        bool save = stop || takeCheckpointRequest();
+        if (!save && search.hoursPerSave > 0) {
+            auto currentTime = std::chrono::steady_clock::now();
+            double duration =
+                std::chrono::duration_cast<std::chrono::duration<double>>(currentTime - search.lastSaveTime).count();
+            save = duration >= search.hoursPerSave * 3600;
+        }
+        if (save) {
+            search.path.count = count;
+            saveCheckpoint(state, search.context.archive, search.context.table, search.context.progress,
+                           search.checkpointWriter, &search.path);
+            search.lastSaveTime = std::chrono::steady_clock::now();
+        }
+        if (stop) {
+            return Player::NONE;
         }
 
-        // Otherwise the current player will lose by making this move, so we continue searching
-    }
+        return searchNode(state, search.context, pt, count, [&](std::vector<GameState>& nextStates, Player currPlayer) {
+            size_t total = nextStates.size();
+
+            // When resuming, skip the children that were solved before the checkpoint: none of them wins for the
+            // current player
+            size_t first = 0;
+            if (search.resumePath && pt.depth < search.resumePath->frames.size()) {
+                const SearchFrame& frame = search.resumePath->frames[pt.depth];
+                if (frame.total == total && frame.idx >= 1 && frame.idx <= total &&
+                    nextStates[frame.idx - 1].getBoard().toString() == frame.board.toString()) {
+                    first = frame.idx - 1;
+                } else {
+                    ProgressReporter::printMessage(
+                            "The saved search path does not match at depth %zu, resuming from there\n", pt.depth + 1);
+                    search.resumePath = nullptr;
+                }
+            } else {
+                search.resumePath = nullptr;
+            }
+
+            for (size_t i = first; i < total; i++) {
+                search.path.frames.push_back({ i + 1, total, nextStates[i].getBoard() });
+                Player nextWinner = sequentialMinimax(nextStates[i], search, { pt.depth + 1, i + 1, total }, count);
+                search.path.frames.pop_back();
+                search.resumePath = nullptr;
+
+                // The search was stopped before the winner was known, so nothing is recorded
+                if (nextWinner == Player::NONE) {
+                    return Player::NONE;
+                }
+
+                // If the current player will win by making this move, then the move is optimal
+                // In that case, we know the current player will win since they have the optimal strategy
+                if (currPlayer == nextWinner) {
+                    return currPlayer;
+                }
 
-    // 3. Record the result to the archive if the current player is Pusher
-    if (currPlayer == Player::PUSHER) {
-        winner == Player::PUSHER ? archive.addWinning(state.getBoard()) : archive.addLosing(state.getBoard());
+                // Otherwise the current player will lose by making this move, so we continue searching
+            }
+
+            // The opponent wins, since the current player has no winning move
+            return currPlayer == Player::PUSHER ? Player::REMOVER : Player::PUSHER;
+        });
     }
 
-    return winner;
+    // State shared by all tasks of a parallel search
+    struct ParallelSearch {
+        SearchContext context;
+        ThreadPool& pool;
+        double hoursPerSave;
+        size_t searchThreads;
+
+        std::mutex mutex;  // Guards saving
+        std::chrono::time_point<std::chrono::steady_clock> lastSaveTime;
+        CheckpointWriter& checkpointWriter;
+
+        // Number of tasks forked to help search the children of a node and not finished yet. Together with the thread
+        // that started the search, they are the threads searching the tree, so there are at most searchThreads - 1.
+        std::atomic<size_t> helpers = 0;
+
+        // Reserves up to wanted helper tasks, and returns how many were reserved
+        size_t reserveHelpers(size_t wanted) noexcept {
+            size_t busy = this->helpers.load(std::memory_order_relaxed);
+            size_t reserved;
+            do {
+                reserved = std::min(wanted, this->searchThreads - 1 - std::min(busy, this->searchThreads - 1));
+                if (reserved == 0) return 0;
+            } while (!this->helpers.compare_exchange_weak(busy, busy + reserved, std::memory_order_relaxed));
+            return reserved;
+        }
+    };
+
+    // A node whose children may be searched by several threads. Cancelling it cancels every subtree below it.
+    struct SplitPoint {
+        const SplitPoint* parent;
+        std::atomic<bool> cancelled = false;
+
+        [[nodiscard]] bool isCancelled() const noexcept {
+            for (const SplitPoint* node = this; node; node = node->parent) {
+                if (node->cancelled.load(std::memory_order_relaxed)) return true;
+            }
+            return false;
+        }
+    };
+
+    // Children of nodes this shallow may be searched by helper tasks, as long as there are search threads to spare
+    constexpr size_t MAX_SPLIT_DEPTH = 16;
+
+    // Same as sequentialMinimax(), except that children may be searched in parallel. Returns Player::NONE if the search
+    // was cancelled before the winner was known, in which case nothing is recorded.
+    Player parallelMinimax(
+        const GameState& state, ParallelSearch& search, const SplitPoint* splitPoint, const ProgressTracker& pt,
+        size_t& count) {
+
+        // When asked to stop, every task returns and the checkpoint is saved once the search has unwound
+        if ((splitPoint && splitPoint->isCancelled()) || isStopRequested()) {
+            return Player::NONE;
+        }
+
+        // Save the partial result, unless another thread is already doing it
+        {
+            std::unique_lock lock(search.mutex, std::try_to_lock);
+            if (lock.owns_lock()) {
+                auto currentTime = std::chrono::steady_clock::now();
+                double duration = std::chrono::duration<double>(currentTime - search.lastSaveTime).count();
+                if ((search.hoursPerSave > 0 && duration >= search.hoursPerSave * 3600) || takeCheckpointRequest()) {
+                    saveCheckpoint(state, search.context.archive, search.context.table, search.context.progress,
+                                   search.checkpointWriter, nullptr);
+                    search.lastSaveTime = currentTime;
+                }
+            }
+        }
+
+        return searchNode(state, search.context, pt, count, [&](std::vector<GameState>& nextStates, Player currPlayer) {
+            size_t total = nextStates.size();
+
+            // The threads searching this node take its children in order. The first child that wins for the current
+            // player cancels the others, which is what returning early from the sequential loop does.
+            SplitPoint node{ splitPoint };
+            std::atomic<size_t> next = 0, childCount = 0;
+            std::atomic<bool> found = false, incomplete = false;
+            auto searchChildren = [&]() {
+                size_t localCount = 0;
+                while (!node.isCancelled()) {
+                    size_t i = next.fetch_add(1, std::memory_order_relaxed);
+                    if (i >= total) {
+                        break;
+                    }
+                    Player nextWinner = parallelMinimax(
+                        nextStates[i], search, &node, { pt.depth + 1, i + 1, total }, localCount);
+                    if (nextWinner == currPlayer) {
+                        found.store(true, std::memory_order_relaxed);
+                        node.cancelled.store(true, std::memory_order_relaxed);
+                    } else if (nextWinner == Player::NONE) {
+                        incomplete.store(true, std::memory_order_relaxed);
+                        break;
+                    }
+                }
+                childCount.fetch_add(localCount, std::memory_order_relaxed);
+            };
+
+            // Helpers join this thread if there are search threads to spare. Tasks of the group are never skipped, as
+            // the group is not cancelled, so each of them gives its reservation back.
+            size_t helpers = total > 1 && pt.depth < MAX_SPLIT_DEPTH ? search.reserveHelpers(total - 1) : 0;
+            TaskGroup group(search.pool);
+            for (size_t h = 0; h < helpers; h++) {
+                group.run([&]() {
+                    searchChildren();
+                    search.helpers.fetch_sub(1, std::memory_order_relaxed);
+                });
+            }
+            searchChildren();
+            group.wait();
+            count += childCount.load(std::memory_order_relaxed);
+
+            if (found) {
+                return currPlayer;
+            } else if (incomplete || node.isCancelled()) {
+                // Stopped, or cancelled from above: some children were never searched
+                return Player::NONE;
+            }
+            return currPlayer == Player::PUSHER ? Player::REMOVER : Player::PUSHER;
+        });
+    }
 }
 
-Player minimax(const GameState& startingState, Archive& archive, double hoursPerSave, size_t threads, size_t& count) {
-    auto lastSaveTime = std::chrono::steady_clock::now();
+Player minimax(
+    const GameState& startingState, Archive& archive, TranspositionTable& table, double hoursPerSave, size_t threads,
+    size_t searchThreads, size_t& count, const SearchPath* resumePath) {
+
+    // Checkpoints still being written when the search ends are completed before returning, and the progress is reported
+    // until then
+    ProgressCounters progress;
+    CheckpointWriter checkpointWriter;
+    ProgressReporter reporter(progress);
+    SearchContext context{ archive, table, progress, threads };
+    Player winner;
+    if (searchThreads <= 1) {
+        const Board& board = startingState.getBoard();
+        SequentialSearch search{
+            context, hoursPerSave, std::chrono::steady_clock::now(), checkpointWriter, {}, resumePath };
+        search.path.n = board.getN();
+        search.path.k = board.getK();
+        search.path.goal = startingState.getGoal();
 
-    // Find the winner recursively
-    Player winner = minimax(startingState, archive, hoursPerSave, threads, count, { 0, 1, 1 }, lastSaveTime);
+        // Find the winner recursively
+        winner = sequentialMinimax(startingState, search, { 0, 1, 1 }, count);
+    } else {
+        if (resumePath) {
+            ProgressReporter::printMessage(
+                    "Only a single search thread can resume a search path, searching from the start\n");
+        }
 
-    // Log end
-    printf("\n");
+        // The search runs on the same pool as the archive queries, so the two never compete for more threads than the
+        // pool has. The calling thread searches too.
+        ParallelSearch search{
+            context, ThreadPool::getShared(), hoursPerSave, searchThreads, {}, std::chrono::steady_clock::now(),
+            checkpointWriter };
+        winner = parallelMinimax(startingState, search, nullptr, { 0, 1, 1 }, count);
+        if (isStopRequested()) {
+            saveCheckpoint(startingState, archive, table, progress, checkpointWriter, nullptr);
+        }
+    }
+    checkpointWriter.wait();
+
+    // The metrics of the whole search
+    const Board& board = startingState.getBoard();
+    std::filesystem::path metricsFilename = getMetricsFilename(board.getN(), board.getK(), startingState.getGoal());
+    try {
+        saveMetrics(metricsFilename, startingState, progress, archive, table, progress.getElapsed());
+    } catch (const std::exception& e) {
+        ProgressReporter::printMessage("Failed to save %s: %s\n", metricsFilename.string().c_str(), e.what());
+    }
 
     return winner;
 }
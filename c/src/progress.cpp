@@ -0,0 +1,222 @@
+#include <algorithm>
+#include <tuple>
+#include "progress.h"
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+    std::tuple<short, short, short> getColor(size_t idx, size_t total) {
+        // idx = 1: Red
+        // idx = total: Green
+        if (total <= 1) {
+            return std::make_tuple<short, short, short>(0, 255, 0);
+        }
+
+        // Ratio
+        float t = (float)(idx - 1) / (float)(total - 1);
+
+        // Scale color to have maximum lightness
+        if (t < 0.5) {
+            return std::make_tuple<short, short, short>(255, (short)(255.0f * t / (1 - t)), 0);
+        } else {
+            return std::make_tuple<short, short, short>((short)(255.0f * (1 - t) / t), 255, 0);
+        }
+    }
+
+    /// @brief Appends formatted text to a report.
+    template<typename... Args>
+    void appendFormat(std::string& text, const char* format, Args... args) {
+        char buffer[256];
+        int length = snprintf(buffer, sizeof(buffer), format, args...);
+        text.append(buffer, std::clamp(length, 0, (int)sizeof(buffer) - 1));
+    }
+
+    bool isTerminalFile(FILE* out) noexcept {
+#ifdef _WIN32
+        return _isatty(_fileno(out));
+#else
+        return isatty(fileno(out));
+#endif
+    }
+
+    /// @brief The reporter drawing a live view, which messages are printed above. Guarded by liveReporterMutex.
+    ProgressReporter* liveReporter = nullptr;
+    std::mutex liveReporterMutex;
+}
+
+ProgressCounters::ProgressCounters() noexcept : startTime_(std::chrono::steady_clock::now()) {}
+
+void ProgressCounters::enter(size_t depth, size_t idx, size_t total) noexcept {
+    DepthCounters& counters = this->depths_[std::min(depth, MAX_DEPTH)];
+    counters.nodes.fetch_add(1, std::memory_order_relaxed);
+    counters.idx.store(idx, std::memory_order_relaxed);
+    counters.total.store(total, std::memory_order_relaxed);
+    this->depth_.store(std::min(depth, MAX_DEPTH), std::memory_order_relaxed);
+}
+
+void ProgressCounters::countExpansion(size_t depth, size_t children, std::chrono::nanoseconds duration) noexcept {
+    DepthCounters& counters = this->depths_[std::min(depth, MAX_DEPTH)];
+    counters.expanded.fetch_add(1, std::memory_order_relaxed);
+    counters.children.fetch_add(children, std::memory_order_relaxed);
+    counters.moveGenerationNanoseconds.fetch_add(duration.count(), std::memory_order_relaxed);
+}
+
+void ProgressCounters::countArchiveQuery(bool hit) noexcept {
+    this->archiveQueries_.fetch_add(1, std::memory_order_relaxed);
+    if (hit) {
+        this->archiveHits_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+size_t ProgressCounters::getNodes() const noexcept {
+    size_t nodes = 0;
+    for (const DepthCounters& counters : this->depths_) {
+        nodes += counters.nodes.load(std::memory_order_relaxed);
+    }
+    return nodes;
+}
+
+size_t ProgressCounters::getNodes(size_t depth) const noexcept {
+    return this->depths_[std::min(depth, MAX_DEPTH)].nodes.load(std::memory_order_relaxed);
+}
+
+size_t ProgressCounters::getExpanded(size_t depth) const noexcept {
+    return this->depths_[std::min(depth, MAX_DEPTH)].expanded.load(std::memory_order_relaxed);
+}
+
+size_t ProgressCounters::getChildren(size_t depth) const noexcept {
+    return this->depths_[std::min(depth, MAX_DEPTH)].children.load(std::memory_order_relaxed);
+}
+
+std::chrono::nanoseconds ProgressCounters::getMoveGenerationTime() const noexcept {
+    size_t nanoseconds = 0;
+    for (const DepthCounters& counters : this->depths_) {
+        nanoseconds += counters.moveGenerationNanoseconds.load(std::memory_order_relaxed);
+    }
+    return std::chrono::nanoseconds(nanoseconds);
+}
+
+size_t ProgressCounters::getDepth() const noexcept {
+    return this->depth_.load(std::memory_order_relaxed);
+}
+
+std::pair<size_t, size_t> ProgressCounters::getPosition(size_t depth) const noexcept {
+    const DepthCounters& counters = this->depths_[std::min(depth, MAX_DEPTH)];
+    return { counters.idx.load(std::memory_order_relaxed), counters.total.load(std::memory_order_relaxed) };
+}
+
+size_t ProgressCounters::getArchiveQueries() const noexcept {
+    return this->archiveQueries_.load(std::memory_order_relaxed);
+}
+
+size_t ProgressCounters::getArchiveHits() const noexcept {
+    return this->archiveHits_.load(std::memory_order_relaxed);
+}
+
+std::chrono::duration<double> ProgressCounters::getElapsed() const noexcept {
+    return std::chrono::steady_clock::now() - this->startTime_;
+}
+
+ProgressReporter::ProgressReporter(const ProgressCounters& counters, FILE* out, std::chrono::milliseconds interval)
+        : counters_(counters), out_(out), terminal_(isTerminalFile(out)), interval_(interval),
+          startTime_(std::chrono::steady_clock::now()), lastTime_(startTime_), lastNodes_(counters.getNodes()),
+          lines_(0), stopping_(false) {
+    if (this->interval_ <= std::chrono::milliseconds::zero()) {
+        this->interval_ = this->terminal_ ? TERMINAL_INTERVAL : FILE_INTERVAL;
+    }
+    if (this->terminal_) {
+        std::lock_guard lock(liveReporterMutex);
+        liveReporter = this;
+    }
+    this->thread_ = std::thread(&ProgressReporter::run, this);
+}
+
+ProgressReporter::~ProgressReporter() {
+    {
+        std::lock_guard lock(this->mutex_);
+        this->stopping_ = true;
+    }
+    this->stopped_.notify_one();
+    this->thread_.join();
+    {
+        std::lock_guard lock(this->mutex_);
+        this->report();
+    }
+
+    // The last report stays on screen, so later messages go below it
+    std::lock_guard lock(liveReporterMutex);
+    if (liveReporter == this) {
+        liveReporter = nullptr;
+    }
+}
+
+bool ProgressReporter::isTerminal() const noexcept {
+    return this->terminal_;
+}
+
+void ProgressReporter::printMessageText(const std::string& text) {
+    std::lock_guard lock(liveReporterMutex);
+    if (liveReporter) {
+        // Clear the live view, so the message takes its place and the next report is drawn below the message
+        std::lock_guard reporterLock(liveReporter->mutex_);
+        if (liveReporter->lines_ > 0) {
+            fprintf(liveReporter->out_, "\033[%zuF\033[J", liveReporter->lines_);
+            fflush(liveReporter->out_);
+            liveReporter->lines_ = 0;
+        }
+        fputs(text.c_str(), stderr);
+        fflush(stderr);
+    } else {
+        fputs(text.c_str(), stderr);
+    }
+}
+
+void ProgressReporter::run() {
+    std::unique_lock lock(this->mutex_);
+    while (!this->stopped_.wait_for(lock, this->interval_, [this] { return this->stopping_; })) {
+        this->report();
+    }
+}
+
+void ProgressReporter::report() {
+    auto currentTime = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(currentTime - this->startTime_).count();
+    double interval = std::chrono::duration<double>(currentTime - this->lastTime_).count();
+    size_t nodes = this->counters_.getNodes();
+    double rate = interval > 0 ? (double)(nodes - this->lastNodes_) / interval : 0;
+    size_t queries = this->counters_.getArchiveQueries();
+    double hitRate = queries ? 100.0 * (double)this->counters_.getArchiveHits() / (double)queries : 0;
+    this->lastTime_ = currentTime;
+    this->lastNodes_ = nodes;
+    size_t depth = std::min(this->counters_.getDepth(), DISPLAYED_DEPTH);
+
+    // The whole report is written at once, with a single flush
+    std::string text;
+    if (this->terminal_) {
+        // Move back to the first line of the last report and clear it, then draw the path one depth per line
+        if (this->lines_ > 0) {
+            appendFormat(text, "\033[%zuF\033[J", this->lines_);
+        }
+        for (size_t d = 0; d <= depth; d++) {
+            auto [idx, total] = this->counters_.getPosition(d);
+            auto [r, g, b] = getColor(idx, total);
+            appendFormat(text, "\033[38;2;%d;%d;%dmDepth %zu [%zu/%zu]\033[0m\n", r, g, b, d, idx, total);
+        }
+        appendFormat(text, "%zu states, %.0f states/s, archive hit rate %.1f%%\n", nodes, rate, hitRate);
+        this->lines_ = depth + 2;
+    } else {
+        appendFormat(text, "[%.0fs] %zu states, %.0f states/s, archive hit rate %.1f%%, path", seconds, nodes, rate,
+                     hitRate);
+        for (size_t d = 0; d <= depth; d++) {
+            auto [idx, total] = this->counters_.getPosition(d);
+            appendFormat(text, " %zu/%zu", idx, total);
+        }
+        text += '\n';
+    }
+    fputs(text.c_str(), this->out_);
+    fflush(this->out_);
+}
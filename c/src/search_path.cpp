@@ -0,0 +1,60 @@
+#include <format>
+#include <fstream>
+#include <stdexcept>
+#include "archive_file.h"
+#include "json.hpp"
+#include "search_path.h"
+
+/// @brief Bumped whenever the layout of the file changes. Files of any other version are rejected.
+static constexpr int SEARCH_PATH_VERSION = 1;
+
+void saveSearchPath(const SearchPath& path, const std::filesystem::path& filename) {
+    nlohmann::json json = {
+        { "version", SEARCH_PATH_VERSION },
+        { "n", path.n },
+        { "k", path.k },
+        { "goal", path.goal },
+        { "count", path.count },
+        { "winning", path.winningFilename.string() },
+        { "losing", path.losingFilename.string() },
+        { "path", nlohmann::json::array() },
+    };
+    for (const SearchFrame& frame : path.frames) {
+        json["path"].push_back({ { "idx", frame.idx }, { "total", frame.total }, { "board", frame.board.toString() } });
+    }
+
+    saveJsonFile(json, filename);
+}
+
+std::optional<SearchPath> loadSearchPath(const std::filesystem::path& filename) {
+    if (!std::filesystem::exists(filename)) {
+        return std::nullopt;
+    }
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        throw std::runtime_error(std::format("Failed to open file for reading: {}", filename.string()));
+    }
+
+    try {
+        nlohmann::json json = nlohmann::json::parse(file);
+        if (json.at("version").get<int>() != SEARCH_PATH_VERSION) {
+            throw std::runtime_error(std::format("Unsupported search path version: {}", json.at("version").dump()));
+        }
+
+        SearchPath path;
+        path.n = json.at("n");
+        path.k = json.at("k");
+        path.goal = json.at("goal");
+        path.count = json.at("count");
+        path.winningFilename = json.at("winning").get<std::string>();
+        path.losingFilename = json.at("losing").get<std::string>();
+        for (const nlohmann::json& frame : json.at("path")) {
+            path.frames.push_back({ frame.at("idx"), frame.at("total"), Board(frame.at("board").get<std::string>()) });
+        }
+        return path;
+    } catch (const nlohmann::json::exception& e) {
+        throw std::runtime_error(std::format("Invalid search path {}: {}", filename.string(), e.what()));
+    } catch (const std::invalid_argument& e) {
+        throw std::runtime_error(std::format("Invalid search path {}: {}", filename.string(), e.what()));
+    }
+}
@@ -0,0 +1,34 @@
+#include <atomic>
+#include <csignal>
+#include "signals.h"
+
+namespace {
+    // Only lock-free atomics may be touched by a signal handler
+    std::atomic<bool> stopRequested = false;
+    std::atomic<bool> checkpointRequested = false;
+    static_assert(std::atomic<bool>::is_always_lock_free);
+
+    extern "C" void handleSignal(int signal) {
+        if (signal == SIGTERM) {
+            stopRequested.store(true, std::memory_order_relaxed);
+        } else {
+            checkpointRequested.store(true, std::memory_order_relaxed);
+        }
+    }
+}
+
+void installSignalHandlers() {
+    std::signal(SIGTERM, handleSignal);
+#ifdef SIGUSR1
+    std::signal(SIGUSR1, handleSignal);
+#endif
+}
+
+bool isStopRequested() noexcept {
+    return stopRequested.load(std::memory_order_relaxed);
+}
+
+bool takeCheckpointRequest() noexcept {
+    return checkpointRequested.load(std::memory_order_relaxed) &&
+           checkpointRequested.exchange(false, std::memory_order_relaxed);
+}
@@ -1,34 +1,16 @@
+#include <algorithm>
+#include <utility>
 #include "thread_pool.h"
 
-ThreadPool::ThreadPool(size_t numThreads) : stop_(false) {
-    for (size_t i = 0; i < numThreads; i++) {
-        this->workers_.emplace_back(
-            [this]() {
-                while (true) {
-                    std::function<void()> task;
-
-                    {
-                        // Wait for a task to be added to the queue
-                        std::unique_lock<std::mutex> lock(this->queueMutex_);
-                        this->condition_.wait(lock, [this] {
-                            return this->stop_ || !this->tasks_.empty();
-                        });
-
-                        // If already stopped and no more tasks, return
-                        if (this->stop_ && this->tasks_.empty()) {
-                            return;
-                        }
+thread_local ThreadPool* ThreadPool::currentPool_ = nullptr;
+thread_local size_t ThreadPool::currentIndex_ = 0;
 
-                        // Otherwise take the task from the queue
-                        task = std::move(this->tasks_.front());
-                        this->tasks_.pop();
-                    }
-
-                    // Execute the task
-                    task();
-                }
-            }
-        );
+ThreadPool::ThreadPool(size_t numThreads) : queued_(0), sleepers_(0), stop_(false) {
+    for (size_t i = 0; i < numThreads; i++) {
+        this->queues_.push_back(std::make_unique<WorkerQueue>());
+    }
+    for (size_t i = 0; i < numThreads; i++) {
+        this->workers_.emplace_back([this, i]() { this->work(i); });
     }
 }
 
@@ -45,3 +27,196 @@ ThreadPool::~ThreadPool() {
         worker.join();
     }
 }
+
+ThreadPool& ThreadPool::getShared() {
+    static ThreadPool pool(std::max(std::thread::hardware_concurrency(), 1U));
+    return pool;
+}
+
+void ThreadPool::work(size_t index) {
+    currentPool_ = this;
+    currentIndex_ = index;
+
+    while (true) {
+        std::function<void()> task;
+        if (this->takeTask(index, task)) {
+            // Execute the task
+            task();
+            continue;
+        }
+
+        // Wait for a task to be added to any queue
+        std::unique_lock<std::mutex> lock(this->queueMutex_);
+        this->sleepers_.fetch_add(1, std::memory_order_seq_cst);
+        this->condition_.wait(lock, [this] {
+            return this->stop_ || this->queued_.load(std::memory_order_seq_cst) > 0;
+        });
+        this->sleepers_.fetch_sub(1, std::memory_order_relaxed);
+
+        // If already stopped and no more tasks, return
+        if (this->stop_ && this->queued_.load(std::memory_order_acquire) == 0) {
+            return;
+        }
+    }
+}
+
+bool ThreadPool::takeTask(size_t index, std::function<void()>& task) {
+    if (this->queued_.load(std::memory_order_acquire) == 0) {
+        return false;
+    }
+
+    // Own deque, newest first
+    {
+        WorkerQueue& queue = *this->queues_[index];
+        std::unique_lock<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty()) {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+            this->queued_.fetch_sub(1, std::memory_order_acq_rel);
+            return true;
+        }
+    }
+
+    // Shared queue
+    {
+        std::unique_lock<std::mutex> lock(this->queueMutex_);
+        if (!this->tasks_.empty()) {
+            task = std::move(this->tasks_.front());
+            this->tasks_.pop();
+            this->queued_.fetch_sub(1, std::memory_order_acq_rel);
+            return true;
+        }
+    }
+
+    // Steal from the other workers, oldest first
+    for (size_t offset = 1; offset < this->queues_.size(); offset++) {
+        WorkerQueue& victim = *this->queues_[(index + offset) % this->queues_.size()];
+        std::unique_lock<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            this->queued_.fetch_sub(1, std::memory_order_acq_rel);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void ThreadPool::addDetachedTask(std::function<void()> task) {
+    if (currentPool_ == this) {
+        // Called from one of our workers: push to its own deque
+        WorkerQueue& queue = *this->queues_[currentIndex_];
+        std::unique_lock<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(std::move(task));
+        this->queued_.fetch_add(1, std::memory_order_seq_cst);
+    } else {
+        std::unique_lock<std::mutex> lock(this->queueMutex_);
+
+        // Don't allow enqueueing after stopping
+        if (this->stop_) {
+            throw std::runtime_error("addDetachedTask on stopped ThreadPool");
+        }
+
+        this->tasks_.push(std::move(task));
+        this->queued_.fetch_add(1, std::memory_order_seq_cst);
+    }
+
+    // If there are waiting threads, notify one that there is a new task. A worker counts itself as sleeping before it
+    // checks the queued tasks, so either it sees the new task or we see it. Taking the lock first then ensures a worker
+    // that just saw an empty pool is already waiting, so the notification is not lost.
+    if (this->sleepers_.load(std::memory_order_seq_cst) > 0) {
+        { std::unique_lock<std::mutex> lock(this->queueMutex_); }
+        this->condition_.notify_one();
+    }
+}
+
+size_t ThreadPool::getNumThreads() const noexcept {
+    return this->workers_.size();
+}
+
+size_t ThreadPool::getNumQueuedTasks() const noexcept {
+    return this->queued_.load(std::memory_order_relaxed);
+}
+
+TaskGroup::TaskGroup(ThreadPool& pool) : pool_(pool), state_(std::make_shared<State>()) {}
+
+TaskGroup::~TaskGroup() {
+    try {
+        this->wait();
+    } catch (...) {
+        // Nothing left to report the exception to
+    }
+}
+
+bool TaskGroup::State::runNext() {
+    std::function<void()> task;
+    {
+        std::unique_lock<std::mutex> lock(this->mutex);
+        if (this->pending.empty()) {
+            return false;
+        }
+        task = std::move(this->pending.front());
+        this->pending.pop_front();
+        this->running++;
+    }
+
+    // Skip the task entirely if the group is already cancelled
+    std::exception_ptr caught;
+    if (!this->cancelled.load(std::memory_order_acquire)) {
+        try {
+            task();
+        } catch (...) {
+            caught = std::current_exception();
+        }
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(this->mutex);
+        if (caught && !this->exception) {
+            this->exception = caught;
+        }
+        this->running--;
+        if (this->pending.empty() && this->running == 0) {
+            this->finished.notify_all();
+        }
+    }
+    return true;
+}
+
+void TaskGroup::run(std::function<void()> task) {
+    {
+        std::unique_lock<std::mutex> lock(this->state_->mutex);
+        this->state_->pending.push_back(std::move(task));
+    }
+
+    // Each pool task runs whichever task of the group is next, if the waiting thread has not taken it already
+    this->pool_.addDetachedTask([state = this->state_]() {
+        state->runNext();
+    });
+}
+
+void TaskGroup::wait() {
+    // Help with the tasks that have not started yet. Tasks of other groups are left alone: the caller may hold locks or
+    // an epoch guard that must not be kept for the duration of unrelated work
+    while (this->state_->runNext()) {}
+
+    // Then wait for the ones running on other threads
+    std::unique_lock<std::mutex> lock(this->state_->mutex);
+    this->state_->finished.wait(lock, [this] {
+        return this->state_->pending.empty() && this->state_->running == 0;
+    });
+
+    if (this->state_->exception) {
+        std::exception_ptr exception = std::exchange(this->state_->exception, nullptr);
+        std::rethrow_exception(exception);
+    }
+}
+
+void TaskGroup::cancel() noexcept {
+    this->state_->cancelled.store(true, std::memory_order_release);
+}
+
+bool TaskGroup::isCancelled() const noexcept {
+    return this->state_->cancelled.load(std::memory_order_acquire);
+}
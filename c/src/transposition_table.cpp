@@ -0,0 +1,198 @@
+#include <algorithm>
+#include <bit>
+#include "transposition_table.h"
+
+// Layout of the data word of a slot
+static constexpr std::uint64_t WINNER_MASK = 0x3;
+static constexpr int SHAPE_SHIFT = 8;
+static constexpr std::uint64_t SHAPE_MASK = 0xffffffULL << SHAPE_SHIFT;
+static constexpr int WORK_SHIFT = 32;
+static constexpr std::uint64_t MAX_WORK = 0xffffffffULL;
+
+// Helper
+static std::uint64_t encodeWinner(Player winner) {
+    switch (winner) {
+        case Player::PUSHER:
+            return 1;
+        case Player::REMOVER:
+            return 2;
+        default:
+            return 0;
+    }
+}
+
+// Helper
+static Player decodeWinner(std::uint64_t data) {
+    switch (data & WINNER_MASK) {
+        case 1:
+            return Player::PUSHER;
+        case 2:
+            return Player::REMOVER;
+        default:
+            return Player::NONE;
+    }
+}
+
+TranspositionTable::TranspositionTable(size_t megabytes, int goal)
+        : goal_(goal), hits_(0), misses_(0), stores_(0), replacements_(0) {
+
+    // Round down to a power of two so that the bucket index is a mask
+    size_t buckets = megabytes * 1024 * 1024 / (sizeof(Slot) * SLOTS_PER_BUCKET);
+    this->numBuckets_ = buckets ? std::bit_floor(buckets) : 1;
+    this->slots_ = std::make_unique<Slot[]>(this->numBuckets_ * SLOTS_PER_BUCKET);
+    this->clear();
+}
+
+TranspositionTable::Key TranspositionTable::makeKey(const Board& board) const noexcept {
+    Key key{};
+    key.shape = board.getN() << 8 | board.getK();
+    key.valid = true;
+
+    Board canonical = board;
+    canonical.canonicalize();
+
+    // Pack the chips column by column, 16 chips per word
+    size_t n = canonical.getN();
+    size_t k = canonical.getK();
+    for (size_t c = 0; c < n; c++) {
+        ColumnView column = canonical.getColumn(c);
+        for (size_t idx = 0; idx < k; idx++) {
+            int nibble = column[idx] + 1;
+            if (nibble < 0 || nibble > 15) {
+                key.valid = false;
+                return key;
+            }
+            size_t i = c * k + idx;
+            key.words[i / 16] |= (std::uint64_t)nibble << (4 * (i % 16));
+        }
+        key.words[4] |= canonical.getColumnMoved(c) << (c * k);
+    }
+
+    key.hash = hashBoard(canonical, this->goal_);
+    return key;
+}
+
+std::uint64_t TranspositionTable::read(const Slot& slot, const Key& key) const noexcept {
+    // Skip slots that are being written
+    std::uint64_t version = slot.version.load(std::memory_order_acquire);
+    if (version & 1) {
+        return 0;
+    }
+
+    std::uint64_t data = slot.data.load(std::memory_order_relaxed);
+    bool match = slot.hash.load(std::memory_order_relaxed) == key.hash
+                 && ((data & SHAPE_MASK) >> SHAPE_SHIFT) == key.shape;
+    for (size_t i = 0; i < key.words.size(); i++) {
+        match = match && slot.words[i].load(std::memory_order_relaxed) == key.words[i];
+    }
+
+    // Discard the result if a writer touched the slot in the meantime
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.version.load(std::memory_order_relaxed) != version) {
+        return 0;
+    }
+
+    return match ? data : 0;
+}
+
+bool TranspositionTable::write(Slot& slot, const Key& key, std::uint64_t data) noexcept {
+    // Acquire the slot by making the version odd. If another writer holds it, give up.
+    std::uint64_t version = slot.version.load(std::memory_order_relaxed);
+    if ((version & 1) || !slot.version.compare_exchange_strong(version, version + 1, std::memory_order_acquire)) {
+        return false;
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot.hash.store(key.hash, std::memory_order_relaxed);
+    for (size_t i = 0; i < key.words.size(); i++) {
+        slot.words[i].store(key.words[i], std::memory_order_relaxed);
+    }
+    slot.data.store(data, std::memory_order_relaxed);
+
+    // Release the slot
+    slot.version.store(version + 2, std::memory_order_release);
+    return true;
+}
+
+Player TranspositionTable::probe(const Key& key) const noexcept {
+    if (key.valid) {
+        const Slot* bucket = &this->slots_[(key.hash & (this->numBuckets_ - 1)) * SLOTS_PER_BUCKET];
+        for (size_t i = 0; i < SLOTS_PER_BUCKET; i++) {
+            std::uint64_t data = this->read(bucket[i], key);
+            if (data) {
+                this->hits_.fetch_add(1, std::memory_order_relaxed);
+                return decodeWinner(data);
+            }
+        }
+    }
+
+    this->misses_.fetch_add(1, std::memory_order_relaxed);
+    return Player::NONE;
+}
+
+void TranspositionTable::store(const Key& key, Player winner, size_t work) noexcept {
+    if (!key.valid || winner == Player::NONE) {
+        return;
+    }
+
+    std::uint64_t data = encodeWinner(winner)
+                         | key.shape << SHAPE_SHIFT
+                         | std::min((std::uint64_t)work, MAX_WORK) << WORK_SHIFT;
+    Slot* bucket = &this->slots_[(key.hash & (this->numBuckets_ - 1)) * SLOTS_PER_BUCKET];
+
+    // If the position is already stored, there is nothing to do
+    for (size_t i = 0; i < SLOTS_PER_BUCKET; i++) {
+        if (this->read(bucket[i], key)) {
+            return;
+        }
+    }
+
+    // The first slot keeps the most expensive position, the second slot always takes the newest one
+    Slot& preferred = bucket[0];
+    std::uint64_t preferredData = preferred.data.load(std::memory_order_relaxed);
+    Slot& target = (preferredData >> WORK_SHIFT) <= (data >> WORK_SHIFT) ? preferred : bucket[1];
+    bool replacing = target.data.load(std::memory_order_relaxed) != 0;
+
+    if (this->write(target, key, data)) {
+        this->stores_.fetch_add(1, std::memory_order_relaxed);
+        if (replacing) {
+            this->replacements_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+void TranspositionTable::clear() noexcept {
+    for (size_t i = 0; i < this->numBuckets_ * SLOTS_PER_BUCKET; i++) {
+        Slot& slot = this->slots_[i];
+        slot.version.store(0, std::memory_order_relaxed);
+        slot.hash.store(0, std::memory_order_relaxed);
+        for (std::atomic<std::uint64_t>& word : slot.words) {
+            word.store(0, std::memory_order_relaxed);
+        }
+        slot.data.store(0, std::memory_order_relaxed);
+    }
+    this->hits_ = 0;
+    this->misses_ = 0;
+    this->stores_ = 0;
+    this->replacements_ = 0;
+}
+
+size_t TranspositionTable::getCapacity() const noexcept {
+    return this->numBuckets_ * SLOTS_PER_BUCKET;
+}
+
+size_t TranspositionTable::getHits() const noexcept {
+    return this->hits_.load(std::memory_order_relaxed);
+}
+
+size_t TranspositionTable::getMisses() const noexcept {
+    return this->misses_.load(std::memory_order_relaxed);
+}
+
+size_t TranspositionTable::getStores() const noexcept {
+    return this->stores_.load(std::memory_order_relaxed);
+}
+
+size_t TranspositionTable::getReplacements() const noexcept {
+    return this->replacements_.load(std::memory_order_relaxed);
+}
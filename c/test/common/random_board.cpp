@@ -0,0 +1,19 @@
+#include <algorithm>
+#include <functional>
+#include "random_board.h"
+
+namespace test {
+    BoardState randomBoardState(std::mt19937& rng, size_t n, size_t k, int maxRow) {
+        std::uniform_int_distribution<int> rowDist(-1, maxRow);
+        BoardState state(n, ColumnState(k));
+        for (ColumnState& col : state) {
+            for (int& chip : col) chip = rowDist(rng);
+            std::sort(col.begin(), col.end(), std::greater<>());
+        }
+        return state;
+    }
+
+    Board randomBoard(std::mt19937& rng, size_t n, size_t k, int maxRow) {
+        return { n, k, randomBoardState(rng, n, k, maxRow) };
+    }
+}
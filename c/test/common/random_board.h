@@ -0,0 +1,17 @@
+#pragma once
+
+#include <random>
+#include "board.h"
+
+namespace test {
+    /**
+     * @brief Draws a board with sorted columns, each chip uniformly on a row from -1 (removed) to maxRow.
+     * @param rng The random generator.
+     * @param n, k The size of the board.
+     * @param maxRow The highest row a chip can be on.
+     */
+    BoardState randomBoardState(std::mt19937& rng, size_t n, size_t k, int maxRow);
+
+    /// @brief Same as randomBoardState(), as a Board.
+    Board randomBoard(std::mt19937& rng, size_t n, size_t k, int maxRow);
+}
@@ -0,0 +1,231 @@
+#include <fstream>
+#include <random>
+#include <set>
+#include <gtest/gtest.h>
+#include "archive.h"
+#include "compare.h"
+#include "random_board.h"
+
+namespace test::archive {
+    TEST(archive, prune_keeps_only_the_minimal_boards) {
+        // Write random boards with duplicates, so the loaded archive is far from an antichain
+        std::mt19937 rng(9);
+        std::vector<Board> boards;
+        for (int i = 0; i < 600; i++) {
+            boards.push_back(randomBoard(rng, 3, 3, 3));
+            if (i % 5 == 0) boards.push_back(boards.back());
+        }
+        std::filesystem::path filename = std::filesystem::temp_directory_path() / "iml_test_prune.txt";
+        {
+            std::ofstream file(filename);
+            for (const Board& board : boards) file << board.toString() << "---\n";
+        }
+
+        Archive archive;
+        archive.loadWinning(filename);
+        archive.pruneWinningBoards();
+        std::filesystem::remove(filename);
+        std::vector<Board> kept = archive.getWinningBoardsAsVector();
+        EXPECT_EQ(archive.getWinningCount(), kept.size());
+
+        // No kept board is greater than or equal to another
+        for (size_t i = 0; i < kept.size(); i++) {
+            for (size_t j = i + 1; j < kept.size(); j++) {
+                EXPECT_EQ(compareBoards(kept[i], kept[j]), CompResult::INCOMPARABLE);
+            }
+        }
+
+        // Every board is greater than or equal to a kept board
+        for (const Board& board : boards) {
+            bool covered = std::any_of(kept.begin(), kept.end(), [&](const Board& other) {
+                CompResult result = compareBoards(board, other);
+                return result == CompResult::GREATER || result == CompResult::EQUAL;
+            });
+            EXPECT_TRUE(covered);
+        }
+    }
+
+    TEST(archive, binary_file_round_trips) {
+        std::mt19937 rng(15);
+        Archive archive(7, ArchiveFormat::BINARY);
+        for (int i = 0; i < 300; i++) {
+            archive.addWinning(randomBoard(rng, 4, 2, 4));
+        }
+        std::filesystem::path filename = std::filesystem::temp_directory_path() / "iml_test_archive.bin";
+        archive.saveWinning(filename);
+        EXPECT_TRUE(isBinaryArchive(filename));
+
+        // The header groups the boards by number of chips
+        BinaryArchive file = loadBinaryArchive(filename);
+        EXPECT_EQ(file.header.numBoards, archive.getWinningCount());
+        for (size_t c = 0; c <= Board::MAX_CHIPS; c++) {
+            for (size_t i = file.header.bucketOffsets[c]; i < file.header.bucketOffsets[c + 1]; i++) {
+                EXPECT_EQ(file.getBoard(i).getNumChips(), c);
+            }
+        }
+
+        Archive loaded(7);
+        loaded.loadWinning(filename);
+        Archive otherGoal(8);
+        otherGoal.loadWinning(filename);
+        std::filesystem::remove(filename);
+
+        std::vector<Board> expected = archive.getWinningBoardsAsVector();
+        std::vector<Board> actual = loaded.getWinningBoardsAsVector();
+        ASSERT_EQ(actual.size(), expected.size());
+        for (size_t i = 0; i < expected.size(); i++) {
+            EXPECT_EQ(actual[i].toString(), expected[i].toString());
+        }
+        EXPECT_EQ(otherGoal.getWinningCount(), 0);
+    }
+
+    TEST(archive, corrupt_binary_headers_are_rejected) {
+        BinaryArchiveHeader header;
+        header.numBoards = 5;
+        header.bucketOffsets.back() = 5;
+        EXPECT_THROW(header.validate(sizeof(BinaryArchiveHeader)), std::runtime_error);
+
+        // 8 * 2^61 wraps around to 0, which would match a file with no boards
+        header.n = 4;
+        header.k = 2;
+        header.rowSize = 8;
+        header.numBoards = 1ULL << 61;
+        header.bucketOffsets.back() = header.numBoards;
+        EXPECT_THROW(header.validate(sizeof(BinaryArchiveHeader)), std::runtime_error);
+
+        header.numBoards = 2;
+        header.bucketOffsets.back() = 2;
+        EXPECT_NO_THROW(header.validate(sizeof(BinaryArchiveHeader) + 16));
+    }
+
+    TEST(archive, loaded_boards_go_to_the_bucket_of_their_chips) {
+        // A board with 3 chips listed with the boards of 4 chips, which queries of 3 chips would skip
+        Board board(2, 2, BoardState{ { 1, 0 }, { 0, -1 } });
+        BinaryArchive file;
+        file.header.n = 2;
+        file.header.k = 2;
+        file.header.rowSize = 4;
+        file.header.numBoards = 1;
+        for (size_t c = 5; c < file.header.bucketOffsets.size(); c++) {
+            file.header.bucketOffsets[c] = 1;
+        }
+        std::span<const Chip> chips = board.getChips();
+        file.chips.assign(chips.begin(), chips.end());
+
+        Archive archive(5);
+        archive.loadWinning(file);
+        EXPECT_EQ(archive.predictWinner(GameState(board, 5), 1), Player::PUSHER);
+    }
+
+    TEST(archive, text_file_loads_in_pieces) {
+        // Enough boards for the file to be split into several pieces, some with Windows line endings
+        std::mt19937 rng(17);
+        std::vector<Board> boards;
+        std::filesystem::path filename = std::filesystem::temp_directory_path() / "iml_test_archive.txt";
+        {
+            std::ofstream file(filename, std::ios::binary);
+            for (int i = 0; i < 60000; i++) {
+                Board& board = boards.emplace_back(randomBoard(rng, 3, 3, 2));
+                file << board.toString() << (i % 7 == 0 ? "---\r\n" : "---\n");
+            }
+        }
+        ASSERT_GT(std::filesystem::file_size(filename), 2u << 20);
+
+        BinaryArchive file = loadTextArchive(filename);
+        std::filesystem::remove(filename);
+
+        // The boards are grouped by number of chips, in the order of the file within each group
+        std::stable_sort(boards.begin(), boards.end(), [](const Board& a, const Board& b) {
+            return a.getNumChips() < b.getNumChips();
+        });
+        ASSERT_EQ(file.header.numBoards, boards.size());
+        for (size_t i = 0; i < boards.size(); i++) {
+            ASSERT_EQ(file.getBoard(i).toString(), boards[i].toString());
+        }
+        for (size_t c = 0; c <= Board::MAX_CHIPS; c++) {
+            for (size_t i = file.header.bucketOffsets[c]; i < file.header.bucketOffsets[c + 1]; i++) {
+                ASSERT_EQ(file.getBoard(i).getNumChips(), c);
+            }
+        }
+    }
+
+    TEST(archive, writers_replace_files_only_when_closed) {
+        Board board(2, 3, {
+                { 4, 2, -1 },
+                { 3, 3, 0 },
+        });
+        std::filesystem::path filename = std::filesystem::temp_directory_path() / "iml_test_writer.txt";
+        {
+            TextArchiveWriter writer(filename);
+            writer.add(board);
+            writer.close();
+        }
+        EXPECT_FALSE(std::filesystem::exists(getTemporaryFilename(filename)));
+        BinaryArchive file = loadTextArchive(filename);
+        ASSERT_EQ(file.header.numBoards, 1);
+        EXPECT_EQ(file.getBoard(0).toString(), board.toString());
+
+        // A writer that is not closed leaves the previous file as it was
+        {
+            TextArchiveWriter writer(filename);
+            writer.add(board);
+            writer.add(board);
+        }
+        EXPECT_FALSE(std::filesystem::exists(getTemporaryFilename(filename)));
+        EXPECT_EQ(loadTextArchive(filename).header.numBoards, 1);
+        std::filesystem::remove(filename);
+    }
+
+    TEST(archive, merged_files_keep_one_copy_of_each_board) {
+        std::mt19937 rng(23);
+        // Two checkpoints sharing some boards, and one saved for another goal
+        Archive first(7), second(7, ArchiveFormat::BINARY), otherGoal(8, ArchiveFormat::BINARY);
+        for (int i = 0; i < 200; i++) {
+            Board board = randomBoard(rng, 3, 3, 4);
+            if (i % 3 != 0) first.addWinning(board);
+            if (i % 3 != 1) second.addWinning(board);
+            otherGoal.addWinning(randomBoard(rng, 3, 3, 4));
+        }
+        std::filesystem::path directory = std::filesystem::temp_directory_path();
+        std::vector<std::filesystem::path> filenames = {
+                directory / "iml_test_merge_1.txt", directory / "iml_test_merge_2.bin", directory / "iml_test_merge_3.bin",
+                directory / "iml_test_merge_missing.txt" };
+        first.saveWinning(filenames[0]);
+        second.saveWinning(filenames[1]);
+        otherGoal.saveWinning(filenames[2]);
+
+        // Boards that are redundant but not equal are left for pruning
+        std::set<std::string> archived;
+        for (const Archive* archive : { &first, &second }) {
+            for (const Board& board : archive->getWinningBoardsAsVector()) archived.insert(board.toString());
+        }
+        BinaryArchive merged = mergeArchiveFiles(filenames, 7);
+        for (size_t i = 0; i < 3; i++) std::filesystem::remove(filenames[i]);
+        ASSERT_EQ(merged.header.numBoards, archived.size());
+        EXPECT_EQ(merged.header.goal, 7);
+        for (size_t c = 0; c <= Board::MAX_CHIPS; c++) {
+            for (std::uint64_t i = merged.header.bucketOffsets[c]; i < merged.header.bucketOffsets[c + 1]; i++) {
+                Board board = merged.getBoard(i);
+                EXPECT_EQ(board.getNumChips(), c);
+                EXPECT_TRUE(archived.erase(board.toString()));
+            }
+        }
+    }
+
+    TEST(archive, load_archive_file_skips_other_goals_and_failures) {
+        std::mt19937 rng(24);
+        Archive archive(7, ArchiveFormat::BINARY);
+        for (int i = 0; i < 50; i++) {
+            archive.addWinning(randomBoard(rng, 3, 3, 4));
+        }
+        std::filesystem::path filename = std::filesystem::temp_directory_path() / "iml_test_load_goal.bin";
+        archive.saveWinning(filename);
+
+        EXPECT_EQ(loadArchiveFile(filename, 7).header.numBoards, archive.getWinningCount());
+        EXPECT_EQ(loadArchiveFile(filename, BinaryArchiveHeader::UNKNOWN_GOAL).header.numBoards,
+                  archive.getWinningCount());
+        EXPECT_EQ(loadArchiveFile(filename, 8).header.numBoards, 0);
+        std::filesystem::remove(filename);
+        EXPECT_EQ(loadArchiveFile(filename, 7).header.numBoards, 0);
+    }
+}
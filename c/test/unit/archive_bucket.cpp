@@ -0,0 +1,191 @@
+#include <algorithm>
+#include <random>
+#include <thread>
+#include <gtest/gtest.h>
+#include "archive_bucket.h"
+#include "compare.h"
+#include "epoch.h"
+#include "random_board.h"
+
+namespace test::archive_bucket {
+    TEST(archive_bucket, find_visits_every_dominated_entry) {
+        std::mt19937 rng(5);
+        ArchiveBucket bucket;
+        std::vector<std::uint64_t> ids;
+        for (int i = 0; i < 1000; i++) {
+            ids.push_back(bucket.push_back(ArchivedBoard(randomBoard(rng, 3, 3, 4))));
+        }
+
+        // Remove a scattered subset, which leaves tombstones behind
+        size_t removed = 0;
+        for (size_t i = 0; i < ids.size(); i++) {
+            if (i % 7 == 3 || (i > 600 && i < 650)) removed += bucket.remove(ids[i]);
+        }
+        EXPECT_EQ(removed, 185);
+        EXPECT_FALSE(bucket.remove(ids[3]));
+        EXPECT_EQ(bucket.size(), 815);
+
+        EpochManager::Guard guard;
+        ArchiveBucket::Snapshot snapshot = bucket.getSnapshot();
+        for (int trial = 0; trial < 200; trial++) {
+            ArchivedBoard target(randomBoard(rng, 3, 3, 4));
+            for (Dominance dominance : { Dominance::BELOW, Dominance::ABOVE }) {
+                // Collect the visited entries
+                std::vector<const ArchivedBoard*> visited;
+                snapshot.find(target.signature, dominance, [&](const ArchivedBoard& entry) {
+                    visited.push_back(&entry);
+                    return false;
+                });
+
+                // Every entry that is actually below or above the target must have been visited
+                snapshot.forEach([&](const ArchivedBoard& entry) {
+                    CompResult result = compareBoards(entry.board, target.board);
+                    bool dominated = result == CompResult::EQUAL
+                                     || result == (dominance == Dominance::BELOW ? CompResult::LESS
+                                                                                 : CompResult::GREATER);
+                    if (dominated) {
+                        EXPECT_NE(std::find(visited.begin(), visited.end(), &entry), visited.end());
+                    }
+                    return false;
+                });
+            }
+        }
+    }
+
+    TEST(archive_bucket, find_stops_at_first_match) {
+        std::mt19937 rng(6);
+        ArchiveBucket bucket;
+        for (int i = 0; i < 300; i++) {
+            bucket.push_back(ArchivedBoard(randomBoard(rng, 2, 2, 4)));
+        }
+        EpochManager::Guard guard;
+        EXPECT_EQ(bucket.getSnapshot().countSuperBlocks(), 2);
+
+        size_t calls = 0;
+        ArchivedBoard top(Board(2, 2, { { 4, 4 }, { 4, 4 } }));
+        EXPECT_TRUE(bucket.getSnapshot().find(top.signature, Dominance::BELOW, [&](const ArchivedBoard&) {
+            return ++calls == 3;
+        }));
+        EXPECT_EQ(calls, 3);
+
+        bucket.clear();
+        EXPECT_TRUE(bucket.empty());
+        EXPECT_EQ(bucket.getSnapshot().countSuperBlocks(), 0);
+    }
+
+    TEST(archive_bucket, snapshot_survives_compaction) {
+        std::mt19937 rng(7);
+        ArchiveBucket bucket;
+        std::vector<std::uint64_t> ids;
+        for (int i = 0; i < 1000; i++) {
+            ids.push_back(bucket.push_back(ArchivedBoard(randomBoard(rng, 2, 2, 4))));
+        }
+
+        {
+            // Removing most entries compacts the bucket, but the snapshot still sees the old storage
+            EpochManager::Guard guard;
+            ArchiveBucket::Snapshot snapshot = bucket.getSnapshot();
+            for (size_t i = 0; i < 900; i++) {
+                EXPECT_TRUE(bucket.remove(ids[i]));
+            }
+            size_t visited = 0;
+            snapshot.forEach([&](const ArchivedBoard&) { visited++; return false; });
+            EXPECT_GE(visited, 100);
+            EXPECT_EQ(snapshot.getNextId(), 1000);
+        }
+
+        // A new snapshot only sees the live entries, and can start from a given id
+        EpochManager::Guard guard;
+        std::vector<std::uint64_t> visited;
+        bucket.getSnapshot().forEach([&](const ArchivedBoard& entry) {
+            visited.push_back(entry.id);
+            return false;
+        }, 950);
+        EXPECT_EQ(visited.size(), 50);
+        EXPECT_EQ(visited.front(), 950);
+        EXPECT_EQ(bucket.size(), 100);
+        EXPECT_EQ(bucket.push_back(ArchivedBoard(randomBoard(rng, 2, 2, 4))), 1000);
+    }
+
+    TEST(archive_bucket, shared_snapshot_keeps_the_entries_it_saw) {
+        std::mt19937 rng(8);
+        ArchiveBucket bucket;
+        std::vector<std::uint64_t> ids;
+        for (int i = 0; i < 1000; i++) {
+            ids.push_back(bucket.push_back(ArchivedBoard(randomBoard(rng, 2, 2, 4))));
+        }
+        for (size_t i = 0; i < 100; i++) {
+            bucket.remove(ids[i]);
+        }
+
+        // Entries removed later, the compaction and the reclamation of the old storage don't change what it visits
+        ArchiveBucket::SharedSnapshot shared = bucket.getSharedSnapshot();
+        for (size_t i = 100; i < 950; i++) {
+            EXPECT_TRUE(bucket.remove(ids[i]));
+        }
+        bucket.push_back(ArchivedBoard(randomBoard(rng, 2, 2, 4)));
+        EpochManager::getShared().reclaim();
+
+        std::vector<std::uint64_t> visited;
+        shared.forEach([&](const ArchivedBoard& entry) {
+            visited.push_back(entry.id);
+            return false;
+        });
+        ASSERT_EQ(visited.size(), 900);
+        EXPECT_EQ(visited.front(), 100);
+        EXPECT_EQ(visited.back(), 999);
+        EXPECT_EQ(shared.getPublishedSize(), 1000);
+    }
+
+    TEST(archive_bucket, readers_run_alongside_a_writer) {
+        std::mt19937 rng(8);
+        std::vector<ArchivedBoard> boards;
+        for (int i = 0; i < 2000; i++) {
+            boards.emplace_back(randomBoard(rng, 2, 2, 4));
+        }
+
+        // The writer adds every board and removes most of them again, compacting the bucket several times
+        ArchiveBucket bucket;
+        std::atomic<bool> done = false;
+        std::thread writer([&]() {
+            for (size_t i = 0; i < boards.size(); i++) {
+                std::uint64_t id = bucket.push_back(boards[i]);
+                if (i % 4) bucket.remove(id);
+            }
+            done = true;
+        });
+
+        // Readers always see increasing ids and entries that were actually added
+        bool ok = true;
+        while (!done) {
+            EpochManager::Guard guard;
+            std::uint64_t last = 0;
+            bool first = true;
+            bucket.getSnapshot().forEach([&](const ArchivedBoard& entry) {
+                ok &= (first || entry.id > last) && entry.id < boards.size()
+                      && entry.board.toString() == boards[entry.id].board.toString();
+                last = entry.id;
+                first = false;
+                return false;
+            });
+        }
+        writer.join();
+
+        EXPECT_TRUE(ok);
+        EXPECT_EQ(bucket.size(), 500);
+    }
+
+    TEST(epoch, retired_objects_wait_for_readers) {
+        EpochManager& manager = EpochManager::getShared();
+        manager.reclaim();
+        bool deleted = false;
+        {
+            EpochManager::Guard guard;
+            manager.retire([&deleted]() { deleted = true; });
+            manager.reclaim();
+            EXPECT_FALSE(deleted);
+        }
+        manager.reclaim();
+        EXPECT_TRUE(deleted);
+    }
+}
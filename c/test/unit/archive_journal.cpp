@@ -0,0 +1,128 @@
+#include <fstream>
+#include <random>
+#include <thread>
+#include <gtest/gtest.h>
+#include "archive.h"
+#include "archive_journal.h"
+#include "random_board.h"
+
+namespace test::archive_journal {
+    std::vector<std::string> toStrings(const BinaryArchive& boards) {
+        std::vector<std::string> strings;
+        for (size_t i = 0; i < boards.header.numBoards; i++) {
+            strings.push_back(boards.getBoard(i).toString());
+        }
+        return strings;
+    }
+
+    TEST(archive_journal, replay_restores_the_archive) {
+        std::mt19937 rng(20);
+        std::filesystem::path directory = std::filesystem::temp_directory_path() / "iml_test_journal";
+        std::filesystem::remove_all(directory);
+
+        Archive archive(7);
+        ArchiveJournal journal(directory, 4, 2, 7);
+        archive.setJournal(&journal);
+        for (int i = 0; i < 200; i++) {
+            archive.addWinning(randomBoard(rng, 4, 2, 4));
+            archive.addLosing(randomBoard(rng, 4, 2, 4));
+        }
+
+        // Compact: the boards of the first generation are in the base, which the second generation continues
+        std::uint64_t lastGeneration = journal.rotate();
+        BinaryArchive winningBase = archive.getWinningSnapshot().pack();
+        BinaryArchive losingBase = archive.getLosingSnapshot().pack();
+        journal.removeGenerations(lastGeneration);
+        EXPECT_EQ(ArchiveJournal::findGenerations(directory).size(), 1);
+        EXPECT_EQ(journal.countRecords(), 0);
+
+        for (int i = 0; i < 200; i++) {
+            archive.addWinning(randomBoard(rng, 4, 2, 4));
+            archive.addLosing(randomBoard(rng, 4, 2, 4));
+        }
+        journal.flush();
+        EXPECT_GT(journal.countRecords(), 0);
+
+        size_t numRecords = ArchiveJournal::replay(directory, winningBase, losingBase, 7);
+        EXPECT_EQ(numRecords, journal.countRecords());
+        EXPECT_EQ(toStrings(winningBase), toStrings(archive.getWinningSnapshot().pack()));
+        EXPECT_EQ(toStrings(losingBase), toStrings(archive.getLosingSnapshot().pack()));
+
+        // A journal written for another goal is skipped
+        BinaryArchive winning, losing;
+        EXPECT_EQ(ArchiveJournal::replay(directory, winning, losing, 8), 0);
+        EXPECT_EQ(winning.header.numBoards, 0);
+
+        archive.setJournal(nullptr);
+        std::filesystem::remove_all(directory);
+    }
+
+    TEST(archive_journal, concurrent_appends_fill_several_buffers) {
+        std::filesystem::path directory = std::filesystem::temp_directory_path() / "iml_test_journal_threads";
+        std::filesystem::remove_all(directory);
+
+        // About 2 MiB of records, so full buffers are written while the other threads keep appending
+        ArchiveJournal journal(directory, 4, 2, 7);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; t++) {
+            threads.emplace_back([&journal, t]() {
+                std::mt19937 rng(30 + t);
+                for (int i = 0; i < 40000; i++) {
+                    journal.append(ArchiveJournal::RecordType::ADD_WINNING, randomBoard(rng, 4, 2, 4));
+                }
+            });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+        journal.flush();
+        EXPECT_EQ(journal.countRecords(), 160000);
+
+        BinaryArchive winning, losing;
+        EXPECT_EQ(ArchiveJournal::replay(directory, winning, losing, 7), 160000);
+        std::filesystem::remove_all(directory);
+    }
+
+    TEST(archive_journal, replay_stops_at_the_first_invalid_record) {
+        std::mt19937 rng(21);
+        std::filesystem::path directory = std::filesystem::temp_directory_path() / "iml_test_journal_invalid";
+        std::filesystem::remove_all(directory);
+
+        Archive archive(7);
+        std::filesystem::path filename;
+        {
+            ArchiveJournal journal(directory, 4, 2, 7);
+            archive.setJournal(&journal);
+            for (int i = 0; i < 50; i++) {
+                archive.addWinning(randomBoard(rng, 4, 2, 4));
+                archive.addLosing(randomBoard(rng, 4, 2, 4));
+            }
+            archive.setJournal(nullptr);
+            filename = ArchiveJournal::findGenerations(directory).back();
+        }
+        size_t numRecords = (std::filesystem::file_size(filename) - sizeof(ArchiveJournal::Header)) / (1 + 8 + 4);
+
+        // A tail of zeros, as left by a crash after the file grew but before its data was written
+        {
+            std::ofstream file(filename, std::ios::binary | std::ios::app);
+            std::string zeros(3 * (1 + 8 + 4), '\0');
+            file.write(zeros.data(), static_cast<std::streamsize>(zeros.size()));
+        }
+        BinaryArchive winning, losing;
+        EXPECT_EQ(ArchiveJournal::replay(directory, winning, losing, 7), numRecords);
+        EXPECT_EQ(toStrings(winning), toStrings(archive.getWinningSnapshot().pack()));
+        EXPECT_EQ(toStrings(losing), toStrings(archive.getLosingSnapshot().pack()));
+
+        // A corrupt byte in the middle ends the generation at the record holding it
+        {
+            std::fstream file(filename, std::ios::binary | std::ios::in | std::ios::out);
+            file.seekp(static_cast<std::streamoff>(sizeof(ArchiveJournal::Header) + 10 * (1 + 8 + 4) + 3));
+            file.put('\x7f');
+        }
+        winning = {};
+        losing = {};
+        EXPECT_EQ(ArchiveJournal::replay(directory, winning, losing, 7), 10);
+
+        std::filesystem::remove_all(directory);
+    }
+}
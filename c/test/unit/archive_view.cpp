@@ -0,0 +1,73 @@
+#include <fstream>
+#include <random>
+#include <gtest/gtest.h>
+#include "archive.h"
+#include "archive_view.h"
+#include "random_board.h"
+
+namespace test::archive_view {
+    TEST(archive_view, predicts_the_same_as_the_archive) {
+        std::mt19937 rng(16);
+        Archive winning(9, ArchiveFormat::BINARY), losing(9);
+        for (int i = 0; i < 400; i++) {
+            winning.addWinning(randomBoard(rng, 4, 3, 4));
+            losing.addLosing(randomBoard(rng, 4, 3, 4));
+        }
+        std::filesystem::path winningFilename = std::filesystem::temp_directory_path() / "iml_test_view_winning.bin";
+        std::filesystem::path losingFilename = std::filesystem::temp_directory_path() / "iml_test_view_losing.txt";
+        winning.saveWinning(winningFilename);
+        losing.saveLosing(losingFilename);
+
+        {
+            ArchiveView winningView(winningFilename, Player::PUSHER, 9);
+            ArchiveView losingView(losingFilename, Player::REMOVER, 9);
+            EXPECT_EQ(winningView.size(), winning.getWinningCount());
+            EXPECT_EQ(losingView.size(), losing.getLosingCount());
+
+            // The rows are the saved boards, in the same order
+            std::vector<Board> boards = winning.getWinningBoardsAsVector();
+            for (size_t i = 0; i < boards.size(); i++) {
+                EXPECT_EQ(winningView.getBoard(i).toString(), boards[i].toString());
+            }
+
+            for (int i = 0; i < 500; i++) {
+                GameState state(randomBoard(rng, 4, 3, 4), 9);
+                for (size_t threads : { 1, 4 }) {
+                    EXPECT_EQ(winningView.predictWinner(state, threads), winning.predictWinner(state, threads));
+                    EXPECT_EQ(losingView.predictWinner(state, threads), losing.predictWinner(state, threads));
+                }
+            }
+
+            // A file saved for another goal is not used
+            ArchiveView otherGoal(winningFilename, Player::PUSHER, 8);
+            EXPECT_EQ(otherGoal.size(), 0);
+        }
+        std::filesystem::remove(winningFilename);
+        std::filesystem::remove(losingFilename);
+    }
+
+    TEST(archive_view, rejects_rows_in_the_wrong_bucket) {
+        // A board with 12 chips listed with the boards of 11 chips
+        BinaryArchiveHeader header;
+        header.n = 4;
+        header.k = 3;
+        header.rowSize = 12;
+        header.numBoards = 1;
+        header.goal = 9;
+        for (size_t c = 12; c < header.bucketOffsets.size(); c++) {
+            header.bucketOffsets[c] = 1;
+        }
+        std::array<Chip, 12> row{};
+        std::filesystem::path filename = std::filesystem::temp_directory_path() / "iml_test_view_misplaced.bin";
+        {
+            std::ofstream file(filename, std::ios::binary);
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            file.write(reinterpret_cast<const char*>(row.data()), row.size());
+        }
+
+        ArchiveView view(filename, Player::PUSHER, 9);
+        EXPECT_EQ(view.size(), 0);
+        EXPECT_EQ(view.predictWinner(GameState(Board(4, 3), 9)), Player::NONE);
+        std::filesystem::remove(filename);
+    }
+}
@@ -0,0 +1,147 @@
+#include <algorithm>
+#include <random>
+#include <gtest/gtest.h>
+#include "board.h"
+#include "hash.h"
+#include "random_board.h"
+
+namespace test::board {
+    TEST(board, apply_pusher_and_remover_moves) {
+        Board board(3, 3, {
+                { 2, 1, 0 },
+                { 2, 1, -1 },
+                { 0, 0, 0 },
+        });
+        EXPECT_EQ(board.getNumChips(), 8);
+        EXPECT_EQ(board.calcCurrentPlayer(), Player::PUSHER);
+
+        // Push the 2nd chip of column 0 and the 3rd chip of column 2
+        EXPECT_TRUE(board.apply(PusherMove{ 1, 8 }));
+        EXPECT_EQ(board.calcCurrentPlayer(), Player::REMOVER);
+        EXPECT_EQ(board.getBoardState(), BoardState({ { 2, 2, 0 }, { 2, 1, -1 }, { 1, 0, 0 } }));
+
+        // Among chips on the same row, the moved chip is sorted first
+        EXPECT_TRUE(board.chipIsMoved(0, 0));
+        EXPECT_FALSE(board.chipIsMoved(0, 1));
+        EXPECT_TRUE(board.chipIsMoved(2, 0));
+
+        // Remove column 0: only the moved chip is removed, and all moved flags are cleared
+        EXPECT_TRUE(board.apply(RemoverMove{ 0 }));
+        EXPECT_EQ(board.calcCurrentPlayer(), Player::PUSHER);
+        EXPECT_EQ(board.getNumChips(), 7);
+        EXPECT_EQ(board.getBoardState(), BoardState({ { 2, 0, -1 }, { 2, 1, -1 }, { 1, 0, 0 } }));
+        EXPECT_FALSE(board.chipIsMoved(2, 0));
+
+        // Removing a column without moved chips is invalid
+        EXPECT_FALSE(board.apply(RemoverMove{ 1 }));
+    }
+
+    TEST(board, apply_keeps_columns_sorted) {
+        std::mt19937 rng(7);
+        for (size_t k = 1; k <= 5; k++) {
+            for (int trial = 0; trial < 200; trial++) {
+                // Random sorted board
+                size_t n = 4;
+                BoardState state = randomBoardState(rng, n, k, 5);
+                Board board(n, k, state);
+
+                // Random Pusher move
+                PusherMove move;
+                for (size_t i = 0; i < n * k; i++) {
+                    if (rng() % 3 == 0) move.push_back(i);
+                }
+                board.apply(move);
+
+                // Reference: push and fully sort every column by (row, moved)
+                for (size_t c = 0; c < n; c++) {
+                    std::vector<std::pair<int, bool>> expected;
+                    for (size_t idx = 0; idx < k; idx++) {
+                        bool pushed = std::find(move.begin(), move.end(), c * k + idx) != move.end();
+                        bool movable = pushed && state[c][idx] != -1;
+                        expected.emplace_back(state[c][idx] + (movable ? 1 : 0), movable);
+                    }
+                    std::sort(expected.begin(), expected.end(), std::greater<>());
+                    for (size_t idx = 0; idx < k; idx++) {
+                        EXPECT_EQ(board.getChipRow(c, idx), expected[idx].first);
+                        EXPECT_EQ(board.chipIsMoved(c, idx), expected[idx].second);
+                    }
+                }
+            }
+        }
+    }
+
+    TEST(board, undo_pusher_move) {
+        Board board(2, 2, {
+                { 1, 0 },
+                { 0, -1 },
+        });
+        Board original = board;
+
+        EXPECT_TRUE(board.apply(PusherMove{ 0, 2 }));
+        EXPECT_EQ(board.getBoardState(), BoardState({ { 2, 0 }, { 1, -1 } }));
+
+        board.undoPusherMove();
+        EXPECT_EQ(board.calcCurrentPlayer(), Player::PUSHER);
+        EXPECT_EQ(board.getBoardState(), original.getBoardState());
+        EXPECT_EQ(board.getNumChips(), original.getNumChips());
+    }
+
+    TEST(board, to_string_round_trip) {
+        Board board(2, 3, {
+                { 4, 2, -1 },
+                { 3, 3, 0 },
+        });
+        Board parsed(board.toString());
+        EXPECT_EQ(parsed.getN(), 2);
+        EXPECT_EQ(parsed.getK(), 3);
+        EXPECT_EQ(parsed.getNumChips(), 5);
+        EXPECT_EQ(parsed.getBoardState(), board.getBoardState());
+
+        EXPECT_THROW(Board(9, 9), std::invalid_argument);
+        EXPECT_THROW(Board("n=2,k=3,n_chips=5\n4 2 -1\n3 3\n"), std::invalid_argument);
+        EXPECT_THROW(Board("n=2,k=x,n_chips=5\n"), std::invalid_argument);
+        EXPECT_THROW(Board("n=1,k=2,n_chips=2\n128 0\n"), std::invalid_argument);
+        EXPECT_THROW(Board(1, 2, BoardState{ { 200, 0 } }), std::invalid_argument);
+        EXPECT_EQ(Board("n=1,k=2,n_chips=2\n127 0\n").getBoardState()[0][0], 127);
+    }
+
+    TEST(board, canonicalize_and_hash) {
+        Board board1(3, 2, {
+                { 3, 1 },
+                { 2, 2 },
+                { 3, -1 },
+        });
+        Board board2(3, 2, {
+                { 2, 2 },
+                { 3, -1 },
+                { 3, 1 },
+        });
+        Board board3(3, 2, {
+                { 3, 2 },
+                { 2, 1 },
+                { 3, -1 },
+        });
+
+        // Column permutations have the same hash and canonical form
+        EXPECT_FALSE(board1 == board2);
+        EXPECT_EQ(hashBoard(board1, 5), hashBoard(board2, 5));
+        EXPECT_NE(hashBoard(board1, 5), hashBoard(board3, 5));
+        board1.canonicalize();
+        board2.canonicalize();
+        EXPECT_TRUE(board1 == board2);
+        EXPECT_EQ(board1.getBoardState(), BoardState({ { 3, 1 }, { 3, -1 }, { 2, 2 } }));
+
+        // Moved flags are part of the identity and follow their columns
+        Board moved1 = board2;
+        Board moved2 = board2;
+        moved1.apply(PusherMove{ 0 });
+        moved2.apply(PusherMove{ 4 });
+        EXPECT_NE(hashBoard(moved1, 5), hashBoard(moved2, 5));
+        Board permuted(3, 2, { { 2, 2 }, { 3, 1 }, { 3, -1 } });
+        permuted.apply(PusherMove{ 2 });
+        EXPECT_EQ(hashBoard(permuted, 5), hashBoard(moved1, 5));
+        permuted.canonicalize();
+        moved1.canonicalize();
+        EXPECT_TRUE(permuted == moved1);
+    }
+}
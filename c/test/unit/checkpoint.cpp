@@ -0,0 +1,51 @@
+#include <atomic>
+#include <csignal>
+#include <random>
+#include <gtest/gtest.h>
+#include "archive.h"
+#include "checkpoint.h"
+#include "random_board.h"
+#include "signals.h"
+
+namespace test::checkpoint {
+    TEST(checkpoint, snapshot_is_saved_in_the_background) {
+        std::mt19937 rng(19);
+        Archive archive(7, ArchiveFormat::BINARY);
+        for (int i = 0; i < 300; i++) {
+            archive.addWinning(randomBoard(rng, 4, 2, 4));
+        }
+        std::filesystem::path filename = std::filesystem::temp_directory_path() / "iml_test_checkpoint.bin";
+
+        // Boards added after the snapshot are not in the checkpoint
+        std::atomic<bool> done = false;
+        CheckpointWriter writer;
+        writer.write("test", [snapshot = archive.getWinningSnapshot(), filename, &done]() {
+            saveArchiveFile(snapshot.pack(), filename, ArchiveFormat::BINARY);
+            done = true;
+        });
+        std::vector<Board> expected = archive.getWinningBoardsAsVector();
+        archive.addWinning(Board(4, 2, BoardState(4, ColumnState(2, -1))));
+        writer.wait();
+        EXPECT_TRUE(done);
+
+        Archive loaded(7);
+        loaded.loadWinning(filename);
+        std::filesystem::remove(filename);
+        std::vector<Board> actual = loaded.getWinningBoardsAsVector();
+        ASSERT_EQ(actual.size(), expected.size());
+        for (size_t i = 0; i < expected.size(); i++) {
+            EXPECT_EQ(actual[i].toString(), expected[i].toString());
+        }
+    }
+
+    TEST(checkpoint, sigusr1_requests_one_checkpoint) {
+#ifdef SIGUSR1
+        installSignalHandlers();
+        EXPECT_FALSE(takeCheckpointRequest());
+        std::raise(SIGUSR1);
+        EXPECT_TRUE(takeCheckpointRequest());
+        EXPECT_FALSE(takeCheckpointRequest());
+        EXPECT_FALSE(isStopRequested());
+#endif
+    }
+}
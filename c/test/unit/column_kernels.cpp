@@ -0,0 +1,52 @@
+#include <random>
+#include <gtest/gtest.h>
+#include "column_kernels.h"
+
+namespace test::column_kernels {
+    TEST(column_kernels, specialized_kernels_match_generic) {
+        const ColumnKernels& generic = getColumnKernels(0);
+        EXPECT_EQ(generic.k, 0);
+
+        std::mt19937 rng(42);
+        std::uniform_int_distribution<int> rowDist(-1, 6);
+        for (size_t k = 2; k <= 4; k++) {
+            const ColumnKernels& kernels = getColumnKernels(k);
+            EXPECT_EQ(kernels.k, k);
+
+            for (int trial = 0; trial < 1000; trial++) {
+                std::array<Chip, 4> col1{}, col2{}, sorted1{}, sorted2{};
+                for (size_t i = 0; i < k; i++) {
+                    col1[i] = static_cast<Chip>(rowDist(rng));
+                    col2[i] = static_cast<Chip>(rowDist(rng));
+                }
+                std::uint64_t moved = rng() & ((1ULL << k) - 1);
+
+                // Sort
+                sorted1 = col1;
+                sorted2 = col1;
+                std::uint64_t moved1 = moved, moved2 = moved;
+                kernels.sort(sorted1.data(), moved1, k);
+                generic.sort(sorted2.data(), moved2, k);
+                EXPECT_EQ(sorted1, sorted2);
+                EXPECT_EQ(moved1, moved2);
+
+                // Compare and encode
+                EXPECT_EQ(kernels.compare(col1.data(), col2.data(), k), generic.compare(col1.data(), col2.data(), k));
+                EXPECT_EQ(kernels.encode(col1.data(), k, 7), generic.encode(col1.data(), k, 7));
+            }
+        }
+    }
+
+    TEST(column_kernels, dispatch_on_k) {
+        for (size_t k = 0; k <= 6; k++) {
+            size_t selected = dispatchOnK(k, []<size_t K>() { return K; });
+            EXPECT_EQ(selected, getColumnKernels(k).k);
+        }
+    }
+
+    TEST(column_kernels, encode_matches_column_state) {
+        ColumnState column = { 5, 3, 2, 2, -1, -1 };
+        std::vector<Chip> chips(column.begin(), column.end());
+        EXPECT_EQ(encodeColState(ColumnView(chips), 9), encodeColState(column, 9));
+    }
+}
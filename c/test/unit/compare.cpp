@@ -1,8 +1,11 @@
+#include <algorithm>
+#include <random>
 #include <string>
 #include <vector>
 #include <unordered_map>
 #include <gtest/gtest.h>
 #include "compare.h"
+#include "random_board.h"
 
 namespace test::compare {
 
@@ -69,4 +72,48 @@ namespace test::compare {
         });
         EXPECT_EQ(CompResult::INCOMPARABLE, compareBoards(board1, board2));
     }
-}
\ No newline at end of file
+
+    TEST(compare, compareBoards_with_signatures) {
+        std::mt19937 rng(11);
+        resetCompareStats();
+        size_t calls = 0;
+        for (size_t n = 1; n <= 5; n++) {
+            for (size_t k = 1; k <= 4; k++) {
+                for (int trial = 0; trial < 300; trial++) {
+                    // Random boards with sorted columns, close enough to each other to be comparable sometimes
+                    BoardState state1 = randomBoardState(rng, n, k, 4), state2 = state1;
+                    for (ColumnState& col : state2) {
+                        for (int& chip : col) chip = std::min(4, std::max(-1, chip + (int)(rng() % 3) - 1));
+                        std::sort(col.begin(), col.end(), std::greater<>());
+                    }
+                    std::shuffle(state2.begin(), state2.end(), rng);
+
+                    Board board1(n, k, state1), board2(n, k, state2);
+                    BoardSignature signature1(board1), signature2(board2);
+                    for (Purpose purpose : { Purpose::LESS, Purpose::GREATER, Purpose::BOTH }) {
+                        EXPECT_EQ(compareBoards(board1, signature1, board2, signature2, purpose),
+                                  compareBoards(board1, board2, purpose));
+                        calls++;
+                    }
+                }
+            }
+        }
+
+        // Boards of different sizes end the comparison before any filter
+        Board small(1, 1, BoardState{ { 0 } }), large(2, 1, BoardState{ { 0 }, { 0 } });
+        EXPECT_EQ(compareBoards(small, BoardSignature(small), large, BoardSignature(large)), CompResult::INCOMPARABLE);
+        EXPECT_EQ(compareBoards(small, large), CompResult::INCOMPARABLE);
+
+        // Every call of both overloads is counted, and every call with signatures is settled by exactly one stage
+        CompareStats stats = getCompareStats();
+        EXPECT_EQ(stats.calls, 2 * calls + 2);
+        EXPECT_EQ(stats.withoutSignatures, calls + 1);
+        EXPECT_EQ(stats.bySize, 1);
+        EXPECT_EQ(stats.byChipCount + stats.byHistogram + stats.byRanks + stats.byColumnCodes + stats.matched, calls);
+        EXPECT_GT(stats.byHistogram, 0);
+        EXPECT_GT(stats.matched, 0);
+
+        // One call in every 64 of this thread is timed
+        EXPECT_NEAR((double)stats.timedCalls, (double)stats.calls / 64, 1.0);
+    }
+}
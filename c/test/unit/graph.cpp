@@ -1,3 +1,6 @@
+#include <algorithm>
+#include <functional>
+#include <random>
 #include <string>
 #include <vector>
 #include <unordered_map>
@@ -147,4 +150,127 @@ namespace test::graph {
         });
         EXPECT_EQ(hopcroftKarp(graph, partition), 3);
     }
+
+    TEST(graph, has_perfect_matching) {
+        std::mt19937 rng(1);
+        for (size_t n = 1; n <= 8; n++) {
+            for (int trial = 0; trial < 200; trial++) {
+                // Random bipartite graph with varying density
+                BitMatrix adjacency{};
+                std::vector<std::string> part1, part2, vertices;
+                std::vector<std::pair<std::string, std::string>> edges;
+                std::unordered_map<std::string, int> partition;
+                unsigned density = 1 + rng() % 4;
+                for (size_t i = 0; i < n; i++) {
+                    part1.push_back("A" + std::to_string(i));
+                    part2.push_back("B" + std::to_string(i));
+                }
+                for (size_t i = 0; i < n; i++) {
+                    for (size_t j = 0; j < n; j++) {
+                        if (rng() % 5 < density) {
+                            adjacency[i] |= 1ULL << j;
+                            edges.emplace_back(part1[i], part2[j]);
+                        }
+                    }
+                }
+
+                Graph graph;
+                construct(part1, part2, vertices, partition);
+                populate_graph(graph, vertices, edges);
+                EXPECT_EQ(hasPerfectMatching(adjacency, n), hopcroftKarp(graph, partition) == n);
+            }
+        }
+
+        // 64x64 identity with one extra layer of shifted edges
+        BitMatrix adjacency{};
+        for (size_t i = 0; i < 64; i++) {
+            adjacency[i] = (1ULL << i) | (1ULL << ((i + 1) % 64));
+        }
+        EXPECT_TRUE(hasPerfectMatching(adjacency, 64));
+        adjacency[5] = adjacency[6] = 1ULL << 6;
+        EXPECT_FALSE(hasPerfectMatching(adjacency, 64));
+    }
+
+    TEST(graph, csr_graph) {
+        CsrGraph empty;
+        EXPECT_EQ(empty.countV(), 0);
+        EXPECT_EQ(empty.countE(), 0);
+        EXPECT_TRUE(empty.getNeighbors(0).empty());
+
+        // Duplicates and out of range edges are dropped, and neighbors come out sorted
+        CsrGraph graph(4, { { 0, 3 }, { 0, 1 }, { 2, 1 }, { 0, 3 }, { 1, 7 } });
+        EXPECT_EQ(graph.countV(), 4);
+        EXPECT_EQ(graph.countE(), 3);
+        EXPECT_TRUE(graph.hasEdge(0, 1));
+        EXPECT_TRUE(graph.hasEdge(0, 3));
+        EXPECT_FALSE(graph.hasEdge(1, 0));
+        EXPECT_FALSE(graph.hasEdge(9, 0));
+        std::vector<CsrGraph::Vertex> neighbors(graph.getNeighbors(0).begin(), graph.getNeighbors(0).end());
+        EXPECT_EQ(neighbors, std::vector<CsrGraph::Vertex>({ 1, 3 }));
+        EXPECT_TRUE(graph.getNeighbors(3).empty());
+    }
+
+    TEST(graph, hopcroft_karp_csr) {
+        std::mt19937 rng(3);
+        HopcroftKarpScratch scratch;
+        for (int trial = 0; trial < 500; trial++) {
+            // Random unbalanced bipartite graph: vertices [0, n1) in the first partition, the rest in the second
+            size_t n1 = 1 + rng() % 10, n2 = 1 + rng() % 10;
+            unsigned density = 1 + rng() % 4;
+            std::vector<std::uint8_t> partition(n1 + n2, 0);
+            std::fill(partition.begin() + (long)n1, partition.end(), 1);
+
+            std::vector<std::pair<CsrGraph::Vertex, CsrGraph::Vertex>> edges;
+            Graph labeled;
+            std::unordered_map<std::string, int> labeledPartition;
+            for (size_t i = 0; i < n1 + n2; i++) {
+                labeled.addVertex(std::to_string(i));
+                labeledPartition[std::to_string(i)] = partition[i];
+            }
+            for (size_t i = 0; i < n1; i++) {
+                for (size_t j = n1; j < n1 + n2; j++) {
+                    if (rng() % 8 < density) {
+                        edges.emplace_back(i, j);
+                        labeled.addEdge(std::to_string(i), std::to_string(j));
+                        labeled.addEdge(std::to_string(j), std::to_string(i));
+                    }
+                }
+            }
+
+            // Reference: simple augmenting path search (Kuhn's algorithm)
+            std::vector<int> owner(n1 + n2, -1);
+            std::vector<bool> visited;
+            std::function<bool(size_t)> tryKuhn = [&](size_t u) {
+                for (const auto& [a, b] : edges) {
+                    if (a != u || visited[b]) continue;
+                    visited[b] = true;
+                    if (owner[b] == -1 || tryKuhn((size_t)owner[b])) {
+                        owner[b] = (int)u;
+                        return true;
+                    }
+                }
+                return false;
+            };
+            size_t expected = 0;
+            for (size_t i = 0; i < n1; i++) {
+                visited.assign(n1 + n2, false);
+                if (tryKuhn(i)) expected++;
+            }
+
+            size_t count = hopcroftKarp(CsrGraph(n1 + n2, edges), partition, scratch);
+            EXPECT_EQ(count, expected);
+            EXPECT_EQ(hopcroftKarp(labeled, labeledPartition), expected);
+
+            // The matching is symmetric, uses real edges, and has the reported size
+            size_t matched = 0;
+            for (size_t i = 0; i < n1; i++) {
+                CsrGraph::Vertex j = scratch.match[i];
+                if (j == HopcroftKarpScratch::NIL) continue;
+                matched++;
+                EXPECT_EQ(scratch.match[j], i);
+                EXPECT_NE(std::find(edges.begin(), edges.end(), std::make_pair((CsrGraph::Vertex)i, j)), edges.end());
+            }
+            EXPECT_EQ(matched, count);
+        }
+    }
 }
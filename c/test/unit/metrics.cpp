@@ -0,0 +1,47 @@
+#include <fstream>
+#include <gtest/gtest.h>
+#include "json.hpp"
+#include "metrics.h"
+#include "minimax.h"
+
+namespace test::metrics {
+    TEST(metrics, search_metrics_add_up) {
+        GameState state(Board(3, 3), 5);
+        Archive archive;
+        TranspositionTable table(1, 5);
+        size_t count = 0;
+        ::minimax(state, archive, table, 0, 1, 1, count);
+
+        // The search saves its metrics when it ends
+        std::filesystem::path filename = getMetricsFilename(3, 3, 5);
+        ASSERT_TRUE(std::filesystem::exists(filename));
+        nlohmann::json json = nlohmann::json::parse(std::ifstream(filename));
+        std::filesystem::remove(filename);
+        std::filesystem::remove(filename.parent_path());
+
+        EXPECT_EQ(json["nodes"], count);
+        size_t nodes = 0, children = 0;
+        for (const nlohmann::json& depth : json["depths"]) {
+            nodes += depth["nodes"].get<size_t>();
+            children += depth["children"].get<size_t>();
+        }
+        EXPECT_EQ(nodes, count);
+        // Every child generated is visited, unless a sibling already won
+        EXPECT_LE(nodes, children + 1);
+
+        // Every query counted in a bucket is either a hit or a miss
+        const nlohmann::json& queries = json["predict-winner"];
+        size_t calls = 0;
+        for (const nlohmann::json& bucket : queries["buckets"]) {
+            EXPECT_EQ(bucket["calls"], bucket["hits"].get<size_t>() + bucket["misses"].get<size_t>());
+            calls += bucket["calls"].get<size_t>();
+        }
+        EXPECT_EQ(queries["calls"], calls);
+        EXPECT_GT(calls, 0);
+
+        // The boards kept are the ones inserted and not removed since
+        const nlohmann::json& stats = json["archive"];
+        EXPECT_EQ(stats["winning"].get<size_t>() + stats["losing"].get<size_t>(),
+                  stats["inserted"].get<size_t>() - stats["replaced"].get<size_t>());
+    }
+}
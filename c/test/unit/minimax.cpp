@@ -0,0 +1,84 @@
+#include <atomic>
+#include <fstream>
+#include <thread>
+#include <gtest/gtest.h>
+#include "epoch.h"
+#include "metrics.h"
+#include "minimax.h"
+
+namespace test::minimax {
+    TEST(minimax, parallel_search_finds_the_same_winner) {
+        // Goal 3 is reachable on this board, goal 5 is not
+        for (int goal : { 3, 5 }) {
+            GameState state(Board(3, 3), goal);
+
+            Archive sequentialArchive;
+            TranspositionTable sequentialTable(1, goal);
+            size_t sequentialCount = 0;
+            Player expected = ::minimax(state, sequentialArchive, sequentialTable, 0, 1, 1, sequentialCount);
+
+            Archive parallelArchive;
+            TranspositionTable parallelTable(1, goal);
+            size_t parallelCount = 0;
+            EXPECT_EQ(::minimax(state, parallelArchive, parallelTable, 0, 1, 4, parallelCount), expected);
+            EXPECT_GT(parallelCount, 0);
+
+            // Every board archived by the parallel search is solved correctly
+            for (const Board& board : parallelArchive.getWinningBoardsAsVector()) {
+                Archive archive;
+                TranspositionTable table(1, goal);
+                size_t count = 0;
+                EXPECT_EQ(::minimax(GameState(board, goal), archive, table, 0, 1, 1, count), Player::PUSHER);
+            }
+            std::filesystem::remove(getMetricsFilename(3, 3, goal));
+        }
+        std::filesystem::remove(getMetricsFilename(3, 3, 3).parent_path());
+    }
+
+    TEST(minimax, parallel_search_keeps_retired_bounds_bounded) {
+        // Archive queries run inside an epoch guard, so a query that ran unrelated tasks while waiting would keep every
+        // bounds retired in the meantime alive. Sample the retired count while searching on several threads.
+        int goal = 5;
+        GameState state(Board(4, 3), goal);
+        std::atomic<bool> done = false;
+        std::atomic<size_t> maxRetired = 0;
+        std::thread sampler([&]() {
+            while (!done) {
+                size_t retired = EpochManager::getShared().getNumRetired();
+                if (retired > maxRetired) maxRetired = retired;
+                std::this_thread::yield();
+            }
+        });
+
+        Archive archive;
+        TranspositionTable table(1, goal);
+        size_t count = 0;
+        ::minimax(state, archive, table, 0, 4, 4, count);
+        done = true;
+        sampler.join();
+        EXPECT_GT(count, 0);
+        EXPECT_LT(maxRetired, 512);
+        std::filesystem::remove(getMetricsFilename(4, 3, goal));
+        std::filesystem::remove(getMetricsFilename(4, 3, goal).parent_path());
+    }
+
+    TEST(minimax, checkpoints_are_found_oldest_first) {
+        std::filesystem::path directory = std::filesystem::temp_directory_path() / "iml_test_checkpoints";
+        std::filesystem::remove_all(directory);
+        std::filesystem::create_directories(directory);
+        for (const char* name : {
+                "N4_K2_goal7_board_2026-02-01_00-00.bin", "N4_K2_goal7_board_2026-01-01_00-00.txt",
+                "N4_K2_goal7_board_2026-03-01_00-00.txt.tmp", "N4_K2_goal7_board_base.bin",
+                "N4_K2_goal8_board_2026-01-01_00-00.txt", "N14_K2_goal7_board_2026-01-01_00-00.txt",
+                "N4_K2_goal7_board.txt" }) {
+            std::ofstream(directory / name) << "---\n";
+        }
+
+        std::vector<std::filesystem::path> checkpoints = findCheckpoints(directory, 4, 2, 7);
+        ASSERT_EQ(checkpoints.size(), 2);
+        EXPECT_EQ(checkpoints[0].filename(), "N4_K2_goal7_board_2026-01-01_00-00.txt");
+        EXPECT_EQ(checkpoints[1].filename(), "N4_K2_goal7_board_2026-02-01_00-00.bin");
+        EXPECT_TRUE(findCheckpoints(directory / "missing", 4, 2, 7).empty());
+        std::filesystem::remove_all(directory);
+    }
+}
@@ -0,0 +1,65 @@
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+#include "progress.h"
+
+namespace test::progress {
+    TEST(progress, counters_add_up_across_threads) {
+        ProgressCounters counters;
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < 4; t++) {
+            threads.emplace_back([&counters, t]() {
+                for (size_t i = 0; i < 1000; i++) {
+                    counters.enter(t, i + 1, 1000);
+                    counters.countArchiveQuery(i % 4 == 0);
+                }
+            });
+        }
+        for (std::thread& thread : threads) thread.join();
+
+        EXPECT_EQ(counters.getNodes(), 4000);
+        EXPECT_EQ(counters.getNodes(2), 1000);
+        EXPECT_EQ(counters.getPosition(3), std::make_pair((size_t)1000, (size_t)1000));
+        EXPECT_EQ(counters.getArchiveQueries(), 4000);
+        EXPECT_EQ(counters.getArchiveHits(), 1000);
+
+        // Deeper states are counted with the deepest depth
+        counters.enter(ProgressCounters::MAX_DEPTH + 5, 1, 1);
+        EXPECT_EQ(counters.getNodes(ProgressCounters::MAX_DEPTH), 1);
+        EXPECT_EQ(counters.getDepth(), ProgressCounters::MAX_DEPTH);
+    }
+
+    TEST(progress, files_get_plain_lines) {
+        FILE* out = std::tmpfile();
+        ASSERT_NE(out, nullptr);
+        ProgressCounters counters;
+        counters.enter(0, 1, 1);
+        counters.enter(1, 2, 3);
+        counters.countArchiveQuery(true);
+        {
+            ProgressReporter reporter(counters, out, std::chrono::milliseconds(5));
+            EXPECT_FALSE(reporter.isTerminal());
+            std::this_thread::sleep_for(std::chrono::milliseconds(30));
+        }
+
+        std::rewind(out);
+        std::string text;
+        char buffer[256];
+        while (std::fgets(buffer, sizeof(buffer), out)) text += buffer;
+        std::fclose(out);
+
+        // At least the last report, which always shows the final counts
+        EXPECT_NE(text.find("2 states"), std::string::npos);
+        EXPECT_NE(text.find("archive hit rate 100.0%, path 1/1 2/3\n"), std::string::npos);
+        EXPECT_EQ(text.find('\033'), std::string::npos);
+    }
+
+    TEST(progress, messages_are_formatted_to_stderr) {
+        testing::internal::CaptureStderr();
+        ProgressReporter::printMessage("Wrote checkpoint %s in %.2f seconds\n", "N4_K3", 1.5);
+        ProgressReporter::printMessage("No arguments\n");
+        EXPECT_EQ(testing::internal::GetCapturedStderr(), "Wrote checkpoint N4_K3 in 1.50 seconds\nNo arguments\n");
+    }
+}
@@ -0,0 +1,36 @@
+#include <gtest/gtest.h>
+#include "search_path.h"
+
+namespace test::search_path {
+    TEST(search_path, save_and_load_round_trip) {
+        SearchPath path;
+        path.n = 2;
+        path.k = 3;
+        path.goal = 5;
+        path.count = 1234;
+        path.winningFilename = "winning/temp/N2_K3_goal5_board_2026-01-01_00-00.txt";
+        path.frames.push_back({ 2, 3, Board(2, 3, { { 4, 2, -1 }, { 3, 3, 0 } }) });
+        path.frames.push_back({ 1, 1, Board(2, 3, { { 4, 2, -1 }, { 3, 0, -1 } }) });
+
+        std::filesystem::path filename = std::filesystem::temp_directory_path() / "iml_test_search_path.json";
+        saveSearchPath(path, filename);
+        std::optional<SearchPath> loaded = loadSearchPath(filename);
+        std::filesystem::remove(filename);
+
+        ASSERT_TRUE(loaded);
+        EXPECT_EQ(loaded->n, 2);
+        EXPECT_EQ(loaded->k, 3);
+        EXPECT_EQ(loaded->goal, 5);
+        EXPECT_EQ(loaded->count, 1234);
+        EXPECT_EQ(loaded->winningFilename, path.winningFilename);
+        EXPECT_TRUE(loaded->losingFilename.empty());
+        ASSERT_EQ(loaded->frames.size(), 2);
+        for (size_t d = 0; d < path.frames.size(); d++) {
+            EXPECT_EQ(loaded->frames[d].idx, path.frames[d].idx);
+            EXPECT_EQ(loaded->frames[d].total, path.frames[d].total);
+            EXPECT_EQ(loaded->frames[d].board.toString(), path.frames[d].board.toString());
+        }
+
+        EXPECT_FALSE(loadSearchPath(filename));
+    }
+}
@@ -0,0 +1,76 @@
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <gtest/gtest.h>
+#include "thread_pool.h"
+
+namespace test::thread_pool {
+    TEST(thread_pool, task_group_runs_all_tasks) {
+        ThreadPool pool(4);
+        std::atomic<int> sum = 0;
+        {
+            TaskGroup group(pool);
+            for (int i = 1; i <= 100; i++) {
+                group.run([&sum, i]() { sum += i; });
+            }
+            group.wait();
+            EXPECT_EQ(sum, 5050);
+        }
+
+        // Nested groups on a single worker must not deadlock, since waiting threads run pending tasks themselves
+        ThreadPool single(1);
+        TaskGroup outer(single);
+        for (int i = 0; i < 4; i++) {
+            outer.run([&]() {
+                TaskGroup inner(single);
+                for (int j = 0; j < 4; j++) {
+                    inner.run([&sum]() { sum++; });
+                }
+                inner.wait();
+            });
+        }
+        outer.wait();
+        EXPECT_EQ(sum, 5050 + 16);
+    }
+
+    TEST(thread_pool, waiting_thread_only_runs_its_own_tasks) {
+        // The only worker is busy with a task of the group while a task of another group is queued. The waiting thread
+        // must block instead of running the other task, which the worker picks up once it is free.
+        ThreadPool single(1);
+        std::atomic<bool> started = false, released = false;
+        std::atomic<std::thread::id> otherThread;
+        TaskGroup group(single);
+        group.run([&]() {
+            started = true;
+            while (!released) std::this_thread::yield();
+        });
+        while (!started) std::this_thread::yield();
+        single.addDetachedTask([&otherThread]() { otherThread = std::this_thread::get_id(); });
+        std::thread releaser([&released]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            released = true;
+        });
+        group.wait();
+        releaser.join();
+        while (otherThread.load() == std::thread::id()) std::this_thread::yield();
+        EXPECT_NE(otherThread.load(), std::this_thread::get_id());
+    }
+
+    TEST(thread_pool, task_group_cancel_and_exceptions) {
+        ThreadPool pool(2);
+        std::atomic<int> started = 0;
+        TaskGroup group(pool);
+        group.cancel();
+        for (int i = 0; i < 10; i++) {
+            group.run([&started]() { started++; });
+        }
+        group.wait();
+        EXPECT_TRUE(group.isCancelled());
+        EXPECT_EQ(started, 0);
+
+        TaskGroup failing(pool);
+        failing.run([]() { throw std::runtime_error("task failed"); });
+        EXPECT_THROW(failing.wait(), std::runtime_error);
+        EXPECT_NO_THROW(failing.wait());
+    }
+}
@@ -0,0 +1,33 @@
+#include <gtest/gtest.h>
+#include "transposition_table.h"
+
+namespace test::transposition_table {
+    TEST(transposition_table, probe_and_store) {
+        TranspositionTable table(1, 5);
+
+        Board board1(3, 2, { { 3, 1 }, { 2, 2 }, { 3, -1 } });
+        Board board2(3, 2, { { 2, 2 }, { 3, -1 }, { 3, 1 } });
+        Board board3(3, 2, { { 3, 2 }, { 2, 1 }, { 3, -1 } });
+
+        TranspositionTable::Key key1 = table.makeKey(board1);
+        EXPECT_EQ(table.probe(key1), Player::NONE);
+        table.store(key1, Player::PUSHER, 10);
+        EXPECT_EQ(table.probe(key1), Player::PUSHER);
+
+        // A column permutation is the same position
+        EXPECT_EQ(table.probe(table.makeKey(board2)), Player::PUSHER);
+
+        // A different position is not found, even if forced into the same bucket with the same hash
+        TranspositionTable::Key key3 = table.makeKey(board3);
+        EXPECT_EQ(table.probe(key3), Player::NONE);
+        key3.hash = key1.hash;
+        EXPECT_EQ(table.probe(key3), Player::NONE);
+
+        EXPECT_EQ(table.getHits(), 2);
+        EXPECT_EQ(table.getMisses(), 3);
+        EXPECT_EQ(table.getStores(), 1);
+
+        table.clear();
+        EXPECT_EQ(table.probe(key1), Player::NONE);
+    }
+}
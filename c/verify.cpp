@@ -9,7 +9,7 @@
 #include <algorithm>
 #include <fstream>
 #include <vector>
-#include "archive.h"
+#include "archive_view.h"
 #include "board.h"
 #include "game_state.h"
 #include "helper.h"
@@ -17,14 +17,13 @@
 
 /**
  * @brief Verify if winning states are indeed winning.
- * @param archive Archive containing the exact list of winning states to verify.
+ * @param archive View of the exact list of winning states to verify.
  * @param goal The target row to reach.
  * @param threads The number of threads to use.
  * @return The number of states failed to verify.
  */
-size_t verifyWinningStates(const Archive& archive, int goal, size_t threads) {
-    std::vector<Board> winningStates = archive.getWinningBoardsAsVector();
-    size_t total = winningStates.size();
+size_t verifyWinningStates(const ArchiveView& archive, int goal, size_t threads) {
+    size_t total = archive.size();
     size_t numFailedToVerify = 0;
 
     // If there are no winning states, then there is nothing to verify
@@ -36,7 +35,7 @@ size_t verifyWinningStates(const Archive& archive, int goal, size_t threads) {
     // Otherwise, verify the winning states one by one
     for (size_t i = 0; i < total; i++) {
         // Fetch the game state to verify
-        GameState state(winningStates[i], goal);
+        GameState state(archive.getBoard(i), goal);
 
         // For any pusher move...
         std::vector<GameState> nextStates = state.step();
@@ -68,14 +67,13 @@ size_t verifyWinningStates(const Archive& archive, int goal, size_t threads) {
 
 /**
  * @brief Verify if losing states are indeed losing.
- * @param archive Archive containing the exact list of losing states to verify.
+ * @param archive View of the exact list of losing states to verify.
  * @param goal The target row to reach.
  * @param threads The number of threads to use.
  * @return The number of states failed to verify.
  */
-size_t verifyLosingStates(const Archive& archive, int goal, size_t threads) {
-    std::vector<Board> losingStates = archive.getLosingBoardsAsVector();
-    size_t total = losingStates.size();
+size_t verifyLosingStates(const ArchiveView& archive, int goal, size_t threads) {
+    size_t total = archive.size();
     size_t numFailedToVerify = 0;
 
     // If there are no losing states, then there is nothing to verify
@@ -87,7 +85,7 @@ size_t verifyLosingStates(const Archive& archive, int goal, size_t threads) {
     // Otherwise, verify the losing states one by one
     for (size_t i = 0; i < total; i++) {
         // Fetch the game state to verify
-        GameState state(losingStates[i], goal);
+        GameState state(archive.getBoard(i), goal);
 
         // For all pusher moves...
         std::vector<GameState> nextStates = state.step();
@@ -148,15 +146,21 @@ int main(int argc, char** argv) {
 
     // Load the winning and losing states
     printf("\n[Loading winning and losing states]\n");
-    std::filesystem::path filename = getFilename(N, K, GOAL);
+    ArchiveFormat archiveFormat = parseArchiveFormat(config["common"].value("archive-format", "text"));
+    std::filesystem::path filename = getFilename(N, K, GOAL, "", getExtension(archiveFormat));
+    std::filesystem::path binaryFilename = getFilename(N, K, GOAL, "", getExtension(ArchiveFormat::BINARY));
     std::filesystem::path winningFilename = "winning" / filename;
     std::filesystem::path losingFilename = "losing" / filename;
-
-    // Create the archive
-    // Archives organize game states in a way that is easy to do batch comparisons.
-    Archive winningArchive, losingArchive;
-    winningArchive.loadWinning(winningFilename);
-    losingArchive.loadLosing(losingFilename);
+    if (std::filesystem::exists("winning" / binaryFilename)) winningFilename = "winning" / binaryFilename;
+    if (std::filesystem::exists("losing" / binaryFilename)) losingFilename = "losing" / binaryFilename;
+    printf("Winning states: %s\n", winningFilename.string().c_str());
+    printf("Losing states: %s\n", losingFilename.string().c_str());
+
+    // Open the archives
+    // Binary files are preferred whatever the configured format: they are mapped and queried in place, so their states
+    // are never copied into memory. Text files are converted into the binary layout in memory instead.
+    ArchiveView winningArchive(winningFilename, Player::PUSHER, GOAL);
+    ArchiveView losingArchive(losingFilename, Player::REMOVER, GOAL);
 
     // Check if starting game state is winning or losing
     printf("\n[Verification]\n");